@@ -0,0 +1,56 @@
+// 基准测试的公共工具：计时和耗时分布统计
+
+#ifndef RK3588_DEMO_BENCH_COMMON_H
+#define RK3588_DEMO_BENCH_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+inline double BenchNowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 一组耗时样本（微秒）的统计
+struct BenchStats
+{
+    std::vector<double> samples;
+
+    void Add(double us) { samples.push_back(us); }
+
+    double Mean() const
+    {
+        double sum = 0;
+        for (double v : samples)
+        {
+            sum += v;
+        }
+        return samples.empty() ? 0 : sum / samples.size();
+    }
+
+    double Percentile(double p)
+    {
+        if (samples.empty())
+        {
+            return 0;
+        }
+        size_t k = std::min(samples.size() - 1, (size_t)(samples.size() * p / 100.0));
+        std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+        return samples[k];
+    }
+
+    void Print(const char *name)
+    {
+        double mean = Mean();
+        double p50 = Percentile(50);
+        double p99 = Percentile(99);
+        printf("%-28s mean %9.2f us  p50 %9.2f us  p99 %9.2f us  (%lu 次)\n", name, mean, p50, p99,
+               (unsigned long)samples.size());
+    }
+};
+
+#endif // RK3588_DEMO_BENCH_COMMON_H
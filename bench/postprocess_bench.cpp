@@ -0,0 +1,234 @@
+// int8 后处理两种解码方式的对比：逐个反量化再 sigmoid（INT8_DECODE_DEQNT，原始实现）
+// 和量化域类别门限（INT8_DECODE_QNT_THRESH），同时检查两者输出的检测框完全一致
+//
+// 用法：bench_postprocess [录制文件.nnrp] [重复次数]
+//   给出录制文件时使用回放引擎录下的 int8 输出张量（录制时 want_float 为 false，见 replay_engine.h），
+//   否则生成 640x640 输入、P2-P5 四个检测头、4 个类别的模拟输出
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "engine/engine.h"
+#include "process/postprocess.h"
+
+// 一帧的 int8 输出
+struct Int8Frame
+{
+    std::vector<std::vector<int8_t>> outputs;
+};
+
+static tensor_attr_s MakeAttr(int c, int h, int w, tensor_layout_e layout)
+{
+    tensor_attr_s attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.n_dims = 4;
+    attr.dims[0] = 1;
+    if (layout == NN_TENSOR_NHWC)
+    {
+        attr.dims[1] = h;
+        attr.dims[2] = w;
+        attr.dims[3] = c;
+    }
+    else
+    {
+        attr.dims[1] = c;
+        attr.dims[2] = h;
+        attr.dims[3] = w;
+    }
+    attr.n_elems = c * h * w;
+    attr.size = attr.n_elems;
+    attr.layout = layout;
+    attr.type = NN_TENSOR_INT8;
+    return attr;
+}
+
+// 模拟输出：类别 logit 大部分远低于阈值，少数格子和若干个目标周围的格子超过阈值
+static void Synthesize(tensor_attr_s &input, std::vector<tensor_attr_s> &outputs, std::vector<Int8Frame> &frames, int frame_num)
+{
+    const int sizes[4] = {160, 80, 40, 20};
+    const int class_num = 4;
+    input = MakeAttr(3, 640, 640, NN_TENSOR_NHWC);
+    outputs.clear();
+    for (int size : sizes)
+    {
+        tensor_attr_s reg = MakeAttr(4, size, size, NN_TENSOR_NCHW);
+        reg.zp = -128;
+        reg.scale = 0.0627f; // [0, 16] 格
+        tensor_attr_s cls = MakeAttr(class_num, size, size, NN_TENSOR_NCHW);
+        cls.zp = 0;
+        cls.scale = 0.08f;
+        outputs.push_back(reg);
+        outputs.push_back(cls);
+    }
+
+    std::mt19937 rng(1);
+    std::normal_distribution<float> background(-45.f, 12.f);
+    frames.resize(frame_num);
+    for (auto &frame : frames)
+    {
+        frame.outputs.clear();
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            std::vector<int8_t> data(outputs[i].n_elems);
+            bool is_cls = i % 2 == 1;
+            for (auto &v : data)
+            {
+                v = is_cls ? (int8_t)std::max(-128.f, std::min(127.f, background(rng))) : (int8_t)(rng() % 64 - 128);
+            }
+            if (is_cls)
+            {
+                // 每个检测头 8 个目标，每个目标点亮 3x3 个格子
+                int size = sizes[i / 2];
+                for (int obj = 0; obj < 8; obj++)
+                {
+                    int cx = rng() % size, cy = rng() % size, cl = rng() % class_num;
+                    for (int y = std::max(0, cy - 1); y <= std::min(size - 1, cy + 1); y++)
+                    {
+                        for (int x = std::max(0, cx - 1); x <= std::min(size - 1, cx + 1); x++)
+                        {
+                            data[cl * size * size + y * size + x] = (int8_t)(20 + rng() % 80);
+                        }
+                    }
+                }
+            }
+            frame.outputs.push_back(std::move(data));
+        }
+    }
+}
+
+// 从录制文件读取若干帧 int8 输出
+static bool LoadRecording(const char *path, tensor_attr_s &input, std::vector<tensor_attr_s> &outputs,
+                          std::vector<Int8Frame> &frames, int frame_num)
+{
+    auto engine = CreateReplayEngine(0);
+    if (engine->LoadModelFile(path) != NN_SUCCESS)
+    {
+        return false;
+    }
+    input = engine->GetInputShapes()[0];
+    outputs = engine->GetOutputShapes();
+    for (const auto &attr : outputs)
+    {
+        if (attr.type != NN_TENSOR_INT8)
+        {
+            printf("录制文件的输出不是 int8\n");
+            return false;
+        }
+    }
+    std::vector<uint8_t> input_data(input.size);
+    std::vector<tensor_data_s> inputs(1);
+    inputs[0].attr = input;
+    inputs[0].data = input_data.data();
+    frames.resize(frame_num);
+    for (auto &frame : frames)
+    {
+        frame.outputs.resize(outputs.size());
+        std::vector<tensor_data_s> outs(outputs.size());
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            frame.outputs[i].resize(outputs[i].size);
+            outs[i].attr = outputs[i];
+            outs[i].data = frame.outputs[i].data();
+        }
+        if (engine->Run(inputs, outs, false) != NN_SUCCESS)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool SameResult(const yolo::DecodeScratch &a, const yolo::DecodeScratch &b)
+{
+    if (a.keep.size() != b.keep.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.keep.size(); i++)
+    {
+        int x = a.keep[i], y = b.keep[i];
+        if (a.boxes.classId[x] != b.boxes.classId[y] || a.boxes.score[x] != b.boxes.score[y] ||
+            a.boxes.xmin[x] != b.boxes.xmin[y] || a.boxes.ymin[x] != b.boxes.ymin[y] ||
+            a.boxes.xmax[x] != b.boxes.xmax[y] || a.boxes.ymax[x] != b.boxes.ymax[y])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *recording = argc > 1 ? argv[1] : nullptr;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200;
+    const int frame_num = 16;
+
+    tensor_attr_s input;
+    std::vector<tensor_attr_s> outputs;
+    std::vector<Int8Frame> frames;
+    if (recording != nullptr)
+    {
+        if (!LoadRecording(recording, input, outputs, frames, frame_num))
+        {
+            printf("读取录制文件 %s 失败\n", recording);
+            return 1;
+        }
+        printf("录制文件 %s，%lu 个输出\n", recording, (unsigned long)outputs.size());
+    }
+    else
+    {
+        Synthesize(input, outputs, frames, frame_num);
+        printf("模拟输出：640x640，4 个检测头，4 个类别\n");
+    }
+
+    yolo::DetectionDecoder decoder;
+    if (decoder.Init(input, outputs) != NN_SUCCESS)
+    {
+        return 1;
+    }
+    std::vector<int> zp;
+    std::vector<float> scale;
+    for (const auto &attr : outputs)
+    {
+        zp.push_back(attr.zp);
+        scale.push_back(attr.scale);
+    }
+
+    const yolo::int8_decode_mode_e modes[2] = {yolo::INT8_DECODE_DEQNT, yolo::INT8_DECODE_QNT_THRESH};
+    const char *names[2] = {"INT8_DECODE_DEQNT", "INT8_DECODE_QNT_THRESH"};
+    yolo::DecodeScratch scratch[2];
+    BenchStats stats[2];
+    bool same = true;
+    size_t boxes = 0;
+    for (int it = 0; it < iterations; it++)
+    {
+        Int8Frame &frame = frames[it % frames.size()];
+        std::vector<int8_t *> blobs;
+        for (auto &out : frame.outputs)
+        {
+            blobs.push_back(out.data());
+        }
+        // 两种方式交替运行，缓存状态对两者相同
+        for (int m = 0; m < 2; m++)
+        {
+            double start = BenchNowUs();
+            decoder.GetConvDetectionResultInt8(blobs.data(), zp, scale, scratch[m], modes[m]);
+            stats[m].Add(BenchNowUs() - start);
+        }
+        same = same && SameResult(scratch[0], scratch[1]);
+        boxes += scratch[1].keep.size();
+    }
+
+    for (int m = 0; m < 2; m++)
+    {
+        stats[m].Print(names[m]);
+    }
+    printf("加速 %.2fx，平均每帧 %.1f 个框，两种方式结果%s\n", stats[0].Mean() / stats[1].Mean(),
+           (double)boxes / iterations, same ? "一致" : "不一致");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// 预处理两种方式的对比：融合的 LetterboxResizer（process_type 为 fused）
+// 和原始的 letterbox + cvtColor + resize 链（process_type 为 opencv，NV12 输入时先整帧转 BGR）
+// 同时统计两者输出张量的最大差值，超过 1 时返回失败
+//
+// 用法：bench_preprocess [图片] [重复次数]
+//   不给图片时生成 1280x720 和 1920x1080 两种随机图像，输出均为 640x640
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+#include "process/preprocess.h"
+
+static const int kDstWidth = 640;
+static const int kDstHeight = 640;
+
+static tensor_data_s MakeTensor(std::vector<uint8_t> &buffer)
+{
+    buffer.assign((size_t)kDstWidth * kDstHeight * 3, 0);
+    tensor_data_s tensor;
+    memset(&tensor, 0, sizeof(tensor));
+    tensor.attr.n_dims = 4;
+    tensor.attr.dims[0] = 1;
+    tensor.attr.dims[1] = kDstHeight;
+    tensor.attr.dims[2] = kDstWidth;
+    tensor.attr.dims[3] = 3;
+    tensor.attr.n_elems = buffer.size();
+    tensor.attr.size = buffer.size();
+    tensor.attr.layout = NN_TENSOR_NHWC;
+    tensor.attr.type = NN_TENSOR_UINT8;
+    tensor.data = buffer.data();
+    return tensor;
+}
+
+static int MaxDiff(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+{
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        diff = std::max(diff, abs((int)a[i] - (int)b[i]));
+    }
+    return diff;
+}
+
+// 与 Yolov8Detection::Preprocess 的 opencv 分支相同
+static void OpenCVChain(const cv::Mat &bgr, tensor_data_s &tensor)
+{
+    cv::Mat image_letterbox;
+    letterbox(bgr, image_letterbox, (float)kDstWidth / (float)kDstHeight);
+    mat2Tensor(image_letterbox, kDstWidth, kDstHeight, tensor);
+}
+
+// 返回 BGR 和 NV12 两种输入中较大的最大差值
+static int RunOne(const cv::Mat &bgr, int iterations)
+{
+    printf("\n%dx%d -> %dx%d\n", bgr.cols, bgr.rows, kDstWidth, kDstHeight);
+    std::vector<uint8_t> ref_buf, fused_buf;
+    tensor_data_s ref = MakeTensor(ref_buf);
+    tensor_data_s fused = MakeTensor(fused_buf);
+    LetterboxResizer resizer;
+
+    // BGR 输入
+    BenchStats chain_stats, fused_stats;
+    for (int it = 0; it < iterations; it++)
+    {
+        double start = BenchNowUs();
+        OpenCVChain(bgr, ref);
+        chain_stats.Add(BenchNowUs() - start);
+
+        start = BenchNowUs();
+        resizer.Init(bgr.cols, bgr.rows, kDstWidth, kDstHeight);
+        resizer.Run(bgr.data, (int)bgr.step, (uint8_t *)fused.data);
+        fused_stats.Add(BenchNowUs() - start);
+    }
+    int bgr_diff = MaxDiff(ref_buf, fused_buf);
+    chain_stats.Print("BGR letterbox+cvtColor+resize");
+    fused_stats.Print("BGR LetterboxResizer");
+    printf("加速 %.2fx，最大差值 %d\n", chain_stats.Mean() / fused_stats.Mean(), bgr_diff);
+
+    // NV12 输入：原始链需要先整帧转成 BGR
+    cv::Mat nv12;
+    cv::cvtColor(bgr, nv12, cv::COLOR_BGR2YUV_I420);
+    // I420 -> NV12：U、V 平面交错
+    cv::Mat nv12_packed(nv12.rows, nv12.cols, CV_8UC1);
+    memcpy(nv12_packed.data, nv12.data, (size_t)bgr.rows * bgr.cols);
+    const uint8_t *u = nv12.data + (size_t)bgr.rows * bgr.cols;
+    const uint8_t *v = u + (size_t)bgr.rows * bgr.cols / 4;
+    uint8_t *uv = nv12_packed.data + (size_t)bgr.rows * bgr.cols;
+    for (size_t i = 0; i < (size_t)bgr.rows * bgr.cols / 4; i++)
+    {
+        uv[i * 2] = u[i];
+        uv[i * 2 + 1] = v[i];
+    }
+    nv12_frame_view view = nv12Mat2View(nv12_packed);
+
+    BenchStats nv12_chain_stats, nv12_fused_stats;
+    cv::Mat converted;
+    for (int it = 0; it < iterations; it++)
+    {
+        double start = BenchNowUs();
+        cv::cvtColor(nv12_packed, converted, cv::COLOR_YUV2BGR_NV12);
+        OpenCVChain(converted, ref);
+        nv12_chain_stats.Add(BenchNowUs() - start);
+
+        start = BenchNowUs();
+        resizer.Init(view.width, view.height, kDstWidth, kDstHeight);
+        resizer.Run(view, (uint8_t *)fused.data);
+        nv12_fused_stats.Add(BenchNowUs() - start);
+    }
+    int nv12_diff = MaxDiff(ref_buf, fused_buf);
+    nv12_chain_stats.Print("NV12 cvtColor+letterbox+...");
+    nv12_fused_stats.Print("NV12 LetterboxResizer");
+    printf("加速 %.2fx，最大差值 %d\n", nv12_chain_stats.Mean() / nv12_fused_stats.Mean(), nv12_diff);
+    return std::max(bgr_diff, nv12_diff);
+}
+
+int main(int argc, char **argv)
+{
+    const char *image = argc > 1 ? argv[1] : nullptr;
+    int iterations = argc > 2 ? atoi(argv[2]) : 100;
+
+    std::vector<cv::Mat> inputs;
+    if (image != nullptr)
+    {
+        cv::Mat img = cv::imread(image);
+        if (img.empty())
+        {
+            printf("读取图片 %s 失败\n", image);
+            return 1;
+        }
+        // NV12 要求宽高为偶数
+        inputs.push_back(img(cv::Rect(0, 0, img.cols & ~1, img.rows & ~1)).clone());
+    }
+    else
+    {
+        const cv::Size sizes[2] = {cv::Size(1280, 720), cv::Size(1920, 1080)};
+        for (const auto &size : sizes)
+        {
+            cv::Mat img(size, CV_8UC3);
+            cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(256));
+            inputs.push_back(img);
+        }
+    }
+
+    int diff = 0;
+    for (const auto &img : inputs)
+    {
+        diff = std::max(diff, RunOne(img, iterations));
+    }
+    return diff > 1 ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+// 任务队列的对比：无锁 MPMCQueue 和热路径上使用的 BlockingQueue（一把锁保护的环形缓冲区 + 条件变量）
+// MPMCQueue 要在多核上明显胜出才值得替换 BlockingQueue
+// 1. 单线程 push + pop 的单次操作耗时，没有竞争
+// 2. 多个生产者、多个消费者同时操作：吞吐量，以及元素从入队到出队的延迟分布
+//
+// 用法：bench_queue [每个生产者的元素数] [队列容量]
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "utils/blocking_queue.h"
+#include "utils/mpmc_queue.h"
+
+struct BenchItem
+{
+    int64_t seq = 0;
+    double push_us = 0; // 入队时间
+};
+
+// 单线程交替 push / pop，每 1000 次记录一次平均值
+template <typename Q>
+static void Uncontended(const char *name, size_t capacity, int ops)
+{
+    Q queue(capacity);
+    BenchStats stats;
+    const int batch = 1000;
+    BenchItem item;
+    for (int done = 0; done < ops; done += batch)
+    {
+        double start = BenchNowUs();
+        for (int i = 0; i < batch; i++)
+        {
+            BenchItem in;
+            in.seq = i;
+            queue.push(std::move(in));
+            queue.pop(item);
+        }
+        stats.Add((BenchNowUs() - start) * 1000.0 / batch); // 纳秒
+    }
+    printf("%-28s push+pop mean %7.1f ns  p50 %7.1f ns  p99 %7.1f ns\n", name, stats.Mean(), stats.Percentile(50),
+           stats.Percentile(99));
+}
+
+// producers 个生产者各写 per_producer 个元素，consumers 个消费者取完为止
+template <typename Q>
+static void Contended(const char *name, size_t capacity, int producers, int consumers, int per_producer)
+{
+    Q queue(capacity);
+    std::atomic<int64_t> remaining((int64_t)producers * per_producer);
+    std::vector<BenchStats> latency(consumers);
+    std::vector<std::thread> threads;
+
+    double start = BenchNowUs();
+    for (int c = 0; c < consumers; c++)
+    {
+        threads.emplace_back([&, c]
+                             {
+            BenchItem item;
+            // 先认领一个元素再 pop，认领总数等于元素总数，pop 不会永远等待
+            while (remaining.fetch_sub(1, std::memory_order_relaxed) > 0)
+            {
+                queue.pop(item);
+                latency[c].Add(BenchNowUs() - item.push_us);
+            } });
+    }
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&, p]
+                             {
+            for (int i = 0; i < per_producer; i++)
+            {
+                BenchItem item;
+                item.seq = (int64_t)p * per_producer + i;
+                item.push_us = BenchNowUs();
+                queue.push(std::move(item));
+            } });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    double elapsed = BenchNowUs() - start;
+
+    BenchStats all;
+    for (auto &stats : latency)
+    {
+        all.samples.insert(all.samples.end(), stats.samples.begin(), stats.samples.end());
+    }
+    double total = (double)producers * per_producer;
+    printf("%-22s %dP%dC  %7.2f Mops/s  延迟 p50 %8.1f us  p99 %8.1f us\n", name, producers, consumers,
+           total / elapsed, all.Percentile(50), all.Percentile(99));
+}
+
+int main(int argc, char **argv)
+{
+    int per_producer = argc > 1 ? atoi(argv[1]) : 200000;
+    size_t capacity = argc > 2 ? (size_t)atoi(argv[2]) : 64;
+    printf("队列容量 %lu，每个生产者 %d 个元素，%u 个 CPU\n\n", (unsigned long)capacity, per_producer,
+           std::thread::hardware_concurrency());
+
+    Uncontended<MPMCQueue<BenchItem>>("MPMCQueue", capacity, 1000000);
+    Uncontended<BlockingQueue<BenchItem>>("BlockingQueue", capacity, 1000000);
+    printf("\n");
+
+    const int configs[][2] = {{1, 1}, {2, 2}, {4, 4}, {4, 1}, {1, 4}};
+    for (const auto &config : configs)
+    {
+        Contended<MPMCQueue<BenchItem>>("MPMCQueue", capacity, config[0], config[1], per_producer);
+        Contended<BlockingQueue<BenchItem>>("BlockingQueue", capacity, config[0], config[1], per_producer);
+    }
+    return 0;
+}
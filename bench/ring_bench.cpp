@@ -0,0 +1,164 @@
+// 解码器输入缓冲的对比：SPSCByteRing 和原来的 SafeQueue<uint8_t>
+// 模拟 UDP 接收线程按码率写入 1400 字节的数据报，AVIO 读回调在另一个线程读取：
+//   SafeQueue：与原来的读回调相同，空时每 1 毫秒轮询一次，逐字节加锁 pop，缓冲区 1 KB
+//   SPSCByteRing：read_wait 阻塞等待，批量读取，缓冲区 32 KB
+// 统计读线程的 CPU 时间、数据报写入到被读完的延迟，以及码率不限时的最大吞吐量
+//
+// 用法：bench_ring [码率 Mbit/s，默认 20] [时长秒数，默认 3]
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "utils/rk_helper.cpp"
+#include "utils/spsc_ring.h"
+
+static const size_t kDatagramSize = 1400;
+
+static double ThreadCpuUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 原来的读回调
+struct SafeQueueReader
+{
+    rk_helper::SafeQueue<uint8_t> queue;
+    std::vector<uint8_t> buf = std::vector<uint8_t>(1024);
+
+    void Write(uint8_t *data, size_t len) { queue.push(data, len); }
+    void Exit() { queue.exit(); }
+    int Read()
+    {
+        if (queue.is_exit())
+        {
+            return 0;
+        }
+        while (queue.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (queue.is_exit())
+            {
+                return 0;
+            }
+        }
+        int size = queue.size();
+        if (size > (int)buf.size())
+        {
+            size = buf.size();
+        }
+        for (int i = 0; i < size; i++)
+        {
+            buf[i] = queue.pop();
+        }
+        return size;
+    }
+    uint64_t Dropped() { return 0; }
+};
+
+struct RingReader
+{
+    SPSCByteRing ring;
+    std::vector<uint8_t> buf = std::vector<uint8_t>(32 * 1024);
+
+    void Write(uint8_t *data, size_t len) { ring.write(data, len); }
+    void Exit() { ring.exit(); }
+    int Read() { return (int)ring.read_wait(buf.data(), buf.size()); }
+    uint64_t Dropped() { return ring.get_dropped_bytes(); }
+};
+
+// mbps 为 0 时不限码率，写端领先读端超过 1 MB 时让出 CPU，测的是读写两端的最大吞吐量
+template <typename R>
+static void Run(const char *name, double mbps, double seconds)
+{
+    R reader;
+    size_t total = mbps > 0 ? (size_t)(mbps * 1e6 / 8 * seconds / kDatagramSize) : (size_t)(64 * 1024 * 1024 / kDatagramSize);
+    std::vector<double> write_us(total);
+    BenchStats latency;
+    double reader_cpu = 0;
+    std::atomic<uint64_t> read_bytes(0);
+
+    std::thread consumer([&]
+                         {
+        double cpu = ThreadCpuUs();
+        size_t done = 0; // 已经读完的数据报
+        uint64_t bytes = 0;
+        while (true)
+        {
+            int n = reader.Read();
+            if (n <= 0)
+            {
+                break;
+            }
+            bytes += n;
+            double now = BenchNowUs();
+            while (done < total && (done + 1) * kDatagramSize <= bytes)
+            {
+                latency.Add(now - write_us[done]);
+                done++;
+            }
+            read_bytes.store(bytes, std::memory_order_release);
+        }
+        reader_cpu = ThreadCpuUs() - cpu; });
+
+    std::vector<uint8_t> datagram(kDatagramSize, 0x5a);
+    double interval_us = mbps > 0 ? kDatagramSize * 8 / mbps : 0;
+    double start = BenchNowUs();
+    for (size_t i = 0; i < total; i++)
+    {
+        if (interval_us > 0)
+        {
+            double due = start + i * interval_us;
+            while (BenchNowUs() < due)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        else
+        {
+            while (i * kDatagramSize - read_bytes.load(std::memory_order_acquire) - reader.Dropped() > 1024 * 1024)
+            {
+                std::this_thread::yield();
+            }
+        }
+        write_us[i] = BenchNowUs();
+        reader.Write(datagram.data(), datagram.size());
+    }
+    // 等读端读完再退出，SafeQueue 的 exit 不会等剩余数据
+    while (read_bytes.load(std::memory_order_acquire) + reader.Dropped() < total * kDatagramSize)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double elapsed = BenchNowUs() - start;
+    reader.Exit();
+    consumer.join();
+
+    if (mbps > 0)
+    {
+        printf("%-14s %5.0f Mbit/s  读线程 CPU %5.1f%%  延迟 p50 %8.1f us  p99 %8.1f us  丢弃 %lu 字节\n", name, mbps,
+               reader_cpu / elapsed * 100, latency.Percentile(50), latency.Percentile(99), (unsigned long)reader.Dropped());
+    }
+    else
+    {
+        printf("%-14s 不限码率  吞吐 %8.1f Mbit/s  读线程 CPU %.0f ms\n", name, read_bytes.load() * 8 / elapsed,
+               reader_cpu / 1000);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double mbps = argc > 1 ? atof(argv[1]) : 20;
+    double seconds = argc > 2 ? atof(argv[2]) : 3;
+
+    Run<SafeQueueReader>("SafeQueue", mbps, seconds);
+    Run<RingReader>("SPSCByteRing", mbps, seconds);
+    Run<SafeQueueReader>("SafeQueue", 0, 0);
+    Run<RingReader>("SPSCByteRing", 0, 0);
+    return 0;
+}
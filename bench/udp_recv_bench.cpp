@@ -0,0 +1,123 @@
+// UDP 接收方式的对比：UdpSocket 原来的逐个 recvfrom 和 recvmmsg 批量接收
+// 回环上的负载发生器用 UDPSender 按 sendmmsg 每批 32 个、每个 1400 字节发送，接收端只计数，
+// 统计每个数据包的接收系统调用次数、接收线程的 CPU 时间、收到的比例和内核丢包数（SO_RXQ_OVFL，只在批量接收时有）
+//
+// 用法：bench_udp_recv [数据包数，默认 200000] [码率 Mbit/s，默认 0 不限] [SO_RCVBUF 字节数，默认 4 MB]
+//   每种方式新建一个套接字，测完停止接收线程并释放
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "io/udp.h"
+
+static const size_t kPacketSize = 1400;
+static const size_t kBurst = 32;
+
+static double ThreadCpuUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// 接收回调里记录接收线程的 CPU 时间，第一次和最后一次回调之差就是接收耗费的 CPU
+struct RecvCounter
+{
+    std::atomic<uint64_t> packets{0};
+    std::atomic<double> first_cpu_us{-1};
+    std::atomic<double> last_cpu_us{0};
+
+    void Add(int count)
+    {
+        double cpu = ThreadCpuUs();
+        double unset = -1;
+        first_cpu_us.compare_exchange_strong(unset, cpu);
+        last_cpu_us.store(cpu);
+        packets += count;
+    }
+};
+
+static void Run(const char *name, int batch_size, int packets, double mbps, int rcvbuf)
+{
+    RecvCounter *counter = new RecvCounter;
+    UdpSocket *receiver;
+    if (batch_size > 1)
+    {
+        receiver = new UdpSocket([counter](const UdpPacket *, int count)
+                                 { counter->Add(count); });
+        receiver->setBatchReceive(batch_size);
+    }
+    else
+    {
+        receiver = new UdpSocket([counter](const char *, int)
+                                 { counter->Add(1); });
+    }
+    // 每种方式用不同的端口，不受上一个套接字残留数据包的影响
+    static int port = 36000 + (int)(getpid() % 1000) * 10;
+    port++;
+    int actual_rcvbuf = receiver->setReceiveBuffer(rcvbuf);
+    receiver->startReceiving(port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    UDPSender sender("127.0.0.1", port);
+    sender.set_send_mode(UDP_SEND_MMSG);
+    std::vector<char> payload(kPacketSize * kBurst, 0x5a);
+    std::vector<struct iovec> burst(kBurst);
+    for (size_t i = 0; i < kBurst; i++)
+    {
+        burst[i].iov_base = payload.data() + i * kPacketSize;
+        burst[i].iov_len = kPacketSize;
+    }
+    double interval_us = mbps > 0 ? kPacketSize * kBurst * 8 / mbps : 0;
+    double start = BenchNowUs();
+    for (int sent = 0, b = 0; sent < packets; sent += kBurst, b++)
+    {
+        if (interval_us > 0)
+        {
+            double due = start + b * interval_us;
+            while (BenchNowUs() < due)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        sender.send_batch(burst.data(), std::min(kBurst, (size_t)(packets - sent)));
+    }
+    double send_us = BenchNowUs() - start;
+
+    // 等接收端取完：计数 100 毫秒不变
+    uint64_t last = 0;
+    do
+    {
+        last = counter->packets.load();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    } while (counter->packets.load() != last);
+
+    const UdpRecvStats &stats = receiver->getRecvStats();
+    uint64_t sent = sender.get_stats().datagrams.load();
+    uint64_t got = stats.datagrams.load();
+    double cpu_us = counter->last_cpu_us.load() - std::max(0.0, counter->first_cpu_us.load());
+    printf("%-9s SO_RCVBUF %7d  发送 %7.1f Mbit/s  收到 %6.2f%%  系统调用/包 %5.3f  接收 CPU %6.2f us/包  内核丢包 %lu\n",
+           name, actual_rcvbuf, sent * kPacketSize * 8 / send_us, sent > 0 ? got * 100.0 / sent : 0,
+           got > 0 ? (double)stats.syscalls / got : 0, got > 0 ? cpu_us / got : 0,
+           (unsigned long)stats.kernel_drops.load());
+    // 先停止接收线程，再释放回调用到的计数器
+    delete receiver;
+    delete counter;
+}
+
+int main(int argc, char **argv)
+{
+    int packets = argc > 1 ? atoi(argv[1]) : 200000;
+    double mbps = argc > 2 ? atof(argv[2]) : 0;
+    int rcvbuf = argc > 3 ? atoi(argv[3]) : 4 * 1024 * 1024;
+    printf("%d 个 %lu 字节的数据包，码率 %s\n\n", packets, (unsigned long)kPacketSize, mbps > 0 ? argv[2] : "不限");
+
+    Run("recvfrom", 1, packets, mbps, rcvbuf);
+    Run("recvmmsg", 64, packets, mbps, rcvbuf);
+    return 0;
+}
@@ -28,6 +28,8 @@
 #include "msg/msg.h"
 #include "types/video_infos_type.h"
 #include "utils/json.hpp"
+#include "utils/frame_pool.h"
+#include "video/stream_manager.h"
 #include <bits/fs_fwd.h>
 using namespace rk_helper;
 #define UDP_LISTEN_PORT 8818
@@ -42,9 +44,14 @@ using json = nlohmann::json;
 struct AIConfig{
     std::string SendIP;
     std::string License;
-    int SendPort;
-    int ListenPort;
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(AIConfig,SendIP, SendPort, ListenPort)
+    int SendPort = UDP_SEND_PORT;
+    int ListenPort = UDP_LISTEN_PORT;
+    // 多路视频流，为空时按 SendIP/SendPort 只接收 UDP_LISTEN_PORT 一路（原来的单路配置）
+    std::vector<StreamConfig> Streams;
+    // 端到端延迟目标和推理间隔上限，过载时每路自动隔帧推理，跳过的帧沿用上一次的检测框
+    int TargetP99Ms = 150;
+    int MaxStride = 8;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(AIConfig,SendIP, SendPort, ListenPort, Streams, TargetP99Ms, MaxStride)
 };
 
 
@@ -52,24 +59,21 @@ struct AIConfig{
 class GlobalState
 {
 public:
-    std::unique_ptr<RKMPPEncoder> encoder;
-    FPSCalculator FPS;
-    FPSCalculator AIFPS;
-    FPSCalculator NatsFPS;
+    // 帧内存池放在最前面，最后析构，保证从池中分配的 Mat 都先释放
+    // 数量上限在线程池启动后由 initializeFramePools 按各级队列的容量设置
+    FramePool nv12_pool{32}; // 解码后的 NV12 帧
+    FramePool bgr_pool{32};  // 绘制和编码用的 BGR 帧
 
-    int frame_start_id = 0;
-    int frame_end_id = 0;
+    std::unique_ptr<ThreadPool> thread_pool;
+    // 每路视频流的解码器、编码器和发送端，共用一个线程池
+    // 放在线程池之后，先析构：停止时调用线程池的 stopAll 并等待各路线程结束
+    std::unique_ptr<StreamManager> streams;
     std::chrono::system_clock::time_point last_write_img = std::chrono::system_clock::now();
 
-    std::unique_ptr<ThreadPool> thread_pool;
     bool yolo_end = false;
 
     std::unique_ptr<fc_io::nats_io> nats_io_instance;
-    std::unique_ptr<PacketManager> packet_manager;
-
-    std::unique_ptr<UdpSocket> udp_receiver;
-    std::unique_ptr<UDPSender> udp_sender;
-    bool isNeedSet = false;
+    int blackout_after = 0; // 认证失败时开始黑屏的帧数（以 30 帧为单位），0 表示不黑屏
 
     std::mutex mtx;
     std::condition_variable cv;
@@ -88,7 +92,7 @@ public:
  * @param detections 检测结果向量
  * @return std::vector<uint8_t> 序列化后的字节缓冲区
  */
-std::vector<uint8_t> serializeDetections(const std::vector<Detection> &detections)
+std::vector<uint8_t> serializeDetections(const DetectionList &detections)
 {
     std::vector<uint8_t> buffer;
     for (const auto &d : detections)
@@ -133,81 +137,29 @@ std::string get_current_time_as_string()
 
 
 /**
- * @brief 初始化UDP发送器
- *
- * @return true 初始化成功
- * @return false 初始化失败
- */
-bool initializeUDPSender()
-{
-    global.udp_sender = std::make_unique<UDPSender>(global.config.SendIP, global.config.SendPort);
-    return true;
-}
-
-/**
- * @brief 初始化数据包管理器
+ * @brief 初始化视频流，配置中没有 Streams 时按原来的单路 UDP 输入
  *
  * @return true 初始化成功
  * @return false 初始化失败
  */
-bool initializePacketManager()
+bool initializeStreams()
 {
-    global.packet_manager = std::make_unique<PacketManager>(1024 * 1024, 1470);
-    return true;
-}
-
-/**
- * @brief 初始化编码器
- *
- * @return true 初始化成功
- * @return false 初始化失败
- */
-bool initializeEncoder()
-{
-    global.encoder = std::make_unique<RKMPPEncoder>(1920, 1088, 4);
-    if (!global.encoder->init())
+    global.streams = std::make_unique<StreamManager>(&global.nv12_pool, &global.bgr_pool);
+    if (global.config.Streams.empty())
     {
-        NN_LOG_ERROR("编码器初始化失败！");
-        return false;
+        StreamConfig stream;
+        stream.Type = "udp";
+        stream.ListenPort = UDP_LISTEN_PORT;
+        stream.SendIP = global.config.SendIP;
+        stream.SendPort = global.config.SendPort;
+        stream.Subject = "ai.infos";
+        global.streams->AddStream(stream);
     }
-    return true;
-}
-
-/**
- * @brief 初始化解码器
- *
- * @param decoder 解码器实例
- * @return true 初始化成功
- * @return false 初始化失败
- */
-bool initializeDecoder(FCourier::RKMPPDecoder &decoder)
-{
-    if (decoder.init())
+    for (const auto &stream : global.config.Streams)
     {
-        printf("解码器初始化成功。\n");
-        decoder.start();
-        return true;
+        global.streams->AddStream(stream);
     }
-    else
-    {
-        printf("解码器初始化失败。\n");
-        return false;
-    }
-}
-
-/**
- * @brief 初始化UDP接收器
- *
- * @param decoder 解码器实例
- * @return true 初始化成功
- * @return false 初始化失败
- */
-bool initializeUDPReceiver(FCourier::RKMPPDecoder &decoder)
-{
-    global.udp_receiver = std::make_unique<UdpSocket>([&decoder](const char *data, int length)
-                                                      { decoder.set_raw_data((uint8_t *)(data), length); });
-    global.udp_receiver->bindSocket(UDP_LISTEN_PORT);
-    global.udp_receiver->startReceiving();
+    NN_LOG_INFO("共 %d 路视频流", global.streams->GetStreamNum());
     return true;
 }
 
@@ -238,226 +190,126 @@ bool initializeThreadPool(std::string model_path, int threads)
 
     global.thread_pool = std::make_unique<ThreadPool>();
     global.thread_pool->need_draw = true;
-    global.thread_pool->startTPool(model_path, threads);
-    return true;
+    global.thread_pool->frame_allocator = &global.bgr_pool;
+    // 每路视频流各自的帧号序列和结果顺序，任务队列按路轮流调度
+    global.thread_pool->stream_num = global.streams->GetStreamNum();
+    global.thread_pool->admission_config.target_p99_ms = global.config.TargetP99Ms;
+    global.thread_pool->admission_config.max_stride = global.config.MaxStride;
+    return global.thread_pool->startTPool(model_path, threads) == NN_SUCCESS;
 }
 
 /**
- * @brief 设置解码器和编码器的回调函数
+ * @brief 按各级队列的容量设置帧内存池的数量上限，缓冲区按需分配，上限只防止正常排队时退回堆分配
  *
- * @param decoder 解码器实例
+ * NV12 帧从提交到绘制前转成 BGR 为止，都在线程池内（任务队列、流水线槽位、结果缓冲区）；
+ * BGR 帧还要在每路编码器的队列里排队。每路另外留 2 帧给解码器和正在编码的帧。
  */
-void setupCallbacks(FCourier::RKMPPDecoder &decoder)
+void initializeFramePools()
 {
-    // 解码器回调
-    decoder.set_callback([](unsigned char *data, int size, int w, int h, AVPixelFormat format, void *handler)
-                         { global.FPS.CountAFrame(); });
-    decoder.set_mat_callback([](cv::Mat mat, video_decoder_info info, void *handler)
-                             {
-
-        if(!global.isNeedSet){
-            global.isNeedSet = true;
-           // global.encoder->add_data(mat.clone());
-            return;
-        }
-
-        if (global.thread_pool) {
-            // 分配新的帧ID并添加任务到线程池
-            global.thread_pool->new_id = global.frame_start_id + 1;
-            global.thread_pool->addTask(mat.clone(), global.frame_start_id++);
-            global.isNeedSet = false;
-        } });
-
-    // 编码器回调
-    global.encoder->set_on_encoder_ok_cb([](uint8_t *data, int size)
-                                         {
-        global.AIFPS.CountFrames(size);
-        if (global.packet_manager) {
-            global.packet_manager->SplitIntoPackets(reinterpret_cast<const char *>(data), size);
-        } });
+    int stream_num = global.streams->GetStreamNum();
+    int in_pool = global.thread_pool->getFrameCapacity();
+    global.nv12_pool.SetBlockNum(in_pool + stream_num * 2);
+    global.bgr_pool.SetBlockNum(in_pool + stream_num * (RKMPPEncoder::kQueueCapacity + 2));
+    NN_LOG_INFO("帧内存池上限 NV12 %d，BGR %d", global.nv12_pool.GetBlockNum(), global.bgr_pool.GetBlockNum());
 }
 
 // 线程函数
 
 /**
- * @brief 处理YOLO模型的结果
+ * @brief 处理一路视频流的YOLO结果，在该路的结果线程上按帧号顺序调用
+ *
+ * @param stream 视频流
+ * @param result 图像和检测框
  */
-void GetYoloResults()
+void HandleYoloResult(VideoStream &stream, FrameResult &result)
 {
+    cv::Mat &img = result.img;
+    DetectionList &objects = result.objects;
 
-    global.offset = global.lp == "l" ? 0 : 20;
-
-    // 不满足认证 随机黑屏
-    int c = 0;
-    switch (global.offset)
+    if (global.blackout_after != 0 && stream.result_count > (uint64_t)global.blackout_after * 30)
     {
-    case 20:
-        c = generateRandomNumber(1, 500);
-        break;
-
-    default:
-        break;
+        // 暗桩
+        cv::Mat whiteImage = cv::Mat::ones(img.rows, img.cols, CV_8UC3) * 255;
+        stream.encoder->add_data(whiteImage);
     }
-
-    int total = 0;
-    while (true)
+    else
     {
-        total++;
-
-        cv::Mat img;
-        int id = global.frame_end_id++;
-        auto ret = global.thread_pool->getTargetImgResult(img, id);
-
-        if (img.empty())
-        {
-            NN_LOG_ERROR("接收到空图像。");
-            continue;
-        }
-
-        if (ret != NN_SUCCESS)
-        {
-            NN_LOG_INFO("获取目标图像结果时出错。");
-            continue;
-        }
-
-        if (c != 0 && total > c * 30)
-        {
-            // 暗桩
-            cv::Mat whiteImage = cv::Mat::ones(img.rows, img.cols, CV_8UC3) * 255;
-            global.encoder->add_data(whiteImage.clone());
-        }
-        else
-        {
-            // 将图像添加到编码器
-            global.encoder->add_data(img.clone());
-        }
-
-        // 准备AI信息
-        std::vector<AI_MSG::Data> ai_infos;
-        std::vector<Detection> objects;
-        ret = global.thread_pool->getTargetResult(objects, id);
-
-        if (ret != NN_SUCCESS)
-        {
-            NN_LOG_INFO("获取目标检测结果时出错。");
-            continue;
-        }
-
-        for (const auto &obj : objects)
-        {
-            AI_MSG::Data d;
-            d.x = obj.box.x;
-            d.y = obj.box.y;
-            d.width = obj.box.width; // 修正：从height改为width
-            d.height = obj.box.height;
-            d.score = obj.confidence;
-            d.class_id = obj.class_id;
-            ai_infos.push_back(d);
-        }
-
-        // 如果检测到过多物体且时间间隔满足条件，保存图像
-        if (objects.size() > 9999)
-        {
-            auto now = std::chrono::system_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - global.last_write_img).count();
-            if (elapsed >= 5)
-            {
-                std::string filename = "/images/output_" + get_current_time_as_string() + ".jpg";
-                std::cout << "保存图片: " << filename << std::endl;
-                cv::imwrite(filename, img);
-                global.last_write_img = now;
-            }
-        }
+        // 将图像添加到该路的编码器，Mat 带引用计数，不需要拷贝
+        stream.encoder->add_data(img);
+    }
 
-        // 序列化并发送AI信息
-        auto serialized_data = AI_MSG::serialize(ai_infos);
-        if (global.nats_io_instance)
-        {
-            global.nats_io_instance->write_subj("ai.infos", reinterpret_cast<char *>(serialized_data.data()), serialized_data.size());
-        }
+    // 准备AI信息
+    std::vector<AI_MSG::Data> ai_infos;
+    for (const auto &obj : objects)
+    {
+        AI_MSG::Data d;
+        d.x = obj.box.x;
+        d.y = obj.box.y;
+        d.width = obj.box.width; // 修正：从height改为width
+        d.height = obj.box.height;
+        d.score = obj.confidence;
+        d.class_id = obj.class_id;
+        ai_infos.push_back(d);
+    }
 
-        // 检查是否需要结束
-        if (global.yolo_end && ret != NN_SUCCESS)
+    // 如果检测到过多物体且时间间隔满足条件，保存图像
+    if (objects.size() > 9999)
+    {
+        auto now = std::chrono::system_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - global.last_write_img).count();
+        if (elapsed >= 5)
         {
-            global.thread_pool->stopAll();
-            break;
+            std::string filename = "/images/output_" + get_current_time_as_string() + ".jpg";
+            std::cout << "保存图片: " << filename << std::endl;
+            cv::imwrite(filename, img);
+            global.last_write_img = now;
         }
     }
 
-    // 确保所有线程停止
-    global.thread_pool->stopAll();
-}
-
-
-
-/**
- * @brief 启动编码器
- */
-void EncoderStart()
-{
-    global.encoder->encoder();
-}
+    // 序列化并发送AI信息，每路视频流发布到自己的主题
+    auto serialized_data = AI_MSG::serialize(ai_infos);
+    if (global.nats_io_instance)
+    {
+        global.nats_io_instance->write_subj(stream.config.Subject.c_str(), reinterpret_cast<char *>(serialized_data.data()), serialized_data.size());
+    }
 
-/**
- * @brief 发布流媒体数据
- */
-void PublishStreaming()
-{
-    PacketManager::DataPacket packet;
-    while (true)
+    // 检查是否需要结束
+    if (global.yolo_end)
     {
-        if (global.packet_manager->TryGetNextPacket(packet))
-        {
-            if (global.nats_io_instance && false)
-            {
-                global.nats_io_instance->write_subj("ai.streaming", packet.data(), packet.size());
-                global.NatsFPS.CountFrames(packet.size());
-            }
-            if (!global.udp_sender->send_data(packet.data(), packet.size()))
-            {
-                printf("UDP发送失败！\n");
-            }
-        }
-        else
-        {
-            std::this_thread::sleep_for(std::chrono::milliseconds(15));
-        }
+        global.thread_pool->stopAll();
     }
 }
 
 /**
- * @brief 启动所有线程
+ * @brief 启动所有视频流
+ *
+ * @return true 启动成功
+ * @return false 启动失败
  */
-void startThreads()
+bool startStreams()
 {
-    std::thread result_thread(GetYoloResults);
-    std::thread encoder_thread(EncoderStart);
-    std::thread publish_thread(PublishStreaming);
-    // 如果需要跟踪结果，取消注释
-    // std::thread tracking_thread(EncoderTrackingResult);
-
-    // 分离线程以允许独立运行
-    result_thread.detach();
-    encoder_thread.detach();
-    publish_thread.detach();
-    // tracking_thread.detach();
+    global.offset = global.lp == "l" ? 0 : 20;
+    // 不满足认证 随机黑屏
+    if (global.offset == 20)
+    {
+        global.blackout_after = generateRandomNumber(1, 500);
+    }
+    return global.streams->Start(global.thread_pool.get(), HandleYoloResult);
 }
 
 /**
- * @brief 主监控和日志记录
- *
- * @param decoder 解码器实例
+ * @brief 主监控和日志记录，线程池停止后返回
  */
-void monitorAndLog(FCourier::RKMPPDecoder &decoder)
+void monitorAndLog()
 {
-    while (true)
+    while (global.streams->IsRunning())
     {
-        global.AIFPS.Update();
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
-        NN_LOG_INFO("解码器FPS: %d", decoder.get_fps());
-        NN_LOG_INFO("推理及编码速率: %lf kB/s", global.AIFPS.getFramePerSecond() / 1024.0);
-        NN_LOG_INFO("NATS发布速率: %lf kB/s\n", global.NatsFPS.getFramePerSecond() / 1024.0);
+        global.streams->LogStats();
+        NN_LOG_INFO("帧内存池 NV12: 使用 %d/%d 峰值 %d 溢出 %lu, BGR: 使用 %d/%d 峰值 %d 溢出 %lu\n",
+                    global.nv12_pool.GetInUse(), global.nv12_pool.GetBlockNum(), global.nv12_pool.GetHighWater(), global.nv12_pool.GetOverflowCount(),
+                    global.bgr_pool.GetInUse(), global.bgr_pool.GetBlockNum(), global.bgr_pool.GetHighWater(), global.bgr_pool.GetOverflowCount());
     }
 }
 
@@ -508,21 +360,17 @@ void  LoadConfig(){
 int main()
 {
     LoadConfig();
-    FCourier::RKMPPDecoder decoder;
 
     // 初始化各模块
     if (
-        !initializeUDPSender() ||
-        !initializePacketManager() ||
-        !initializeEncoder() ||
-        !initializeDecoder(decoder) ||
-        !initializeUDPReceiver(decoder) ||
+        !initializeStreams() ||
         !initializeNATS() ||
         !initializeThreadPool("./car.bin", 3))
     {
         NN_LOG_ERROR("初始化过程中出现错误！");
         return -1;
     }
+    initializeFramePools();
 
     string sn = getCPUSerial();
     string r = (sn == "17e1c1f6dbc0861c") ? "l" : "p";
@@ -533,16 +381,19 @@ int main()
         exit(0);
     }
 
-    // 设置回调
-    setupCallbacks(decoder);
-
-    // 启动线程
-    startThreads();
+    // 启动各路视频流的解码、结果、编码和发送线程
+    if (!startStreams())
+    {
+        NN_LOG_ERROR("启动视频流时出现错误！");
+        return -1;
+    }
 
     std::cout << "所有服务已经启动。" << std::endl;
 
     // 启动主监控和日志记录
-    monitorAndLog(decoder);
+    monitorAndLog();
 
+    // 等待各路视频流的线程结束
+    global.streams->Stop();
     return 0;
 }
@@ -1,14 +1,14 @@
 #include "cv_draw.h"
 #include "utils/logging.h"
 #include <iomanip>
-#include <map>
 
-void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects, std::chrono::time_point<std::chrono::system_clock> &t, int new_id, int now_id)
+void DrawDetections(cv::Mat &img, const DetectionList &objects, const ClassTable &classes, const std::chrono::steady_clock::time_point &t, int new_id, int now_id)
 {
     // 输出检测到的对象数量
     // std::cout << "draw " << objects.size() << " objects" << std::endl;
 
-    std::map<std::string, int> class_count;
+    // 按类别编号计数，名称在绘制时从类别表中查
+    std::vector<int> class_count(classes.size(), 0);
 
     for (const auto &object : objects)
     {
@@ -18,7 +18,10 @@ void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects, std::ch
         }
 
         // 更新类别计数
-        class_count[object.className]++;
+        if (object.class_id >= 0 && object.class_id < (int)class_count.size())
+        {
+            class_count[object.class_id]++;
+        }
 
         // 绘制目标框，使用更加柔和的颜色和较细的边框
         cv::Scalar boxColor = cv::Scalar(0, 255, 0); // 可以根据需要调整为你喜欢的颜色
@@ -26,7 +29,7 @@ void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects, std::ch
         
         // 给文本添加阴影
         std::ostringstream oss;
-        oss << object.className << " " << std::fixed << std::setprecision(1) << object.confidence;
+        oss << classes.Name(object.class_id) << " " << std::fixed << std::setprecision(1) << object.confidence;
         std::string draw_string = oss.str();
 
         // 设置文本位置，确保不超出框的边界
@@ -35,11 +38,11 @@ void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects, std::ch
 
         // 为文字添加阴影效果
         cv::putText(img, draw_string, text_position + cv::Point(2, 2), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 0, 0), 2, cv::LINE_AA);
-        cv::putText(img, draw_string, text_position, cv::FONT_HERSHEY_SIMPLEX, 0.8, object.color, 2, cv::LINE_AA);
+        cv::putText(img, draw_string, text_position, cv::FONT_HERSHEY_SIMPLEX, 0.8, classes.Color(object.class_id), 2, cv::LINE_AA);
     }
 
     // 计算当前时间与传入时间之间的差异
-    auto now = std::chrono::system_clock::now();
+    auto now = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - t).count();
 
     // 构造 ID 信息字符串
@@ -65,9 +68,13 @@ void DrawDetections(cv::Mat &img, const std::vector<Detection> &objects, std::ch
 
     // 绘制各类别的数量信息
     int y_offset = 30; // 初始Y偏移量
-    for (const auto &entry : class_count)
+    for (int i = 0; i < (int)class_count.size(); i++)
     {
-        std::string count_str = entry.first + ": " + std::to_string(entry.second);
+        if (class_count[i] == 0)
+        {
+            continue;
+        }
+        std::string count_str = classes.Name(i) + ": " + std::to_string(class_count[i]);
         // 确保文本不超出右边界
         cv::putText(img, count_str, cv::Point(img.cols - 200, y_offset), fontFace, 0.8, color, thickness, cv::LINE_AA);
         y_offset += 30;  // 每行文本的间隔
@@ -9,7 +9,7 @@
 #include "utils/rk_helper.cpp"
 
 
-void DrawDetections(cv::Mat& img, const std::vector<Detection>& objects,std::chrono::time_point<std::chrono::system_clock>& t,int new_id,int now_id);
+void DrawDetections(cv::Mat& img, const DetectionList& objects, const ClassTable& classes, const std::chrono::steady_clock::time_point& t,int new_id,int now_id);
 
 
 
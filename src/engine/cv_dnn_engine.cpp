@@ -0,0 +1,327 @@
+// cv_dnn_engine.h的实现
+
+#include "cv_dnn_engine.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "model_registry.h"
+#include "utils/logging.h"
+
+// 回归输出是 DFL 的期望距离，单位为格子，不超过 reg_max
+static const float g_reg_max = 16.f;
+
+CVDnnEngine::CVDnnEngine(int input_w, int input_h) : input_w_(input_w), input_h_(input_h) {}
+
+CVDnnEngine::~CVDnnEngine()
+{
+    // 模拟异步的线程会调用 Run，必须在网络销毁前停止
+    StopAsync();
+}
+
+nn_error_e CVDnnEngine::SetOutputType(tensor_datatype_e type)
+{
+    if (type != NN_TENSOR_INT8 && type != NN_TENSOR_FLOAT)
+    {
+        NN_LOG_ERROR("cv dnn engine output type %d not supported", type);
+        return NN_UNSUPPORTED;
+    }
+    if (!out_shapes_.empty())
+    {
+        NN_LOG_ERROR("set output type before loading model");
+        return NN_UNSUPPORTED;
+    }
+    output_type_ = type;
+    return NN_SUCCESS;
+}
+
+nn_error_e CVDnnEngine::LoadModelFile(const char *model_file)
+{
+    auto model = ModelRegistry::Map(model_file);
+    if (model == nullptr)
+    {
+        NN_LOG_ERROR("load model file %s fail!", model_file);
+        return NN_LOAD_MODEL_FAIL;
+    }
+    return LoadModelData(model);
+}
+
+// cv::dnn::Net 的浅拷贝共用同一个网络实例，不能在多个线程上同时 forward，
+// 所以不支持 Duplicate，每个上下文从同一个映射各自解析
+nn_error_e CVDnnEngine::LoadModelData(std::shared_ptr<MappedModel> model)
+{
+    try
+    {
+        net_ = cv::dnn::readNetFromONNX((const char *)model->data(), model->size());
+    }
+    catch (const cv::Exception &e)
+    {
+        NN_LOG_ERROR("readNetFromONNX %s fail! %s", model->path().c_str(), e.what());
+        return NN_LOAD_MODEL_FAIL;
+    }
+    if (net_.empty())
+    {
+        NN_LOG_ERROR("readNetFromONNX %s fail!", model->path().c_str());
+        return NN_LOAD_MODEL_FAIL;
+    }
+    net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    return InitNet();
+}
+
+// 用一次 forward 得到输出形状，按 (回归, 类别) 成对排序，生成与 RKNN 一致的输入输出属性
+nn_error_e CVDnnEngine::InitNet()
+{
+    // 输入与 RKNN 模型一致：NHWC uint8 RGB
+    tensor_attr_s input;
+    memset(&input, 0, sizeof(input));
+    input.index = 0;
+    input.n_dims = 4;
+    input.dims[0] = 1;
+    input.dims[1] = input_h_;
+    input.dims[2] = input_w_;
+    input.dims[3] = 3;
+    input.n_elems = input_h_ * input_w_ * 3;
+    input.size = input.n_elems;
+    input.type = NN_TENSOR_UINT8;
+    input.layout = NN_TENSOR_NHWC;
+    input.scale = 1.f;
+    in_shapes_.assign(1, input);
+
+    std::vector<std::string> names = net_.getUnconnectedOutLayersNames();
+    out_names_ = names;
+    cv::Mat gray(input_h_, input_w_, CV_8UC3, cv::Scalar(114, 114, 114));
+    auto ret = Forward(gray);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    if (out_blobs_.empty() || out_blobs_.size() % 2 != 0)
+    {
+        NN_LOG_ERROR("cv dnn engine: output num %ld is not (reg, cls) pairs", out_blobs_.size());
+        return NN_RKNN_OUTPUT_ATTR_ERROR;
+    }
+    for (const auto &blob : out_blobs_)
+    {
+        if (blob.dims != 4)
+        {
+            NN_LOG_ERROR("cv dnn engine: output dims %d is not 4", blob.dims);
+            return NN_RKNN_OUTPUT_ATTR_ERROR;
+        }
+    }
+
+    // 特征图从大到小排序，再在每个检测头内把回归放在前面。
+    // getUnconnectedOutLayersNames 按名字排序，不是模型声明的输出顺序，不能依赖它区分回归和类别
+    std::vector<int> order(out_blobs_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+                     { return out_blobs_[a].size[2] > out_blobs_[b].size[2]; });
+    for (size_t i = 0; i < order.size(); i += 2)
+    {
+        const cv::Mat &x = out_blobs_[order[i]];
+        const cv::Mat &y = out_blobs_[order[i + 1]];
+        if (x.size[2] != y.size[2] || x.size[3] != y.size[3])
+        {
+            NN_LOG_ERROR("cv dnn engine: outputs of head %ld have different size", i / 2);
+            return NN_RKNN_OUTPUT_ATTR_ERROR;
+        }
+        bool x_reg = IsRegOutput(x);
+        bool y_reg = IsRegOutput(y);
+        if (x_reg == y_reg)
+        {
+            // 类别数为 4 且灰图上的 logit 全部非负，两个输出都像回归，只能保持名字顺序
+            NN_LOG_WARNING("cv dnn engine: can not tell reg from cls in head %ld, keep name order", i / 2);
+        }
+        else if (y_reg)
+        {
+            std::swap(order[i], order[i + 1]);
+        }
+    }
+    out_names_.clear();
+    for (int i : order)
+    {
+        out_names_.push_back(names[i]);
+    }
+
+    out_shapes_.clear();
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const cv::Mat &blob = out_blobs_[order[i]];
+        tensor_attr_s attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.index = i;
+        attr.n_dims = 4;
+        for (int d = 0; d < 4; d++)
+        {
+            attr.dims[d] = blob.size[d];
+        }
+        attr.n_elems = blob.total();
+        // 没有校准过的取值范围不能量化，先按 float 输出，Calibrate 之后再切换为 int8
+        attr.type = NN_TENSOR_FLOAT;
+        attr.layout = NN_TENSOR_NCHW;
+        attr.size = attr.n_elems * sizeof(float);
+        attr.zp = 0;
+        attr.scale = 1.f;
+        out_shapes_.push_back(attr);
+    }
+    NN_LOG_INFO("cv dnn engine: input %dx%d, %ld outputs, output type float", input_w_, input_h_, out_shapes_.size());
+    if (output_type_ == NN_TENSOR_INT8)
+    {
+        NN_LOG_INFO("cv dnn engine: int8 output takes effect after Calibrate");
+    }
+    return NN_SUCCESS;
+}
+
+// 回归输出是 4 通道的 DFL 期望，按定义落在 [0, 15]；类别输出是 logit，在灰图上基本都是负数。
+// 类别数不是 4 时按通道数就能区分，是 4 时看探测用的灰图上的取值
+bool CVDnnEngine::IsRegOutput(const cv::Mat &blob)
+{
+    if (blob.size[1] != 4)
+    {
+        return false;
+    }
+    double lo = 0, hi = 0;
+    cv::minMaxLoc(blob.reshape(1, 1), &lo, &hi);
+    return lo >= 0 && hi <= g_reg_max;
+}
+
+// 按取值范围计算非对称量化参数，min 对应 -128，max 对应 127，输出属性切换为 int8
+void CVDnnEngine::SetQuantRange(int index, float min_val, float max_val)
+{
+    tensor_attr_s &attr = out_shapes_[index];
+    attr.type = NN_TENSOR_INT8;
+    attr.size = attr.n_elems;
+    if (max_val - min_val < 1e-6f)
+    {
+        max_val = min_val + 1e-6f;
+    }
+    attr.scale = (max_val - min_val) / 255.f;
+    attr.zp = -128 - (int32_t)roundf(min_val / attr.scale);
+}
+
+// 输入为 input_w_ x input_h_ 的 RGB 图像，模型内没有归一化，与 RKNN 转换时的 mean 0 / std 255 一致
+nn_error_e CVDnnEngine::Forward(const cv::Mat &rgb)
+{
+    try
+    {
+        cv::Mat blob = cv::dnn::blobFromImage(rgb, 1.0 / 255.0);
+        net_.setInput(blob);
+        net_.forward(out_blobs_, out_names_);
+    }
+    catch (const cv::Exception &e)
+    {
+        NN_LOG_ERROR("cv dnn forward fail! %s", e.what());
+        return NN_RKNN_RUNTIME_ERROR;
+    }
+    return NN_SUCCESS;
+}
+
+nn_error_e CVDnnEngine::Calibrate(const std::vector<cv::Mat> &images)
+{
+    if (out_shapes_.empty())
+    {
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    if (output_type_ != NN_TENSOR_INT8)
+    {
+        NN_LOG_WARNING("cv dnn engine: output type is float, calibration is not needed");
+        return NN_SUCCESS;
+    }
+    std::vector<float> min_val(out_shapes_.size(), 0.f);
+    std::vector<float> max_val(out_shapes_.size(), 0.f);
+    bool first = true;
+    for (const auto &img : images)
+    {
+        if (img.rows != input_h_ || img.cols != input_w_ || img.type() != CV_8UC3)
+        {
+            NN_LOG_ERROR("calibration image must be %dx%d RGB", input_w_, input_h_);
+            return NN_RKNN_INPUT_ATTR_ERROR;
+        }
+        auto ret = Forward(img);
+        if (ret != NN_SUCCESS)
+        {
+            return ret;
+        }
+        for (size_t i = 0; i < out_blobs_.size(); i++)
+        {
+            double lo = 0, hi = 0;
+            cv::minMaxLoc(out_blobs_[i].reshape(1, 1), &lo, &hi);
+            min_val[i] = first ? (float)lo : std::min(min_val[i], (float)lo);
+            max_val[i] = first ? (float)hi : std::max(max_val[i], (float)hi);
+        }
+        first = false;
+    }
+    if (first)
+    {
+        return NN_SUCCESS;
+    }
+    for (size_t i = 0; i < out_shapes_.size(); i++)
+    {
+        SetQuantRange(i, min_val[i], max_val[i]);
+        NN_LOG_INFO("output[%ld] range [%.3f, %.3f], zp=%d, scale=%f", i, min_val[i], max_val[i],
+                    out_shapes_[i].zp, out_shapes_[i].scale);
+    }
+    return NN_SUCCESS;
+}
+
+const std::vector<tensor_attr_s> &CVDnnEngine::GetInputShapes()
+{
+    return in_shapes_;
+}
+
+const std::vector<tensor_attr_s> &CVDnnEngine::GetOutputShapes()
+{
+    return out_shapes_;
+}
+
+/**
+ * @brief 运行模型，输出写入 outputs[i].data
+ * @param want_float 为 true 时输出 float，否则按输出类型写入（int8 时用 zp/scale 量化）
+ * @return nn_error_e 错误码
+ */
+nn_error_e CVDnnEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float)
+{
+    if (inputs.size() != in_shapes_.size() || outputs.size() != out_shapes_.size())
+    {
+        NN_LOG_ERROR("inputs/outputs num not match! %ld/%ld", inputs.size(), outputs.size());
+        return NN_IO_NUM_NOT_MATCH;
+    }
+    cv::Mat rgb(input_h_, input_w_, CV_8UC3, inputs[0].data);
+    auto ret = Forward(rgb);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        const tensor_attr_s &attr = out_shapes_[i];
+        const float *src = (const float *)out_blobs_[i].data;
+        outputs[i].attr.index = i;
+        if (want_float || attr.type == NN_TENSOR_FLOAT)
+        {
+            memcpy(outputs[i].data, src, attr.n_elems * sizeof(float));
+            outputs[i].attr.size = attr.n_elems * sizeof(float);
+            continue;
+        }
+        // 量化为 int8，与 RKNN 输出的 zp/scale 含义相同
+        int8_t *dst = (int8_t *)outputs[i].data;
+        float inv_scale = 1.f / attr.scale;
+        for (uint32_t k = 0; k < attr.n_elems; k++)
+        {
+            int q = (int)roundf(src[k] * inv_scale) + attr.zp;
+            dst[k] = (int8_t)std::min(127, std::max(-128, q));
+        }
+        outputs[i].attr.size = attr.n_elems;
+    }
+    return NN_SUCCESS;
+}
+
+// 创建 OpenCV DNN 引擎
+std::shared_ptr<NNEngine> CreateCVDnnEngine()
+{
+    return std::make_shared<CVDnnEngine>();
+}
@@ -0,0 +1,61 @@
+// 基于 OpenCV DNN 的 CPU 推理引擎，用于没有 NPU 的开发机和 CI，也可作为 NPU 满载时的 CPU 备用通道
+
+#ifndef RK3588_DEMO_CV_DNN_ENGINE_H
+#define RK3588_DEMO_CV_DNN_ENGINE_H
+
+#include "engine.h"
+
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/dnn.hpp>
+
+// 加载与 RKNN 模型相同结构导出的 ONNX 模型（输入 RGB，输出按 (回归, 类别) 成对排列）
+// 对外的输入输出张量与 RKEngine 一致：输入 NHWC uint8，输出 NCHW，默认为 float，后处理走浮点解码路径；
+// 要走与 NPU 相同的 int8 解码路径，需设置 int8 输出并用实际图像 Calibrate，之后输出才按 zp/scale 量化
+// 只用合成的同结构 ONNX 模型验证过，尚未在真实的 YOLOv8 导出模型上运行
+class CVDnnEngine : public NNEngine
+{
+public:
+    // ONNX 中拿不到输入大小，由调用者指定，需与导出时一致
+    explicit CVDnnEngine(int input_w = 640, int input_h = 640);
+    ~CVDnnEngine() override;
+
+    nn_error_e LoadModelFile(const char *model_file) override;
+    nn_error_e LoadModelData(std::shared_ptr<MappedModel> model) override;
+    const std::vector<tensor_attr_s> &GetInputShapes() override;
+    const std::vector<tensor_attr_s> &GetOutputShapes() override;
+    nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float) override;
+    // 输出总是写入调用者的缓冲区，拷贝和预分配是同一种方式，不支持借用
+    nn_error_e SetOutputMode(nn_output_mode_e mode) override { return mode == NN_OUTPUT_BORROW ? NN_UNSUPPORTED : NN_SUCCESS; }
+
+    // 输出类型：NN_TENSOR_FLOAT（默认）或 NN_TENSOR_INT8，需在加载模型之前设置
+    // int8 在 Calibrate 之后才生效，此前输出属性仍为 float
+    nn_error_e SetOutputType(tensor_datatype_e type);
+
+    /**
+     * @brief 用实际图像统计每个输出的取值范围，计算 int8 的 zp/scale，并把输出属性切换为 int8
+     * 输出类型为 int8 时才需要调用，且必须在 Yolov8Detection::InitModel 之前，InitModel 按当时的输出属性选择解码路径
+     * @param images 已经缩放到输入大小的 RGB 图像
+     * @return nn_error_e 错误码
+     */
+    nn_error_e Calibrate(const std::vector<cv::Mat> &images);
+
+private:
+    nn_error_e InitNet();
+    nn_error_e Forward(const cv::Mat &rgb);
+    void SetQuantRange(int index, float min_val, float max_val);
+    static bool IsRegOutput(const cv::Mat &blob);
+
+    int input_w_;
+    int input_h_;
+    tensor_datatype_e output_type_ = NN_TENSOR_FLOAT; // 设置的输出类型，int8 在 Calibrate 后生效
+    cv::dnn::Net net_;
+    std::vector<std::string> out_names_; // 按 (回归, 类别) 成对排序后的输出名
+    std::vector<cv::Mat> out_blobs_;     // 最近一次 forward 的输出，与 out_names_ 一一对应
+    std::vector<tensor_attr_s> in_shapes_;
+    std::vector<tensor_attr_s> out_shapes_;
+};
+
+#endif // RK3588_DEMO_CV_DNN_ENGINE_H
@@ -0,0 +1,201 @@
+// NNEngine 中有默认实现的接口
+
+#include "engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+
+#include "model_registry.h"
+#include "utils/logging.h"
+
+// 模拟异步推理的状态，第一次 Submit 时创建
+struct NNEngine::AsyncState
+{
+    struct Request
+    {
+        nn_ticket_t ticket;
+        std::vector<tensor_data_s> *inputs;
+        std::vector<tensor_data_s> *outputs;
+        bool want_float;
+        nn_completion_t done;
+    };
+
+    std::mutex mtx;
+    std::condition_variable work_cond;  // 唤醒工作线程
+    std::condition_variable done_cond;  // 唤醒 Wait
+    std::deque<Request> queue;          // 等待执行的请求
+    std::set<nn_ticket_t> pending;      // 没有回调、还没有完成的请求
+    std::map<nn_ticket_t, nn_error_e> results; // 已完成、等待 Wait 取走的结果
+    bool exit = false;
+    std::thread worker;
+
+    // 请求完成：有回调时调用回调，否则保存结果
+    void Complete(Request &req, nn_error_e ret)
+    {
+        if (req.done)
+        {
+            req.done(req.ticket, ret);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        pending.erase(req.ticket);
+        results[req.ticket] = ret;
+        done_cond.notify_all();
+    }
+};
+
+NNEngine::~NNEngine()
+{
+    StopAsync();
+}
+
+// 默认实现：不支持从内存加载的引擎按路径加载，映射仍然由调用者持有
+nn_error_e NNEngine::LoadModelData(std::shared_ptr<MappedModel> model)
+{
+    return LoadModelFile(model->path().c_str());
+}
+
+nn_ticket_t NNEngine::Submit(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float,
+                             nn_completion_t done)
+{
+    std::shared_ptr<AsyncState> state;
+    {
+        std::lock_guard<std::mutex> lock(async_mtx_);
+        if (async_ == nullptr)
+        {
+            // 工作线程按提交顺序执行，同一个上下文上的 Run 不会并发
+            state = std::make_shared<AsyncState>();
+            state->worker = std::thread([this, state]()
+                                        {
+                while (true)
+                {
+                    AsyncState::Request req;
+                    {
+                        std::unique_lock<std::mutex> lock(state->mtx);
+                        state->work_cond.wait(lock, [&state]()
+                                              { return state->exit || !state->queue.empty(); });
+                        if (state->queue.empty())
+                        {
+                            break;
+                        }
+                        req = std::move(state->queue.front());
+                        state->queue.pop_front();
+                    }
+                    auto ret = Run(*req.inputs, *req.outputs, req.want_float);
+                    state->Complete(req, ret);
+                } });
+            async_ = state;
+        }
+        state = async_;
+    }
+
+    nn_ticket_t ticket = NewTicket();
+    std::lock_guard<std::mutex> lock(state->mtx);
+    if (state->exit)
+    {
+        return 0;
+    }
+    if (!done)
+    {
+        state->pending.insert(ticket);
+    }
+    state->queue.push_back(AsyncState::Request{ticket, &inputs, &outputs, want_float, done});
+    state->work_cond.notify_one();
+    return ticket;
+}
+
+nn_error_e NNEngine::Wait(nn_ticket_t ticket, int timeout_ms)
+{
+    std::shared_ptr<AsyncState> state;
+    {
+        std::lock_guard<std::mutex> lock(async_mtx_);
+        state = async_;
+    }
+    if (state == nullptr)
+    {
+        return NN_INVALID_PARAM;
+    }
+
+    std::unique_lock<std::mutex> lock(state->mtx);
+    auto ready = [&state, ticket]()
+    { return state->results.count(ticket) > 0 || state->pending.count(ticket) == 0; };
+    if (timeout_ms < 0)
+    {
+        state->done_cond.wait(lock, ready);
+    }
+    else if (!state->done_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready))
+    {
+        return NN_TIMEOUT;
+    }
+    auto it = state->results.find(ticket);
+    if (it == state->results.end())
+    {
+        return NN_INVALID_PARAM;
+    }
+    nn_error_e ret = it->second;
+    state->results.erase(it);
+    return ret;
+}
+
+void NNEngine::StopAsync()
+{
+    std::shared_ptr<AsyncState> state;
+    {
+        std::lock_guard<std::mutex> lock(async_mtx_);
+        state = async_;
+        async_ = nullptr;
+    }
+    if (state == nullptr)
+    {
+        return;
+    }
+    std::deque<AsyncState::Request> remaining;
+    {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->exit = true;
+        remaining.swap(state->queue);
+        state->work_cond.notify_all();
+    }
+    state->worker.join();
+    if (!remaining.empty())
+    {
+        NN_LOG_WARNING("engine stopped with %ld async requests not run", remaining.size());
+    }
+    for (auto &req : remaining)
+    {
+        state->Complete(req, NN_STOPED);
+    }
+}
+
+std::shared_ptr<NNEngine> CreateEngine(const char *model_file)
+{
+    const char *ext = strrchr(model_file, '.');
+    if (ext != nullptr && strcasecmp(ext, ".nnrp") == 0)
+    {
+        const char *latency = getenv("NN_REPLAY_LATENCY_US");
+        return CreateReplayEngine(latency != nullptr ? atoi(latency) : 0);
+    }
+    std::shared_ptr<NNEngine> engine;
+    if (ext != nullptr && strcasecmp(ext, ".onnx") == 0)
+    {
+        engine = CreateCVDnnEngine();
+    }
+    else
+    {
+        engine = CreateRKNNEngine();
+    }
+    const char *record_file = getenv("NN_RECORD_FILE");
+    if (record_file != nullptr && record_file[0] != '\0')
+    {
+        engine = CreateRecordEngine(engine, record_file);
+    }
+    return engine;
+}
@@ -6,8 +6,28 @@
 #include "types/error.h"
 #include "types/datatype.h"
 
-#include <vector>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
+
+class MappedModel;
+
+// 异步推理的请求编号，从 1 开始递增，0 表示提交失败
+typedef int64_t nn_ticket_t;
+// 异步推理完成的回调，在完成推理的线程上执行，不能在回调中销毁引擎
+typedef std::function<void(nn_ticket_t ticket, nn_error_e ret)> nn_completion_t;
+
+// 输出张量的绑定方式
+typedef enum
+{
+    NN_OUTPUT_COPY = 0,     // 引擎内部缓冲区拷贝到 outputs[i].data（原始实现），所有引擎都支持
+    NN_OUTPUT_PREALLOC = 1, // 引擎直接写入调用者预先分配的 outputs[i].data，不再拷贝
+    NN_OUTPUT_BORROW = 2,   // Run 把 outputs[i].data 指向引擎的缓冲区，调用 ReleaseOutputs 之前有效
+} nn_output_mode_e;
 
 class NNEngine
 {
@@ -15,14 +35,54 @@ public:
     // 这里全部使用纯虚函数（=0），作用是将NNEngine定义为一个抽象类，不能实例化，只能作为基类使用
     // 具体实现需要在子类中实现，这里的实现只是为了定义接口
     // 用这种方式实现封装，可以使得不同的引擎的接口一致，方便使用；也可以隐藏不同引擎的实现细节，方便维护
-    virtual ~NNEngine(){};                                                                                               // 析构函数
+    virtual ~NNEngine();                                                                                                 // 析构函数
     virtual nn_error_e LoadModelFile(const char *model_file) = 0;                                                        // 加载模型文件，=0表示纯虚函数，必须在子类中实现
     virtual const std::vector<tensor_attr_s> &GetInputShapes() = 0;                                                      // 获取输入张量的形状
     virtual const std::vector<tensor_attr_s> &GetOutputShapes() = 0;                                                     // 获取输出张量的形状
     virtual nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outpus, bool want_float) = 0; // 运行模型
-    
+
+    // 以下接口有默认实现，用于多个上下文共享一份模型（见 model_registry.h）
+    virtual nn_error_e LoadModelData(std::shared_ptr<MappedModel> model); // 从已映射的模型加载，默认按文件路径加载
+    virtual std::shared_ptr<NNEngine> Duplicate() { return nullptr; }     // 复制出共享权重的新上下文，不支持时返回空
+
+    // 设置输出绑定方式，在第一次 Run 之前调用，不支持时返回 NN_UNSUPPORTED，保持原来的方式
+    virtual nn_error_e SetOutputMode(nn_output_mode_e mode) { return mode == NN_OUTPUT_COPY ? NN_SUCCESS : NN_UNSUPPORTED; }
+    // NN_OUTPUT_BORROW 时归还 Run 借出的输出缓冲区，之后 outputs[i].data 置空；其他方式下什么也不做
+    virtual nn_error_e ReleaseOutputs(std::vector<tensor_data_s> &outputs) { return NN_SUCCESS; }
+
+    /**
+     * @brief 异步提交一次推理，立即返回请求编号
+     * 默认实现用每个引擎一个工作线程按提交顺序调用 Run 来模拟，支持原生异步的引擎可以重写
+     * inputs、outputs 在完成之前必须保持有效且不能修改
+     * @param done 完成回调，为空时需要用 Wait 取结果；带回调的请求结果只交给回调，不能 Wait
+     * @return nn_ticket_t 请求编号，失败时返回 0
+     */
+    virtual nn_ticket_t Submit(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float,
+                               nn_completion_t done = nullptr);
+    // 等待 Submit 的请求完成，timeout_ms < 0 表示一直等待；每个请求只能 Wait 一次
+    // 超时返回 NN_TIMEOUT，请求编号无效（已经取过结果或带回调）返回 NN_INVALID_PARAM
+    virtual nn_error_e Wait(nn_ticket_t ticket, int timeout_ms = -1);
+
+protected:
+    nn_ticket_t NewTicket() { return next_ticket_.fetch_add(1); }
+    // 停止模拟异步的工作线程，未执行的请求以 NN_STOPED 完成
+    // 工作线程会调用派生类的 Run，派生类析构时必须先调用
+    void StopAsync();
+
+private:
+    struct AsyncState;
+    std::atomic<nn_ticket_t> next_ticket_{1};
+    std::mutex async_mtx_; // 保护 async_ 的创建和销毁
+    std::shared_ptr<AsyncState> async_;
 };
 
-std::shared_ptr<NNEngine> CreateRKNNEngine(); // 创建RKNN引擎
+std::shared_ptr<NNEngine> CreateRKNNEngine();  // 创建RKNN引擎
+std::shared_ptr<NNEngine> CreateCVDnnEngine(); // 创建 OpenCV DNN 引擎（CPU）
+std::shared_ptr<NNEngine> CreateReplayEngine(int latency_us = 0); // 创建回放引擎，模型文件为录制文件（.nnrp）
+// 包装 inner，每次推理的输入哈希和输出张量写入 record_file，供回放引擎使用
+std::shared_ptr<NNEngine> CreateRecordEngine(std::shared_ptr<NNEngine> inner, const char *record_file);
+// 按模型文件扩展名创建引擎：.onnx 使用 OpenCV DNN，.nnrp 回放录制文件，其他使用 RKNN
+// 环境变量 NN_RECORD_FILE 非空时录制真实引擎的输出；NN_REPLAY_LATENCY_US 设置回放时每次推理的耗时
+std::shared_ptr<NNEngine> CreateEngine(const char *model_file);
 
 #endif // RK3588_DEMO_ENGINE_H
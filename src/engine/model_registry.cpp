@@ -0,0 +1,192 @@
+#include "model_registry.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "utils/logging.h"
+
+MappedModel::~MappedModel()
+{
+    if (data_ != nullptr)
+    {
+        munmap(data_, size_);
+    }
+}
+
+std::shared_ptr<MappedModel> MappedModel::Open(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        NN_LOG_ERROR("open %s fail!", path.c_str());
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        NN_LOG_ERROR("model file %s is empty", path.c_str());
+        close(fd);
+        return nullptr;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // 映射建立后文件描述符可以关闭
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        NN_LOG_ERROR("mmap %s fail!", path.c_str());
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedModel> model(new MappedModel());
+    model->data_ = data;
+    model->size_ = st.st_size;
+    model->path_ = path;
+    return model;
+}
+
+std::shared_ptr<MappedModel> ModelRegistry::Map(const std::string &path)
+{
+    // 只保存弱引用，所有上下文都释放后映射随之解除
+    static std::mutex mtx;
+    static std::map<std::string, std::weak_ptr<MappedModel>> models;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto model = models[path].lock();
+    if (model == nullptr)
+    {
+        model = MappedModel::Open(path);
+        if (model != nullptr)
+        {
+            models[path] = model;
+            NN_LOG_INFO("model %s mapped, %ld bytes", path.c_str(), model->size());
+        }
+    }
+    return model;
+}
+
+nn_error_e ModelRegistry::CreateContexts(const std::string &path, int num, const engine_creator_t &creator,
+                                         std::vector<std::shared_ptr<NNEngine>> &engines)
+{
+    engines.clear();
+    if (num <= 0)
+    {
+        return NN_SUCCESS;
+    }
+    auto model = Map(path);
+    if (model == nullptr)
+    {
+        return NN_LOAD_MODEL_FAIL;
+    }
+
+    auto create = [&creator, &path]() { return creator ? creator() : CreateEngine(path.c_str()); };
+    auto start = std::chrono::steady_clock::now();
+    long rss_before = GetProcessRssKB();
+
+    // 第一个上下文完整加载模型
+    engines.resize(num);
+    engines[0] = create();
+    if (engines[0] == nullptr)
+    {
+        NN_LOG_ERROR("create engine for %s fail", path.c_str());
+        engines.clear();
+        return NN_LOAD_MODEL_FAIL;
+    }
+    auto ret = engines[0]->LoadModelData(model);
+    if (ret != NN_SUCCESS)
+    {
+        engines.clear();
+        return ret;
+    }
+    auto first_done = std::chrono::steady_clock::now();
+    long rss_first = GetProcessRssKB();
+
+    // 复制都以第一个上下文为源（rknn_dup_context），不保证可以并发，在当前线程上依次进行
+    int shared_num = 0;
+    for (int i = 1; i < num; i++)
+    {
+        engines[i] = engines[0]->Duplicate();
+        if (engines[i] != nullptr)
+        {
+            shared_num++;
+        }
+    }
+
+    // 不支持复制时各自完整加载，互不相关，在多个线程上并行，每个线程只写自己的下标
+    std::vector<nn_error_e> results(num, NN_SUCCESS);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num; i++)
+    {
+        if (engines[i] != nullptr)
+        {
+            continue;
+        }
+        threads.emplace_back([&, i]()
+                             {
+            auto engine = create();
+            if (engine == nullptr)
+            {
+                results[i] = NN_LOAD_MODEL_FAIL;
+                return;
+            }
+            results[i] = engine->LoadModelData(model);
+            engines[i] = engine; });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    for (int i = 1; i < num; i++)
+    {
+        if (results[i] != NN_SUCCESS)
+        {
+            NN_LOG_ERROR("create context %d fail, ret=%d", i, results[i]);
+            engines.clear();
+            return results[i];
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    long rss_after = GetProcessRssKB();
+    double first_ms = std::chrono::duration<double, std::milli>(first_done - start).count();
+    double total_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    NN_LOG_INFO("model %s: %d contexts (%d share weights) in %.1f ms, first context %.1f ms",
+                path.c_str(), num, shared_num, total_ms, first_ms);
+    if (rss_before >= 0 && rss_after >= 0)
+    {
+        NN_LOG_INFO("model %s: RSS %ld KB -> %ld KB, first context +%ld KB, each other context +%ld KB",
+                    path.c_str(), rss_before, rss_after, rss_first - rss_before,
+                    num > 1 ? (rss_after - rss_first) / (num - 1) : 0);
+    }
+    return NN_SUCCESS;
+}
+
+long GetProcessRssKB()
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp == nullptr)
+    {
+        return -1;
+    }
+    long rss = -1;
+    char line[128];
+    while (fgets(line, sizeof(line), fp) != nullptr)
+    {
+        if (strncmp(line, "VmRSS:", 6) == 0)
+        {
+            rss = strtol(line + 6, nullptr, 10);
+            break;
+        }
+    }
+    fclose(fp);
+    return rss;
+}
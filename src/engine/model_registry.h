@@ -0,0 +1,66 @@
+// 模型注册表：模型文件只映射一次，多个推理上下文共享权重
+
+#ifndef RK3588_DEMO_MODEL_REGISTRY_H
+#define RK3588_DEMO_MODEL_REGISTRY_H
+
+#include <stddef.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+
+// 只读映射的模型文件，最后一个引用释放时解除映射
+// 使用 MAP_PRIVATE 映射，同一个文件的多个进程、多个上下文共用页缓存，不再为每个上下文 malloc 一份
+class MappedModel
+{
+public:
+    ~MappedModel();
+
+    MappedModel(const MappedModel &) = delete;
+    MappedModel &operator=(const MappedModel &) = delete;
+
+    // 映射失败时返回空
+    static std::shared_ptr<MappedModel> Open(const std::string &path);
+
+    // rknn_init 的参数不是 const，映射为可写的私有页，不会写回文件
+    void *data() const { return data_; }
+    size_t size() const { return size_; }
+    const std::string &path() const { return path_; }
+
+private:
+    MappedModel() = default;
+
+    void *data_ = nullptr;
+    size_t size_ = 0;
+    std::string path_;
+};
+
+typedef std::function<std::shared_ptr<NNEngine>()> engine_creator_t;
+
+class ModelRegistry
+{
+public:
+    // 按路径取得映射后的模型，已经映射且仍在使用时直接返回同一个映射
+    static std::shared_ptr<MappedModel> Map(const std::string &path);
+
+    /**
+     * @brief 加载一次模型，创建 num 个共享权重的推理上下文
+     * 第一个上下文完整加载模型，其余上下文由它依次复制（NNEngine::Duplicate）；
+     * 引擎不支持复制时退回用同一个映射独立加载，这些加载在多个线程上并行
+     * @param path 模型文件路径
+     * @param num 上下文数量
+     * @param creator 创建引擎，为空时按扩展名选择（CreateEngine）
+     * @param engines 输出已加载模型的引擎
+     * @return nn_error_e 错误码
+     */
+    static nn_error_e CreateContexts(const std::string &path, int num, const engine_creator_t &creator,
+                                     std::vector<std::shared_ptr<NNEngine>> &engines);
+};
+
+// 当前进程的常驻内存（VmRSS），单位 KB，读取失败时返回 -1
+long GetProcessRssKB();
+
+#endif // RK3588_DEMO_MODEL_REGISTRY_H
@@ -0,0 +1,421 @@
+// replay_engine.h的实现
+
+#include "replay_engine.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include "model_registry.h"
+#include "utils/logging.h"
+
+static const char g_replay_magic[4] = {'N', 'N', 'R', 'P'};
+static const uint32_t g_replay_version = 1;
+
+static size_t AlignUp8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+// 所有输入张量内容的 FNV-1a 哈希，按 8 字节一组计算，640x640 的输入约 0.15 ms
+static uint64_t HashInputs(const std::vector<tensor_data_s> &inputs)
+{
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t h = 14695981039346656037ULL;
+    for (const auto &input : inputs)
+    {
+        const uint8_t *p = (const uint8_t *)input.data;
+        size_t n = input.attr.size;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, p + i, 8);
+            h = (h ^ word) * prime;
+        }
+        for (; i < n; i++)
+        {
+            h = (h ^ p[i]) * prime;
+        }
+        h = (h ^ n) * prime;
+    }
+    return h;
+}
+
+// 录制文件的写入端，同一路径的多个 RecordEngine 共用，记录整条写入不会交错
+class ReplayWriter
+{
+public:
+    ~ReplayWriter()
+    {
+        if (fp_ != nullptr)
+        {
+            fclose(fp_);
+            NN_LOG_INFO("record file %s closed, %lu records", path_.c_str(), (unsigned long)records_);
+        }
+    }
+
+    // 第一次打开时写入文件头，之后同一路径的输入输出属性必须一致
+    static std::shared_ptr<ReplayWriter> Get(const std::string &path, const std::vector<tensor_attr_s> &in_shapes,
+                                             const std::vector<tensor_attr_s> &out_shapes)
+    {
+        static std::mutex mtx;
+        static std::map<std::string, std::weak_ptr<ReplayWriter>> writers;
+
+        std::lock_guard<std::mutex> lock(mtx);
+        auto writer = writers[path].lock();
+        if (writer != nullptr)
+        {
+            if (writer->output_num_ != out_shapes.size())
+            {
+                NN_LOG_ERROR("record file %s: output num %ld not match %u", path.c_str(), out_shapes.size(),
+                             writer->output_num_);
+                return nullptr;
+            }
+            return writer;
+        }
+
+        FILE *fp = fopen(path.c_str(), "wb");
+        if (fp == nullptr)
+        {
+            NN_LOG_ERROR("open record file %s fail!", path.c_str());
+            return nullptr;
+        }
+        ReplayFileHeader header;
+        memcpy(header.magic, g_replay_magic, sizeof(header.magic));
+        header.version = g_replay_version;
+        header.input_num = in_shapes.size();
+        header.output_num = out_shapes.size();
+        fwrite(&header, sizeof(header), 1, fp);
+        fwrite(in_shapes.data(), sizeof(tensor_attr_s), in_shapes.size(), fp);
+        fwrite(out_shapes.data(), sizeof(tensor_attr_s), out_shapes.size(), fp);
+        WritePadding(fp, sizeof(header) + sizeof(tensor_attr_s) * (in_shapes.size() + out_shapes.size()));
+
+        writer = std::shared_ptr<ReplayWriter>(new ReplayWriter(fp, path, header.output_num));
+        writers[path] = writer;
+        NN_LOG_INFO("recording engine outputs to %s", path.c_str());
+        return writer;
+    }
+
+    nn_error_e Append(uint64_t input_hash, bool want_float, const std::vector<tensor_data_s> &outputs)
+    {
+        ReplayRecordHeader header;
+        header.input_hash = input_hash;
+        header.want_float = want_float ? 1 : 0;
+        header.output_num = outputs.size();
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        bool ok = fwrite(&header, sizeof(header), 1, fp_) == 1;
+        for (const auto &output : outputs)
+        {
+            uint32_t size[2] = {output.attr.size, 0};
+            ok = ok && fwrite(size, sizeof(size), 1, fp_) == 1;
+            ok = ok && fwrite(output.data, 1, output.attr.size, fp_) == output.attr.size;
+            ok = ok && WritePadding(fp_, output.attr.size);
+        }
+        if (!ok)
+        {
+            NN_LOG_ERROR("write record file %s fail!", path_.c_str());
+            return NN_RKNN_RUNTIME_ERROR;
+        }
+        records_++;
+        return NN_SUCCESS;
+    }
+
+private:
+    ReplayWriter(FILE *fp, const std::string &path, uint32_t output_num)
+        : fp_(fp), path_(path), output_num_(output_num) {}
+
+    // 补齐到 8 字节
+    static bool WritePadding(FILE *fp, size_t written)
+    {
+        static const uint8_t zeros[8] = {0};
+        size_t pad = AlignUp8(written) - written;
+        return pad == 0 || fwrite(zeros, 1, pad, fp) == pad;
+    }
+
+    std::mutex mtx_;
+    FILE *fp_;
+    std::string path_;
+    uint32_t output_num_;
+    uint64_t records_ = 0;
+};
+
+RecordEngine::RecordEngine(std::shared_ptr<NNEngine> inner, const std::string &record_file)
+    : inner_(inner), record_file_(record_file) {}
+
+RecordEngine::~RecordEngine()
+{
+    // 模拟异步的线程会调用 Run，必须在写入端释放前停止
+    StopAsync();
+}
+
+nn_error_e RecordEngine::OpenWriter()
+{
+    writer_ = ReplayWriter::Get(record_file_, inner_->GetInputShapes(), inner_->GetOutputShapes());
+    return writer_ == nullptr ? NN_LOAD_MODEL_FAIL : NN_SUCCESS;
+}
+
+nn_error_e RecordEngine::LoadModelFile(const char *model_file)
+{
+    auto ret = inner_->LoadModelFile(model_file);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    return OpenWriter();
+}
+
+nn_error_e RecordEngine::LoadModelData(std::shared_ptr<MappedModel> model)
+{
+    auto ret = inner_->LoadModelData(model);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    return OpenWriter();
+}
+
+// 输入哈希在推理前计算，避免引擎在 Run 中修改输入缓冲区
+nn_error_e RecordEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float)
+{
+    if (writer_ == nullptr)
+    {
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    uint64_t hash = HashInputs(inputs);
+    auto ret = inner_->Run(inputs, outputs, want_float);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    return writer_->Append(hash, want_float, outputs);
+}
+
+std::shared_ptr<NNEngine> RecordEngine::Duplicate()
+{
+    auto inner = inner_->Duplicate();
+    if (inner == nullptr)
+    {
+        return nullptr;
+    }
+    auto engine = std::make_shared<RecordEngine>(inner, record_file_);
+    engine->writer_ = writer_;
+    return engine;
+}
+
+ReplayEngine::ReplayEngine(int latency_us) : latency_us_(latency_us) {}
+
+ReplayEngine::~ReplayEngine()
+{
+    StopAsync();
+}
+
+nn_error_e ReplayEngine::LoadModelFile(const char *model_file)
+{
+    auto file = ModelRegistry::Map(model_file);
+    if (file == nullptr)
+    {
+        NN_LOG_ERROR("load replay file %s fail!", model_file);
+        return NN_LOAD_MODEL_FAIL;
+    }
+    return LoadModelData(file);
+}
+
+// 解析录制文件，建立记录索引；文件尾部不完整的记录（录制时被中断）直接丢弃
+nn_error_e ReplayEngine::LoadModelData(std::shared_ptr<MappedModel> model)
+{
+    const uint8_t *base = (const uint8_t *)model->data();
+    size_t size = model->size();
+    ReplayFileHeader header;
+    if (size < sizeof(header))
+    {
+        NN_LOG_ERROR("replay file %s too small", model->path().c_str());
+        return NN_LOAD_MODEL_FAIL;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, g_replay_magic, sizeof(header.magic)) != 0 || header.version != g_replay_version)
+    {
+        NN_LOG_ERROR("replay file %s: bad magic or version %u", model->path().c_str(), header.version);
+        return NN_LOAD_MODEL_FAIL;
+    }
+    size_t offset = sizeof(header);
+    size_t attr_bytes = sizeof(tensor_attr_s) * ((size_t)header.input_num + header.output_num);
+    if (size < offset + attr_bytes)
+    {
+        NN_LOG_ERROR("replay file %s: truncated header", model->path().c_str());
+        return NN_LOAD_MODEL_FAIL;
+    }
+
+    auto index = std::make_shared<ReplayIndex>();
+    index->file = model;
+    const tensor_attr_s *attrs = (const tensor_attr_s *)(base + offset);
+    index->in_shapes.assign(attrs, attrs + header.input_num);
+    index->out_shapes.assign(attrs + header.input_num, attrs + header.input_num + header.output_num);
+    offset = AlignUp8(offset + attr_bytes);
+
+    while (offset + sizeof(ReplayRecordHeader) <= size)
+    {
+        ReplayRecordHeader record;
+        memcpy(&record, base + offset, sizeof(record));
+        if (record.output_num != header.output_num)
+        {
+            break;
+        }
+        size_t next = offset + sizeof(record);
+        uint32_t k = 0;
+        for (; k < record.output_num && next + 8 <= size; k++)
+        {
+            uint32_t bytes;
+            memcpy(&bytes, base + next, sizeof(bytes));
+            next = AlignUp8(next + 8 + bytes);
+        }
+        if (k < record.output_num || next > size)
+        {
+            break;
+        }
+        index->by_hash.emplace(record.input_hash, index->records.size());
+        index->records.push_back(base + offset);
+        offset = next;
+    }
+    if (index->records.empty())
+    {
+        NN_LOG_ERROR("replay file %s has no records", model->path().c_str());
+        return NN_LOAD_MODEL_FAIL;
+    }
+    if (offset != size)
+    {
+        NN_LOG_WARNING("replay file %s: %ld trailing bytes ignored", model->path().c_str(), size - offset);
+    }
+    NN_LOG_INFO("replay file %s: %ld records, %ld unique inputs, latency %d us", model->path().c_str(),
+                index->records.size(), index->by_hash.size(), latency_us_);
+    index_ = index;
+    return NN_SUCCESS;
+}
+
+const std::vector<tensor_attr_s> &ReplayEngine::GetInputShapes()
+{
+    static const std::vector<tensor_attr_s> empty;
+    return index_ == nullptr ? empty : index_->in_shapes;
+}
+
+const std::vector<tensor_attr_s> &ReplayEngine::GetOutputShapes()
+{
+    static const std::vector<tensor_attr_s> empty;
+    return index_ == nullptr ? empty : index_->out_shapes;
+}
+
+/**
+ * @brief 回放一次推理
+ * 输入哈希命中时返回对应的录制输出，否则按顺序循环取下一条，保证同样的输入序列得到同样的输出序列
+ * 耗时补足到 latency_us，模拟真实推理的时间
+ * @param want_float 必须与录制时一致
+ * @return nn_error_e 错误码
+ */
+nn_error_e ReplayEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (index_ == nullptr)
+    {
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    if (inputs.size() != index_->in_shapes.size() || outputs.size() != index_->out_shapes.size())
+    {
+        NN_LOG_ERROR("inputs/outputs num not match! %ld/%ld", inputs.size(), outputs.size());
+        return NN_IO_NUM_NOT_MATCH;
+    }
+
+    size_t pick;
+    auto it = index_->by_hash.find(HashInputs(inputs));
+    if (it != index_->by_hash.end())
+    {
+        pick = it->second;
+        hit_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        pick = next_.fetch_add(1, std::memory_order_relaxed) % index_->records.size();
+        miss_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const uint8_t *p = index_->records[pick];
+    ReplayRecordHeader record;
+    memcpy(&record, p, sizeof(record));
+    if ((record.want_float != 0) != want_float)
+    {
+        NN_LOG_ERROR("replay record want_float=%u, but run with want_float=%d", record.want_float, want_float);
+        return NN_UNSUPPORTED;
+    }
+    p += sizeof(record);
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        uint32_t bytes;
+        memcpy(&bytes, p, sizeof(bytes));
+        const uint8_t *data = p + 8;
+        outputs[i].attr.index = i;
+        if (output_mode_ == NN_OUTPUT_BORROW)
+        {
+            outputs[i].data = (void *)data;
+        }
+        else
+        {
+            if (outputs[i].attr.size != 0 && outputs[i].attr.size < bytes)
+            {
+                NN_LOG_ERROR("output[%ld] buffer %u bytes, record has %u", i, outputs[i].attr.size, bytes);
+                return NN_RKNN_OUTPUT_ATTR_ERROR;
+            }
+            memcpy(outputs[i].data, data, bytes);
+        }
+        outputs[i].attr.size = bytes;
+        p = data + AlignUp8(bytes);
+    }
+
+    if (latency_us_ > 0)
+    {
+        std::this_thread::sleep_until(start + std::chrono::microseconds(latency_us_));
+    }
+    return NN_SUCCESS;
+}
+
+// 复制出的上下文共用同一份索引和映射
+std::shared_ptr<NNEngine> ReplayEngine::Duplicate()
+{
+    if (index_ == nullptr)
+    {
+        return nullptr;
+    }
+    auto engine = std::make_shared<ReplayEngine>(latency_us_);
+    engine->index_ = index_;
+    return engine;
+}
+
+nn_error_e ReplayEngine::SetOutputMode(nn_output_mode_e mode)
+{
+    output_mode_ = mode;
+    return NN_SUCCESS;
+}
+
+// 借出的是映射中的数据，不需要归还，只把指针置空
+nn_error_e ReplayEngine::ReleaseOutputs(std::vector<tensor_data_s> &outputs)
+{
+    if (output_mode_ == NN_OUTPUT_BORROW)
+    {
+        for (auto &output : outputs)
+        {
+            output.data = nullptr;
+        }
+    }
+    return NN_SUCCESS;
+}
+
+std::shared_ptr<NNEngine> CreateReplayEngine(int latency_us)
+{
+    return std::make_shared<ReplayEngine>(latency_us);
+}
+
+std::shared_ptr<NNEngine> CreateRecordEngine(std::shared_ptr<NNEngine> inner, const char *record_file)
+{
+    return std::make_shared<RecordEngine>(inner, record_file);
+}
@@ -0,0 +1,105 @@
+// 录制 / 回放引擎：录制真实推理的输出张量，在没有 NPU 的机器上按录制结果回放，用于可复现的端到端测试
+
+#ifndef RK3588_DEMO_REPLAY_ENGINE_H
+#define RK3588_DEMO_REPLAY_ENGINE_H
+
+#include "engine.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 录制文件格式（小端，所有数据块按 8 字节对齐，回放时可以直接借出映射中的数据）：
+//   文件头 ReplayFileHeader，之后是 input_num 个输入属性和 output_num 个输出属性（tensor_attr_s）
+//   每帧一条记录：ReplayRecordHeader，之后 output_num 个 [uint32 大小, uint32 保留, 数据, 填充]
+struct ReplayFileHeader
+{
+    char magic[4]; // "NNRP"
+    uint32_t version;
+    uint32_t input_num;
+    uint32_t output_num;
+};
+
+struct ReplayRecordHeader
+{
+    uint64_t input_hash; // 所有输入张量内容的哈希
+    uint32_t want_float; // 录制时的 want_float
+    uint32_t output_num;
+};
+
+class MappedModel;
+class ReplayWriter;
+
+// 包装真实引擎，每次 Run 之后把输入哈希和输出张量追加到录制文件
+// 同一个文件可以被多个上下文共用，记录之间的顺序不重要，回放按输入哈希查找
+class RecordEngine : public NNEngine
+{
+public:
+    RecordEngine(std::shared_ptr<NNEngine> inner, const std::string &record_file);
+    ~RecordEngine() override;
+
+    nn_error_e LoadModelFile(const char *model_file) override;
+    nn_error_e LoadModelData(std::shared_ptr<MappedModel> model) override;
+    const std::vector<tensor_attr_s> &GetInputShapes() override { return inner_->GetInputShapes(); }
+    const std::vector<tensor_attr_s> &GetOutputShapes() override { return inner_->GetOutputShapes(); }
+    nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float) override;
+    std::shared_ptr<NNEngine> Duplicate() override;
+    nn_error_e SetOutputMode(nn_output_mode_e mode) override { return inner_->SetOutputMode(mode); }
+    nn_error_e ReleaseOutputs(std::vector<tensor_data_s> &outputs) override { return inner_->ReleaseOutputs(outputs); }
+
+private:
+    nn_error_e OpenWriter();
+
+    std::shared_ptr<NNEngine> inner_;
+    std::string record_file_;
+    std::shared_ptr<ReplayWriter> writer_;
+};
+
+// 回放录制文件：按输入哈希查找记录，找不到时按顺序循环回放，并模拟推理耗时
+// 模型文件就是录制文件（.nnrp），通过 ModelRegistry 映射，多个上下文共用一个映射
+class ReplayEngine : public NNEngine
+{
+public:
+    explicit ReplayEngine(int latency_us = 0);
+    ~ReplayEngine() override;
+
+    nn_error_e LoadModelFile(const char *model_file) override;
+    nn_error_e LoadModelData(std::shared_ptr<MappedModel> model) override;
+    const std::vector<tensor_attr_s> &GetInputShapes() override;
+    const std::vector<tensor_attr_s> &GetOutputShapes() override;
+    nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float) override;
+    std::shared_ptr<NNEngine> Duplicate() override;
+    // 三种输出方式都支持，借用时输出直接指向映射中的数据
+    nn_error_e SetOutputMode(nn_output_mode_e mode) override;
+    nn_error_e ReleaseOutputs(std::vector<tensor_data_s> &outputs) override;
+
+    void SetLatency(int latency_us) { latency_us_ = latency_us; }
+    uint64_t GetHitCount() const { return hit_count_.load(std::memory_order_relaxed); }   // 按哈希命中的次数
+    uint64_t GetMissCount() const { return miss_count_.load(std::memory_order_relaxed); } // 没有命中、按顺序回放的次数
+
+private:
+    // 解析后的录制文件，多个上下文共用
+    struct ReplayIndex
+    {
+        std::shared_ptr<MappedModel> file;
+        std::vector<tensor_attr_s> in_shapes;
+        std::vector<tensor_attr_s> out_shapes;
+        std::vector<const uint8_t *> records;                  // 每条记录的 ReplayRecordHeader
+        std::unordered_map<uint64_t, size_t> by_hash;          // 输入哈希 -> 记录下标，重复的哈希保留第一条
+    };
+
+    int latency_us_;
+    nn_output_mode_e output_mode_ = NN_OUTPUT_COPY;
+    std::shared_ptr<const ReplayIndex> index_;
+    std::atomic<uint64_t> next_{0};
+    std::atomic<uint64_t> hit_count_{0};
+    std::atomic<uint64_t> miss_count_{0};
+};
+
+#endif // RK3588_DEMO_REPLAY_ENGINE_H
@@ -8,22 +8,38 @@
 #include "utils/logging.h"
 
 static const int g_max_io_num = 10; // 最大输入输出张量的数量
+static const int g_wait_forever_ms = 60 * 1000; // rknn_wait 不限时等待时使用的超时时间
 
 /**
  * @brief 加载模型文件、初始化rknn context、获取rknn版本信息、获取输入输出张量的信息
+ * 模型文件通过 ModelRegistry 映射，同一个文件只映射一次
  * @param model_file 模型文件路径
  * @return nn_error_e 错误码
  */
 nn_error_e RKEngine::LoadModelFile(const char *model_file)
 {
-    int model_len = 0;                               // 模型文件大小
-    auto model = load_model(model_file, &model_len); // 加载模型文件
+    auto model = ModelRegistry::Map(model_file); // 映射模型文件
     if (model == nullptr)
     {
         NN_LOG_ERROR("load model file %s fail!", model_file);
         return NN_LOAD_MODEL_FAIL; // 返回错误码：加载模型文件失败
     }
-    int ret = rknn_init(&rknn_ctx_, model, model_len, 0, NULL); // 初始化rknn context
+    return LoadModelData(model);
+}
+
+/**
+ * @brief 用已映射的模型初始化rknn context
+ * @param model 映射后的模型
+ * @return nn_error_e 错误码
+ */
+nn_error_e RKEngine::LoadModelData(std::shared_ptr<MappedModel> model)
+{
+    if (ctx_created_)
+    {
+        NN_LOG_ERROR("rknn context already created!");
+        return NN_RKNN_INIT_FAIL;
+    }
+    int ret = rknn_init(&rknn_ctx_, model->data(), (uint32_t)model->size(), 0, NULL); // 初始化rknn context
     if (ret < 0)
     {
         NN_LOG_ERROR("rknn_init fail! ret=%d", ret);
@@ -32,10 +48,53 @@ nn_error_e RKEngine::LoadModelFile(const char *model_file)
     // 打印初始化成功信息
     NN_LOG_INFO("rknn_init success!");
     ctx_created_ = true;
+    model_ = model;
+    return QueryModel();
+}
 
+/**
+ * @brief 复制出一个共享权重的rknn context，权重只在第一个context中占用内存
+ * 优先使用 rknn_dup_context，失败时用 RKNN_FLAG_SHARE_WEIGHT_MEM 重新初始化
+ * @return std::shared_ptr<NNEngine> 新的引擎，失败时返回空
+ */
+std::shared_ptr<NNEngine> RKEngine::Duplicate()
+{
+    if (!ctx_created_)
+    {
+        return nullptr;
+    }
+    auto engine = std::make_shared<RKEngine>();
+    int ret = rknn_dup_context(&rknn_ctx_, &engine->rknn_ctx_);
+    if (ret < 0)
+    {
+        NN_LOG_WARNING("rknn_dup_context fail! ret=%d, try RKNN_FLAG_SHARE_WEIGHT_MEM", ret);
+        rknn_init_extend extend;
+        memset(&extend, 0, sizeof(extend));
+        extend.ctx = rknn_ctx_;
+        ret = rknn_init(&engine->rknn_ctx_, model_->data(), (uint32_t)model_->size(), RKNN_FLAG_SHARE_WEIGHT_MEM, &extend);
+        if (ret < 0)
+        {
+            NN_LOG_ERROR("rknn_init with shared weight fail! ret=%d", ret);
+            return nullptr;
+        }
+    }
+    engine->ctx_created_ = true;
+    engine->model_ = model_;
+    engine->output_mode_ = output_mode_;
+    // 复制的context与原context的输入输出属性相同
+    engine->input_num_ = input_num_;
+    engine->output_num_ = output_num_;
+    engine->in_shapes_ = in_shapes_;
+    engine->out_shapes_ = out_shapes_;
+    return engine;
+}
+
+// 查询rknn版本信息和输入输出张量的信息
+nn_error_e RKEngine::QueryModel()
+{
     // 获取rknn版本信息
     rknn_sdk_version version;
-    ret = rknn_query(rknn_ctx_, RKNN_QUERY_SDK_VERSION, &version, sizeof(rknn_sdk_version));
+    int ret = rknn_query(rknn_ctx_, RKNN_QUERY_SDK_VERSION, &version, sizeof(rknn_sdk_version));
     if (ret < 0)
     {
         NN_LOG_ERROR("rknn_query fail! ret=%d", ret);
@@ -58,6 +117,8 @@ nn_error_e RKEngine::LoadModelFile(const char *model_file)
     // 保存输入输出个数
     input_num_ = io_num.n_input;
     output_num_ = io_num.n_output;
+    in_shapes_.clear();
+    out_shapes_.clear();
 
     // 输入属性
     NN_LOG_INFO("input tensors:");
@@ -118,6 +179,24 @@ const std::vector<tensor_attr_s> &RKEngine::GetOutputShapes()
  * @return nn_error_e 错误码
  */
 nn_error_e RKEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float)
+{
+    std::lock_guard<std::mutex> lock(ctx_mtx_);
+    // 先收取 Submit 还在执行的请求，上下文同时只能执行一个请求
+    FinishInFlight(-1);
+    auto ret = StartRun(inputs, outputs, false, nullptr);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    return GetOutputs(outputs, want_float);
+}
+
+/**
+ * @brief 设置输入并开始推理，调用时已持有 ctx_mtx_
+ * @param non_block 为 true 时不等待推理完成，frame_id 返回本次推理的帧号，之后用 rknn_wait 等待
+ * @return nn_error_e 错误码
+ */
+nn_error_e RKEngine::StartRun(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool non_block, uint64_t *frame_id)
 {
     // 检查输入输出张量的数量是否匹配
     if (inputs.size() != input_num_)
@@ -147,21 +226,44 @@ nn_error_e RKEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_
 
     // 推理
     NN_LOG_DEBUG("rknn running...");
-    ret = rknn_run(rknn_ctx_, nullptr);
+    rknn_run_extend extend;
+    memset(&extend, 0, sizeof(extend));
+    extend.non_block = non_block ? 1 : 0;
+    ret = rknn_run(rknn_ctx_, non_block ? &extend : nullptr);
     if (ret < 0)
     {
         NN_LOG_ERROR("rknn_run fail! ret=%d", ret);
         return NN_RKNN_RUNTIME_ERROR;
     }
+    if (frame_id != nullptr)
+    {
+        *frame_id = extend.frame_id;
+    }
+    return NN_SUCCESS;
+}
 
+/**
+ * @brief 取得推理结果，按输出绑定方式拷贝、直接写入或借出缓冲区，调用时已持有 ctx_mtx_
+ * @return nn_error_e 错误码
+ */
+nn_error_e RKEngine::GetOutputs(std::vector<tensor_data_s> &outputs, bool want_float)
+{
     // 获得输出
     rknn_output rknn_outputs[g_max_io_num];
     memset(rknn_outputs, 0, sizeof(rknn_outputs));
     for (int i = 0; i < output_num_; ++i)
     {
         rknn_outputs[i].want_float = want_float ? 1 : 0;
+        if (output_mode_ == NN_OUTPUT_PREALLOC)
+        {
+            // 运行时直接写入调用者的缓冲区，大小必须与 want_float 对应的输出大小一致
+            rknn_outputs[i].is_prealloc = 1;
+            rknn_outputs[i].index = i;
+            rknn_outputs[i].buf = outputs[i].data;
+            rknn_outputs[i].size = outputs[i].attr.size;
+        }
     }
-    ret = rknn_outputs_get(rknn_ctx_, output_num_, rknn_outputs, NULL);
+    int ret = rknn_outputs_get(rknn_ctx_, output_num_, rknn_outputs, NULL);
     if (ret < 0)
     {
         printf("rknn_outputs_get fail! ret=%d\n", ret);
@@ -170,6 +272,28 @@ nn_error_e RKEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_
     }
 
     NN_LOG_DEBUG("output num: %d", output_num_);
+    if (output_mode_ == NN_OUTPUT_PREALLOC)
+    {
+        // 数据已经在调用者的缓冲区中
+        for (int i = 0; i < output_num_; ++i)
+        {
+            outputs[i].attr.index = rknn_outputs[i].index;
+            outputs[i].attr.size = rknn_outputs[i].size;
+        }
+        rknn_outputs_release(rknn_ctx_, output_num_, rknn_outputs);
+        return NN_SUCCESS;
+    }
+    if (output_mode_ == NN_OUTPUT_BORROW)
+    {
+        // 把运行时分配的缓冲区借给调用者，ReleaseOutputs 时释放
+        for (int i = 0; i < output_num_; ++i)
+        {
+            outputs[i].attr.index = rknn_outputs[i].index;
+            outputs[i].attr.size = rknn_outputs[i].size;
+            outputs[i].data = rknn_outputs[i].buf;
+        }
+        return NN_SUCCESS;
+    }
     // copy rknn outputs to tensor_data_s
     for (int i = 0; i < output_num_; ++i)
     {
@@ -181,9 +305,137 @@ nn_error_e RKEngine::Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_
     return NN_SUCCESS;
 }
 
+/**
+ * @brief 异步提交推理，使用 rknn_run 的非阻塞模式，不占用额外线程
+ * 输入保存在上下文中，同一个上下文同时只有一个请求在 NPU 上执行，提交下一个请求前先收取上一个请求的结果
+ * 带回调的请求需要有线程在完成时调用回调，交给基类的线程模拟
+ * @return nn_ticket_t 请求编号
+ */
+nn_ticket_t RKEngine::Submit(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float,
+                             nn_completion_t done)
+{
+    if (done)
+    {
+        return NNEngine::Submit(inputs, outputs, want_float, done);
+    }
+    std::lock_guard<std::mutex> lock(ctx_mtx_);
+    FinishInFlight(-1);
+    nn_ticket_t ticket = NewTicket();
+    uint64_t frame_id = 0;
+    auto ret = StartRun(inputs, outputs, true, &frame_id);
+    if (ret != NN_SUCCESS)
+    {
+        native_results_[ticket] = ret;
+        return ticket;
+    }
+    in_flight_.ticket = ticket;
+    in_flight_.outputs = &outputs;
+    in_flight_.want_float = want_float;
+    in_flight_.frame_id = frame_id;
+    return ticket;
+}
+
+// 等待 Submit 的请求完成，不是本引擎非阻塞提交的请求交给基类
+nn_error_e RKEngine::Wait(nn_ticket_t ticket, int timeout_ms)
+{
+    {
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
+        if (in_flight_.ticket == ticket && FinishInFlight(timeout_ms) == NN_TIMEOUT)
+        {
+            return NN_TIMEOUT;
+        }
+        auto it = native_results_.find(ticket);
+        if (it != native_results_.end())
+        {
+            nn_error_e ret = it->second;
+            native_results_.erase(it);
+            return ret;
+        }
+    }
+    return NNEngine::Wait(ticket, timeout_ms);
+}
+
+/**
+ * @brief 等待非阻塞提交的请求完成并取得输出，结果保存在 native_results_ 中，调用时已持有 ctx_mtx_
+ * @param timeout_ms 超时时间，< 0 表示一直等待
+ * @return nn_error_e 超时返回 NN_TIMEOUT，请求仍在执行；否则返回 NN_SUCCESS
+ */
+nn_error_e RKEngine::FinishInFlight(int timeout_ms)
+{
+    if (in_flight_.ticket == 0)
+    {
+        return NN_SUCCESS;
+    }
+    rknn_run_extend extend;
+    memset(&extend, 0, sizeof(extend));
+    extend.frame_id = in_flight_.frame_id;
+    extend.timeout_ms = timeout_ms < 0 ? g_wait_forever_ms : timeout_ms;
+    int ret = rknn_wait(rknn_ctx_, &extend);
+    if (ret == RKNN_ERR_TIMEOUT && timeout_ms >= 0)
+    {
+        return NN_TIMEOUT;
+    }
+    nn_error_e result;
+    if (ret < 0)
+    {
+        NN_LOG_ERROR("rknn_wait fail! ret=%d", ret);
+        result = NN_RKNN_RUNTIME_ERROR;
+    }
+    else
+    {
+        result = GetOutputs(*in_flight_.outputs, in_flight_.want_float);
+    }
+    native_results_[in_flight_.ticket] = result;
+    in_flight_.ticket = 0;
+    return NN_SUCCESS;
+}
+
+// 设置输出绑定方式，三种方式都支持
+nn_error_e RKEngine::SetOutputMode(nn_output_mode_e mode)
+{
+    output_mode_ = mode;
+    return NN_SUCCESS;
+}
+
+// 归还 NN_OUTPUT_BORROW 借出的输出缓冲区
+nn_error_e RKEngine::ReleaseOutputs(std::vector<tensor_data_s> &outputs)
+{
+    if (output_mode_ != NN_OUTPUT_BORROW)
+    {
+        return NN_SUCCESS;
+    }
+    if (outputs.size() != output_num_)
+    {
+        NN_LOG_ERROR("outputs num not match! outputs.size()=%ld, output_num_=%d", outputs.size(), output_num_);
+        return NN_IO_NUM_NOT_MATCH;
+    }
+    rknn_output rknn_outputs[g_max_io_num];
+    memset(rknn_outputs, 0, sizeof(rknn_outputs));
+    for (int i = 0; i < output_num_; ++i)
+    {
+        rknn_outputs[i].index = i;
+        rknn_outputs[i].buf = outputs[i].data;
+        rknn_outputs[i].size = outputs[i].attr.size;
+        outputs[i].data = nullptr;
+    }
+    int ret = rknn_outputs_release(rknn_ctx_, output_num_, rknn_outputs);
+    if (ret < 0)
+    {
+        NN_LOG_ERROR("rknn_outputs_release fail! ret=%d", ret);
+        return NN_RKNN_OUTPUT_GET_FAIL;
+    }
+    return NN_SUCCESS;
+}
+
 // 析构函数
 RKEngine::~RKEngine()
 {
+    // 模拟异步的线程会调用 Run，必须在上下文销毁前停止
+    StopAsync();
+    {
+        std::lock_guard<std::mutex> lock(ctx_mtx_);
+        FinishInFlight(-1);
+    }
     if (ctx_created_)
     {
         rknn_destroy(rknn_ctx_);
@@ -5,10 +5,15 @@
 
 #include "engine.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <rknn_api.h>
 
+#include "model_registry.h"
+
 // 继承自NNEngine，实现NNEngine的接口
 class RKEngine : public NNEngine
 {
@@ -20,8 +25,36 @@ public:
     const std::vector<tensor_attr_s> &GetInputShapes() override;                                                       // 获取输入张量的形状
     const std::vector<tensor_attr_s> &GetOutputShapes() override;                                                      // 获取输出张量的形状
     nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float) override; // 运行模型
+    nn_error_e LoadModelData(std::shared_ptr<MappedModel> model) override;                                             // 从已映射的模型加载
+    std::shared_ptr<NNEngine> Duplicate() override;                                                                    // 复制共享权重的上下文
+    nn_error_e SetOutputMode(nn_output_mode_e mode) override;                                                          // 设置输出绑定方式
+    nn_error_e ReleaseOutputs(std::vector<tensor_data_s> &outputs) override;                                           // 归还借出的输出缓冲区
+    nn_ticket_t Submit(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float,
+                       nn_completion_t done = nullptr) override;                                                       // 非阻塞提交推理
+    nn_error_e Wait(nn_ticket_t ticket, int timeout_ms = -1) override;                                                 // 等待推理完成
 
 private:
+    nn_error_e QueryModel(); // 查询版本和输入输出属性
+    nn_error_e StartRun(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool non_block, uint64_t *frame_id);
+    nn_error_e GetOutputs(std::vector<tensor_data_s> &outputs, bool want_float);
+    nn_error_e FinishInFlight(int timeout_ms);
+
+    // 非阻塞提交、还没有收取结果的请求
+    struct InFlight
+    {
+        nn_ticket_t ticket = 0; // 0 表示没有
+        std::vector<tensor_data_s> *outputs = nullptr;
+        bool want_float = false;
+        uint64_t frame_id = 0;
+    };
+
+    std::mutex ctx_mtx_; // Run、Submit、Wait 互斥使用 rknn context
+    InFlight in_flight_;
+    std::map<nn_ticket_t, nn_error_e> native_results_; // 非阻塞请求的结果，等待 Wait 取走
+
+    std::shared_ptr<MappedModel> model_; // 上下文存活期间保持模型映射
+    nn_output_mode_e output_mode_ = NN_OUTPUT_COPY;
+
     // rknn context
     rknn_context rknn_ctx_; // rknn context
     bool ctx_created_;      // rknn context是否创建
@@ -1,106 +1,183 @@
-﻿#include <vector>
+﻿#pragma once
+#include <stdint.h>
+
+#include <vector>
 #include <mutex>
 #include <atomic>
 #include <algorithm>
 #include <cstring>
 #include <condition_variable>
-#include <deque>
 
+// 编码数据的分包缓冲区：一个生产者（编码回调）写入，一个消费者（发送线程）按帧取出
+// 数据只拷贝一次，写进预先分配的环形内存（slab），分包只记录 (offset, len, seq)，发送时直接组成 iovec
+// 每个分包在 slab 中连续存放，写到末尾放不下时从头开始（末尾剩余的空间跳过），发送完由 Release 归还
+// 运行中不再分配内存：slab 和分包记录的环形数组都在构造时分配，消费者的输出数组重复使用
 class PacketManager
 {
 public:
-    struct DataPacket
+    // 一个分包在 slab 中的位置
+    struct PacketView
     {
-        int packetNumber;
-        std::vector<uint8_t> packetData;
-        const char *data() const
-        {
-            return reinterpret_cast<const char *>(packetData.data());
-        }
-
-        size_t size() const
-        {
-            return packetData.size();
-        }
+        uint32_t offset;  // slab 中的偏移
+        uint32_t len;     // 长度
+        uint32_t seq;     // 分包序号，递增
+        bool frameEnd;    // 一帧编码数据的最后一个包
+        uint64_t release; // 内部使用：归还到这个分包为止的空间时的读位置
     };
 
-    PacketManager(size_t bufferSize, size_t packetSize)
-        : buffer(bufferSize), packetSize(packetSize), nextPacketNumber(0), writePos(0), readPos(0), dataSize(0) {}
+    // headroom 为每个分包前预留的字节数（例如 FEC 头），由发送线程在发送前通过 MutableData 填写，计入 view.len
+    PacketManager(size_t bufferSize, size_t packetSize, size_t headroom = 0)
+        : buffer(std::max(bufferSize, packetSize + headroom)), packetSize(packetSize), headroom(headroom),
+          views(buffer.size() / (packetSize + headroom) * 2 + 64) {}
 
+    // 切分并写入一帧数据，空间不足时等待发送线程归还
     void SplitIntoPackets(const char *data, size_t len)
     {
         size_t offset = 0;
         while (offset < len)
         {
-            std::unique_lock<std::mutex> lock(bufferMutex);
+            size_t packetDataLength = std::min(packetSize, len - offset);
+            Append(nullptr, 0, data + offset, packetDataLength, offset + packetDataLength == len);
+            offset += packetDataLength;
+        }
+    }
 
-            size_t remainingBytes = len - offset;
-            size_t packetDataLength = std::min(packetSize, remainingBytes);
+    // 写入一个已经封好的包（例如 RTP 包头 + 负载），head 和 data 拼在一起拷贝进 slab
+    // frameEnd 为该帧的最后一个包，总长度不能超过构造时的 packetSize
+    void AddPacket(const uint8_t *head, size_t headLen, const uint8_t *data, size_t len, bool frameEnd)
+    {
+        Append(head, headLen, reinterpret_cast<const char *>(data), len, frameEnd);
+    }
 
-            if (dataSize + packetDataLength > buffer.size())
+    // 阻塞等待，按顺序取出下一帧的所有分包，out 先被清空
+    // 生产者在等待空间时（一帧比 slab 还大），先取出已经切好的部分
+    // 分包数据在对应的 Release 之前有效；Stop 之后返回 false，未取出的分包不再发送
+    bool GetNextFramePackets(std::vector<PacketView> &out)
+    {
+        out.clear();
+        std::unique_lock<std::mutex> ul(bufferMutex);
+        bufferNotEmpty.wait(ul, [&]
+                            { return stopped || completeFrames > 0 || (viewCount > 0 && producerWaiting); });
+        if (stopped)
+        {
+            return false;
+        }
+        while (viewCount > 0)
+        {
+            const PacketView &view = views[viewHead];
+            out.push_back(view);
+            viewHead = (viewHead + 1) % views.size();
+            viewCount--;
+            if (view.frameEnd)
             {
-                // Buffer overflow, wait until there is enough space
-                bufferNotFull.wait(lock, [&]
-                                   { return dataSize + packetDataLength <= buffer.size(); });
+                completeFrames--;
+                break;
             }
+        }
+        return true;
+    }
 
-            DataPacket packet;
-            packet.packetNumber = nextPacketNumber++;
-            packet.packetData.resize(packetDataLength);
-            std::memcpy(packet.packetData.data(), data + offset, packetDataLength);
-
-            packets.push_back(packet);
-            size_t endPos = (writePos + packetDataLength) % buffer.size();
-            if (endPos < writePos)
-            {
-                std::memcpy(buffer.data() + writePos, data + offset, buffer.size() - writePos);
-                std::memcpy(buffer.data(), data + offset + (buffer.size() - writePos), endPos);
-            }
-            else
-            {
-                std::memcpy(buffer.data() + writePos, data + offset, packetDataLength);
-            }
+    // 唤醒等待的生产者和发送线程，之后写入的数据直接丢弃
+    void Stop()
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        stopped = true;
+        bufferNotEmpty.notify_all();
+        bufferNotFull.notify_all();
+    }
 
-            writePos = endPos;
-            dataSize += packetDataLength;
-            offset += packetDataLength;
+    // 分包数据的地址
+    const char *Data(const PacketView &view) const
+    {
+        return reinterpret_cast<const char *>(buffer.data()) + view.offset;
+    }
 
-            bufferNotEmpty.notify_one();
-        }
+    // 分包数据的可写地址，在 Release 之前只有发送线程访问这段空间，可以就地填写预留的头
+    uint8_t *MutableData(const PacketView &view)
+    {
+        return buffer.data() + view.offset;
     }
 
-    bool TryGetNextPacket(DataPacket &packet)
+    // 发送完成，归还到 last（GetNextFramePackets 取出的最后一个分包）为止的 slab 空间
+    void Release(const PacketView &last)
     {
-        std::unique_lock<std::mutex> ul(bufferMutex);
-        bufferNotEmpty.wait(ul, [&]
-                            { return !packets.empty(); });
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        readPos = last.release;
+        bufferNotFull.notify_one();
+    }
 
-        if (!packets.empty())
+private:
+    void Append(const uint8_t *head, size_t headLen, const char *data, size_t len, bool frameEnd)
+    {
+        std::unique_lock<std::mutex> lock(bufferMutex);
+        if (stopped)
         {
-            packet = packets.front();
-            packets.pop_front();
-
-            size_t packetDataLength = packet.packetData.size();
-            readPos = (readPos + packetDataLength) % buffer.size();
-            dataSize -= packetDataLength;
-
-            bufferNotFull.notify_one();
-            return true;
+            return;
+        }
+        size_t packetDataLength = headroom + headLen + len;
+        // 分包不能跨过 slab 末尾，放不下时跳到开头
+        uint64_t pos = writePos;
+        size_t slabOffset = pos % buffer.size();
+        if (slabOffset + packetDataLength > buffer.size())
+        {
+            pos += buffer.size() - slabOffset;
+            slabOffset = 0;
+        }
+        uint64_t end = pos + packetDataLength;
+        if (end - readPos > buffer.size() || viewCount == views.size())
+        {
+            // 空间不足，先让发送线程取走已经切好的部分（一帧比 slab 还大时也能继续）
+            producerWaiting = true;
+            bufferNotEmpty.notify_one();
+            bufferNotFull.wait(lock, [&]
+                               { return stopped || (end - readPos <= buffer.size() && viewCount < views.size()); });
+            producerWaiting = false;
+            if (stopped)
+            {
+                return;
+            }
         }
 
-        return false;
+        // 拷贝不需要持锁：[pos, end) 不在发送线程可见的范围内，消费者只在这之前的位置读
+        lock.unlock();
+        if (headLen > 0)
+        {
+            std::memcpy(buffer.data() + slabOffset + headroom, head, headLen);
+        }
+        std::memcpy(buffer.data() + slabOffset + headroom + headLen, data, len);
+        lock.lock();
+
+        PacketView &view = views[(viewHead + viewCount) % views.size()];
+        view.offset = (uint32_t)slabOffset;
+        view.len = (uint32_t)packetDataLength;
+        view.seq = nextPacketNumber++;
+        view.frameEnd = frameEnd;
+        view.release = end;
+        viewCount++;
+        writePos = end;
+        if (frameEnd)
+        {
+            completeFrames++;
+        }
+        if (frameEnd || viewCount == views.size())
+        {
+            bufferNotEmpty.notify_one();
+        }
     }
 
-private:
-    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> buffer;     // slab
     size_t packetSize;
-    std::atomic<int> nextPacketNumber;
-    size_t writePos;
-    size_t readPos;
-    size_t dataSize;
-    typedef std::deque<DataPacket> PacketQueue;
-    PacketQueue packets;
+    size_t headroom;
+    std::vector<PacketView> views;   // 已切好、未取出的分包，环形数组
+    size_t viewHead = 0;
+    size_t viewCount = 0;
+    uint32_t nextPacketNumber = 0;
+    uint64_t writePos = 0;           // 写位置，单调递增，slab 中的偏移为 writePos % buffer.size()
+    uint64_t readPos = 0;            // 已归还的位置
+    size_t completeFrames = 0;       // 已切好、未取出的完整帧个数
+    bool producerWaiting = false;
+    bool stopped = false;
     std::mutex bufferMutex;
     std::condition_variable bufferNotFull;
     std::condition_variable bufferNotEmpty;
-};
\ No newline at end of file
+};
@@ -0,0 +1,399 @@
+// RTP/H.264 封包和解包（RFC 3550 / RFC 6184），UDP 视频输出和输入使用
+
+#ifndef RK3588_DEMO_RTP_H264_H
+#define RK3588_DEMO_RTP_H264_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+static const size_t kRtpHeaderSize = 12;
+static const uint8_t kNalFuA = 28;  // FU-A 分片
+static const uint8_t kNalStapA = 24; // STAP-A 聚合
+// 序号跳变的判断（RFC 3550 附录 A.1）：向前跳超过 kRtpMaxDropout 或向后退超过 kRtpMaxMisorder 视为发送端重启
+static const uint16_t kRtpMaxDropout = 3000;
+static const uint16_t kRtpMaxMisorder = 100;
+
+// 在 [p, end) 中找下一个起始码 00 00 01，返回起始码第一个字节的位置，找不到返回 end
+inline const uint8_t *FindH264StartCode(const uint8_t *p, const uint8_t *end)
+{
+    for (; p + 3 <= end; p++)
+    {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+// 把一帧 Annex-B 格式的编码数据按 NAL 封成 RTP 包
+// 放得下的 NAL 单独一个包，放不下的按 FU-A 分片；一帧的最后一个包设置 marker 位
+// 只生成包头，包头和负载分别交给 sink，由调用者一次拷贝到发送缓冲区
+class RtpH264Packetizer
+{
+public:
+    /**
+     * @param max_packet_size RTP 包（包头 + 负载）的最大字节数，与 UDP 包大小一致
+     * @param ssrc 同步源标识
+     * @param payload_type 动态负载类型
+     */
+    RtpH264Packetizer(size_t max_packet_size, uint32_t ssrc, uint8_t payload_type = 96)
+        : max_payload_(max_packet_size - kRtpHeaderSize), ssrc_(ssrc), payload_type_(payload_type & 0x7F) {}
+
+    /**
+     * @brief 封包一帧
+     * @param timestamp 90 kHz 时间戳，一帧的所有包相同
+     * @param sink 每个包调用一次 sink(head, head_len, payload, payload_len, last)，last 为该帧的最后一个包
+     */
+    template <typename Sink>
+    void Packetize(const uint8_t *data, size_t len, uint32_t timestamp, Sink &&sink)
+    {
+        const uint8_t *end = data + len;
+        const uint8_t *nal = NextNal(data, end);
+        while (nal < end)
+        {
+            const uint8_t *next_code = FindH264StartCode(nal, end);
+            const uint8_t *nal_end = next_code;
+            // 4 字节起始码的前导 0 和 trailing_zero_8bits 不属于 NAL
+            while (nal_end > nal && nal_end[-1] == 0)
+            {
+                nal_end--;
+            }
+            const uint8_t *next = NextNal(next_code, end);
+            bool last_nal = next >= end;
+            if (nal_end > nal)
+            {
+                PacketizeNal(nal, nal_end - nal, timestamp, last_nal, sink);
+            }
+            nal = next;
+        }
+    }
+
+    uint16_t GetNextSeq() const { return seq_; }
+
+private:
+    // 跳过起始码，返回 NAL 的第一个字节
+    static const uint8_t *NextNal(const uint8_t *p, const uint8_t *end)
+    {
+        p = FindH264StartCode(p, end);
+        return p < end ? p + 3 : end;
+    }
+
+    void WriteHeader(uint8_t *head, bool marker, uint32_t timestamp)
+    {
+        head[0] = 0x80; // V=2
+        head[1] = (uint8_t)((marker ? 0x80 : 0) | payload_type_);
+        head[2] = (uint8_t)(seq_ >> 8);
+        head[3] = (uint8_t)seq_;
+        head[4] = (uint8_t)(timestamp >> 24);
+        head[5] = (uint8_t)(timestamp >> 16);
+        head[6] = (uint8_t)(timestamp >> 8);
+        head[7] = (uint8_t)timestamp;
+        head[8] = (uint8_t)(ssrc_ >> 24);
+        head[9] = (uint8_t)(ssrc_ >> 16);
+        head[10] = (uint8_t)(ssrc_ >> 8);
+        head[11] = (uint8_t)ssrc_;
+        seq_++;
+    }
+
+    template <typename Sink>
+    void PacketizeNal(const uint8_t *nal, size_t len, uint32_t timestamp, bool last_nal, Sink &sink)
+    {
+        uint8_t head[kRtpHeaderSize + 2];
+        if (len <= max_payload_)
+        {
+            WriteHeader(head, last_nal, timestamp);
+            sink(head, kRtpHeaderSize, nal, len, last_nal);
+            return;
+        }
+        // FU-A：NAL 头拆到 FU indicator（F、NRI）和 FU header（S、E、类型）里，不再单独发送
+        uint8_t indicator = (uint8_t)((nal[0] & 0xE0) | kNalFuA);
+        uint8_t type = nal[0] & 0x1F;
+        const uint8_t *p = nal + 1;
+        const uint8_t *end = nal + len;
+        size_t max_fragment = max_payload_ - 2;
+        bool first = true;
+        while (p < end)
+        {
+            size_t n = std::min(max_fragment, (size_t)(end - p));
+            bool last_fragment = p + n == end;
+            WriteHeader(head, last_nal && last_fragment, timestamp);
+            head[kRtpHeaderSize] = indicator;
+            head[kRtpHeaderSize + 1] = (uint8_t)((first ? 0x80 : 0) | (last_fragment ? 0x40 : 0) | type);
+            sink(head, kRtpHeaderSize + 2, p, n, last_nal && last_fragment);
+            p += n;
+            first = false;
+        }
+    }
+
+    size_t max_payload_;
+    uint32_t ssrc_;
+    uint8_t payload_type_;
+    uint16_t seq_ = 0;
+};
+
+// 解包统计，可以在其他线程读取
+struct RtpDepacketizerStats
+{
+    std::atomic<uint64_t> packets{0};        // 收到的 RTP 包数
+    std::atomic<uint64_t> lost_packets{0};   // 按序号推算丢失的包数
+    std::atomic<uint64_t> late_packets{0};   // 重复、晚到（序号比期望的小）或序号跳变等待确认而丢弃的包数
+    std::atomic<uint64_t> frames{0};         // 交出的完整帧数
+    std::atomic<uint64_t> dropped_frames{0}; // 因丢包或分片不完整丢弃的帧数
+    std::atomic<uint64_t> bad_packets{0};    // 格式错误的包数
+    std::atomic<uint64_t> resyncs{0};        // SSRC 变化或序号跳变后重新同步的次数
+};
+
+// 把 RTP 包还原成 Annex-B 格式的帧，只把完整的帧交给解码器
+// 帧的边界为 marker 位或时间戳变化；帧内有序号缺口、FU-A 分片不完整时整帧丢弃，下一帧照常交出
+// 不做乱序重排，晚到的包按丢包处理
+// SSRC 变化时立即重新同步；序号跳变时按 RFC 3550 附录 A.1，连续两个包的序号衔接上才重新同步，单个异常包丢弃
+class RtpH264Depacketizer
+{
+public:
+    // 完整的一帧（Annex-B，每个 NAL 前加 4 字节起始码），数据在回调期间有效
+    typedef std::function<void(const uint8_t *data, size_t len, uint32_t timestamp)> FrameHandler;
+
+    explicit RtpH264Depacketizer(FrameHandler on_frame, size_t reserve = 1024 * 1024) : on_frame_(on_frame)
+    {
+        frame_.reserve(reserve);
+    }
+
+    // 输入一个 RTP 包，同一时间只能有一个线程调用
+    void Input(const uint8_t *data, size_t len)
+    {
+        stats_.packets++;
+        if (len < kRtpHeaderSize || (data[0] >> 6) != 2)
+        {
+            stats_.bad_packets++;
+            return;
+        }
+        size_t header = kRtpHeaderSize + (data[0] & 0x0F) * 4;
+        if (data[0] & 0x10)
+        {
+            // 扩展头
+            if (len < header + 4)
+            {
+                stats_.bad_packets++;
+                return;
+            }
+            header += 4 + (((size_t)data[header + 2] << 8) | data[header + 3]) * 4;
+        }
+        size_t padding = (data[0] & 0x20) ? data[len - 1] : 0;
+        if (len < header + padding + 1)
+        {
+            stats_.bad_packets++;
+            return;
+        }
+        bool marker = (data[1] & 0x80) != 0;
+        uint16_t seq = (uint16_t)((data[2] << 8) | data[3]);
+        uint32_t timestamp = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+        uint32_t ssrc = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) | ((uint32_t)data[10] << 8) | data[11];
+
+        if (has_seq_ && ssrc != ssrc_)
+        {
+            // 发送端重启或换了一路流，当前帧不完整
+            Resync();
+            has_bad_seq_ = false;
+        }
+        if (has_seq_)
+        {
+            uint16_t gap = (uint16_t)(seq - expected_seq_);
+            if (gap != 0)
+            {
+                if (gap < kRtpMaxDropout - 1)
+                {
+                    stats_.lost_packets += gap;
+                    // 丢失的包可能是当前帧的尾部，也可能是新帧的开头
+                    broken_ = true;
+                    if (in_frame_ && timestamp != timestamp_)
+                    {
+                        Flush();
+                        // 上一帧没有收到 marker 位，只丢了一个包时丢的就是它的最后一个包，新帧是完整的
+                        broken_ = gap > 1;
+                    }
+                }
+                else if (gap < (uint16_t)(0x10000 - kRtpMaxMisorder))
+                {
+                    // 序号大幅跳变：先丢弃这个包并记下它的下一个序号，下一个包正好衔接时认为发送端重启
+                    if (!has_bad_seq_ || seq != bad_seq_)
+                    {
+                        has_bad_seq_ = true;
+                        bad_seq_ = (uint16_t)(seq + 1);
+                        bad_timestamp_ = timestamp;
+                        stats_.late_packets++;
+                        return;
+                    }
+                    Resync();
+                }
+                else
+                {
+                    // 重复或晚到的包（序号比期望的小），所在的帧已经按丢包处理过
+                    stats_.late_packets++;
+                    return;
+                }
+            }
+        }
+        if (!has_seq_)
+        {
+            ssrc_ = ssrc;
+        }
+        bool after_bad_seq = has_bad_seq_ && !has_seq_ && timestamp == bad_timestamp_;
+        has_bad_seq_ = false;
+        has_seq_ = true;
+        expected_seq_ = (uint16_t)(seq + 1);
+
+        if (in_frame_ && timestamp != timestamp_)
+        {
+            // 上一帧没有收到 marker 位
+            Flush();
+        }
+        if (!in_frame_)
+        {
+            in_frame_ = true;
+            timestamp_ = timestamp;
+            // 重新同步时丢弃的那个包属于这一帧
+            broken_ = broken_ || after_bad_seq;
+        }
+        AppendPayload(data + header, len - header - padding);
+        if (marker)
+        {
+            Flush();
+        }
+    }
+
+    const RtpDepacketizerStats &GetStats() const { return stats_; }
+
+private:
+    void AppendNal(const uint8_t *nal, size_t len)
+    {
+        static const uint8_t start_code[4] = {0, 0, 0, 1};
+        frame_.insert(frame_.end(), start_code, start_code + 4);
+        frame_.insert(frame_.end(), nal, nal + len);
+    }
+
+    void AppendPayload(const uint8_t *p, size_t len)
+    {
+        uint8_t type = p[0] & 0x1F;
+        if (type == kNalFuA)
+        {
+            if (len < 2)
+            {
+                stats_.bad_packets++;
+                broken_ = true;
+                return;
+            }
+            bool start = (p[1] & 0x80) != 0;
+            bool end = (p[1] & 0x40) != 0;
+            if (start)
+            {
+                if (in_fu_)
+                {
+                    broken_ = true; // 上一个分片序列没有结束
+                }
+                uint8_t nal_header = (uint8_t)((p[0] & 0xE0) | (p[1] & 0x1F));
+                AppendNal(&nal_header, 1);
+                in_fu_ = true;
+            }
+            else if (!in_fu_)
+            {
+                broken_ = true; // 缺少开始分片
+                return;
+            }
+            frame_.insert(frame_.end(), p + 2, p + len);
+            if (end)
+            {
+                in_fu_ = false;
+            }
+            return;
+        }
+        if (in_fu_)
+        {
+            broken_ = true; // 分片序列被打断
+            in_fu_ = false;
+        }
+        if (type == kNalStapA)
+        {
+            // 聚合包：每个 NAL 前有 2 字节长度
+            size_t pos = 1;
+            while (pos + 2 <= len)
+            {
+                size_t n = ((size_t)p[pos] << 8) | p[pos + 1];
+                pos += 2;
+                if (n == 0 || pos + n > len)
+                {
+                    stats_.bad_packets++;
+                    broken_ = true;
+                    return;
+                }
+                AppendNal(p + pos, n);
+                pos += n;
+            }
+            return;
+        }
+        if (type >= 1 && type <= 23)
+        {
+            AppendNal(p, len);
+            return;
+        }
+        stats_.bad_packets++;
+        broken_ = true;
+    }
+
+    // 丢弃正在组装的帧，从下一个包重新开始计算序号
+    void Resync()
+    {
+        if (in_frame_)
+        {
+            broken_ = true;
+            Flush();
+        }
+        broken_ = false;
+        has_seq_ = false;
+        stats_.resyncs++;
+    }
+
+    // 结束当前帧：完整的交出，不完整的丢弃
+    void Flush()
+    {
+        if (in_fu_)
+        {
+            broken_ = true;
+        }
+        if (!broken_ && !frame_.empty())
+        {
+            stats_.frames++;
+            on_frame_(frame_.data(), frame_.size(), timestamp_);
+        }
+        else
+        {
+            stats_.dropped_frames++;
+        }
+        frame_.clear();
+        in_frame_ = false;
+        in_fu_ = false;
+        broken_ = false;
+    }
+
+    FrameHandler on_frame_;
+    std::vector<uint8_t> frame_; // 正在组装的帧，重复使用
+    bool has_seq_ = false;
+    uint16_t expected_seq_ = 0;
+    uint32_t ssrc_ = 0;
+    bool has_bad_seq_ = false; // 收到过一个序号跳变的包，等待下一个包确认
+    uint16_t bad_seq_ = 0;     // 确认重启时期望的序号
+    uint32_t bad_timestamp_ = 0;
+    bool in_frame_ = false;
+    bool in_fu_ = false;
+    bool broken_ = false;
+    uint32_t timestamp_ = 0;
+    RtpDepacketizerStats stats_;
+};
+
+#endif // RK3588_DEMO_RTP_H264_H
@@ -6,9 +6,37 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <netinet/udp.h>
+#include <sys/uio.h>
 
+#include <errno.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <vector>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+// UDPSender 批量发送的方式
+enum udp_send_mode_e
+{
+    UDP_SEND_SINGLE = 0, // 每个数据包一次 sendto（原始实现）
+    UDP_SEND_MMSG = 1,   // 一次 sendmmsg 发送一批数据包
+    UDP_SEND_GSO = 2,    // 一次 sendmsg 发送多个等长数据包，由内核（UDP_SEGMENT）切分，需要 Linux 4.18 以上
+};
+
+// 发送统计，可以在其他线程读取
+struct UdpSendStats
+{
+    std::atomic<uint64_t> syscalls{0};  // 发送系统调用次数
+    std::atomic<uint64_t> datagrams{0}; // 发送的数据包数
+    std::atomic<uint64_t> bytes{0};     // 发送的字节数
+    std::atomic<uint64_t> batches{0};   // send_batch 调用次数（一次为一帧）
+    std::atomic<uint64_t> errors{0};    // 发送失败次数
+};
+
 class UDPSender
 {
 public:
@@ -44,13 +72,77 @@ public:
     bool send_data(const char *data, size_t len)
     {
         ssize_t sent_len = sendto(sockfd, data, len, 0, (const struct sockaddr *)&servaddr, sizeof(servaddr));
+        stats.syscalls++;
         if (sent_len == -1)
         {
             perror("sendto failed");
+            stats.errors++;
             return false;
         }
+        stats.datagrams++;
+        stats.bytes += len;
+        return true;
+    }
+
+    /**
+     * @brief 设置 send_batch 的发送方式
+     * @param mode 发送方式，内核不支持 UDP_SEND_GSO 时退回 UDP_SEND_MMSG
+     * @param segment_size GSO 切分大小，批量中除最后一个以外等于该大小的连续数据包合并为一次发送
+     * @return false 表示退回了其他方式
+     */
+    bool set_send_mode(udp_send_mode_e mode, size_t segment_size = 1470)
+    {
+        send_mode = mode;
+        gso_size = segment_size;
+        if (mode == UDP_SEND_GSO)
+        {
+            int size = (int)segment_size;
+            if (setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) != 0)
+            {
+                perror("UDP_SEGMENT not supported, use sendmmsg");
+                send_mode = UDP_SEND_MMSG;
+                return false;
+            }
+        }
         return true;
     }
+
+    udp_send_mode_e get_send_mode() const
+    {
+        return send_mode;
+    }
+
+    /**
+     * @brief 按顺序发送一批数据包（通常是一帧编码数据的所有分包），每个 iovec 是一个数据包
+     * 发送方式由 set_send_mode 决定，同一时间只能有一个线程调用
+     * @return 全部发送成功返回 true
+     */
+    bool send_batch(const struct iovec *chunks, size_t count)
+    {
+        stats.batches++;
+        bool ok = true;
+        if (send_mode == UDP_SEND_GSO)
+        {
+            ok = send_gso(chunks, count);
+        }
+        else if (send_mode == UDP_SEND_MMSG)
+        {
+            ok = send_mmsg(chunks, count);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                ok = send_data((const char *)chunks[i].iov_base, chunks[i].iov_len) && ok;
+            }
+        }
+        return ok;
+    }
+
+    const UdpSendStats &get_stats() const
+    {
+        return stats;
+    }
     bool send_data_in_chunks(const char *data, size_t len, size_t chunk_size = 1470)
     {
         size_t offset = 0;
@@ -67,13 +159,135 @@ public:
     }
 
 private:
+    // 一次 sendmmsg 最多的数据包数
+    static const size_t kMaxBatch = 256;
+    // 一次 GSO 发送的数据上限，和 IP 包头加起来不能超过 64 KB
+    static const size_t kMaxGsoBytes = 65000;
+    // 内核一次 GSO 最多切分的数据包数（UDP_MAX_SEGMENTS）
+    static const size_t kMaxGsoSegments = 64;
+
+    bool send_mmsg(const struct iovec *chunks, size_t count)
+    {
+        size_t done = 0;
+        while (done < count)
+        {
+            size_t n = count - done < kMaxBatch ? count - done : kMaxBatch; // std::min 会 ODR 使用 kMaxBatch，需要类外定义
+            msgs.resize(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_name = &servaddr;
+                msgs[i].msg_hdr.msg_namelen = sizeof(servaddr);
+                msgs[i].msg_hdr.msg_iov = const_cast<struct iovec *>(&chunks[done + i]);
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int sent = sendmmsg(sockfd, msgs.data(), n, 0);
+            stats.syscalls++;
+            if (sent <= 0)
+            {
+                perror("sendmmsg failed");
+                stats.errors++;
+                return false;
+            }
+            // 部分发送时从第一个未发送的数据包继续
+            for (int i = 0; i < sent; i++)
+            {
+                stats.bytes += chunks[done + i].iov_len;
+            }
+            stats.datagrams += sent;
+            done += sent;
+        }
+        return true;
+    }
+
+    // 连续的等长数据包（最后一个可以更短）合并为一次 sendmsg，内核按 gso_size 切分成多个数据包
+    bool send_gso(const struct iovec *chunks, size_t count)
+    {
+        size_t done = 0;
+        while (done < count)
+        {
+            size_t n = 1;
+            size_t bytes = chunks[done].iov_len;
+            // 当前段必须等于 gso_size 才能接上后一个，后一个不能超过 gso_size
+            while (done + n < count && chunks[done + n - 1].iov_len == gso_size &&
+                   chunks[done + n].iov_len <= gso_size && n < kMaxGsoSegments &&
+                   bytes + chunks[done + n].iov_len <= kMaxGsoBytes)
+            {
+                bytes += chunks[done + n].iov_len;
+                n++;
+            }
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = &servaddr;
+            msg.msg_namelen = sizeof(servaddr);
+            msg.msg_iov = const_cast<struct iovec *>(&chunks[done]);
+            msg.msg_iovlen = n;
+            ssize_t sent = sendmsg(sockfd, &msg, 0);
+            stats.syscalls++;
+            if (sent < 0)
+            {
+                if (errno == EIO || errno == EINVAL)
+                {
+                    // 网卡或路由不支持 GSO，以后都使用 sendmmsg
+                    perror("UDP GSO send failed, use sendmmsg");
+                    int size = 0;
+                    setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size));
+                    send_mode = UDP_SEND_MMSG;
+                    return send_mmsg(chunks + done, count - done);
+                }
+                perror("sendmsg failed");
+                stats.errors++;
+                return false;
+            }
+            stats.datagrams += (bytes + gso_size - 1) / gso_size;
+            stats.bytes += bytes;
+            done += n;
+        }
+        return true;
+    }
+
     int sockfd;
     struct sockaddr_in servaddr;
+    udp_send_mode_e send_mode = UDP_SEND_SINGLE;
+    size_t gso_size = 1470;
+    std::vector<struct mmsghdr> msgs; // 复用，避免每帧分配
+    UdpSendStats stats;
+};
+
+// 批量接收到的一个数据包，只在回调期间有效（指向接收环中的槽位）
+struct UdpPacket
+{
+    const char *data;
+    int len;
+    const struct sockaddr_in *from;
+};
+
+// 接收统计，可以在其他线程读取
+struct UdpRecvStats
+{
+    std::atomic<uint64_t> syscalls{0};     // 接收系统调用次数
+    std::atomic<uint64_t> datagrams{0};    // 收到的数据包数
+    std::atomic<uint64_t> bytes{0};        // 收到的字节数
+    std::atomic<uint64_t> truncated{0};    // 超过槽位大小被截断、丢弃的数据包数
+    std::atomic<uint64_t> kernel_drops{0}; // 套接字缓冲区满时内核丢弃的数据包数（SO_RXQ_OVFL，只在批量接收时统计）
 };
 
 class UdpSocket
 {
 public:
+    // 批量接收的回调，packets 为一次 recvmmsg 收到的数据包
+    typedef std::function<void(const UdpPacket *packets, int count)> BatchHandler;
+
+    UdpSocket(BatchHandler callback) : batchHandler(callback)
+    {
+        serverSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (serverSocket == -1)
+        {
+            std::cerr << "Socket creation failed\n";
+            return;
+        }
+    }
+
     UdpSocket(std::function<void(const char *, int)> callback) : dataHandler(callback)
     {
         serverSocket = socket(AF_INET, SOCK_DGRAM, 0);
@@ -96,6 +310,7 @@ public:
 
     ~UdpSocket()
     {
+        stopReceiving();
         close(serverSocket);
     }
 
@@ -113,10 +328,62 @@ public:
         }
     }
 
+    /**
+     * @brief 设置套接字接收缓冲区大小，优先用 SO_RCVBUFFORCE 突破 rmem_max（需要 CAP_NET_ADMIN）
+     * @return 内核实际分配的大小（内核会翻倍记账），失败返回 -1
+     */
+    int setReceiveBuffer(int bytes)
+    {
+        if (setsockopt(serverSocket, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) != 0 &&
+            setsockopt(serverSocket, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) != 0)
+        {
+            perror("set SO_RCVBUF failed");
+            return -1;
+        }
+        int actual = 0;
+        socklen_t len = sizeof(actual);
+        getsockopt(serverSocket, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+        return actual;
+    }
+
+    /**
+     * @brief 使用 recvmmsg 批量接收，startReceiving 之前调用
+     * 接收环有 batch_size 个 slot_size 字节的槽位，预先分配，一次系统调用最多收满所有槽位
+     * 有批量回调时整批交给它，否则对每个数据包调用原来的回调
+     * @param batch_size 每次最多接收的数据包数，<= 1 时使用原来的逐个 recvfrom
+     * @param slot_size 槽位大小，更大的数据包被截断并丢弃
+     */
+    void setBatchReceive(int batch_size, int slot_size = 2048)
+    {
+        batchSize = batch_size;
+        slotSize = slot_size > 0 ? slot_size : 2048;
+    }
+
+    const UdpRecvStats &getRecvStats() const
+    {
+        return recvStats;
+    }
+
     void startReceiving()
     {
-        std::thread receiveThread(&UdpSocket::receiveData, this);
-        receiveThread.detach();
+        if (receiveThread.joinable())
+        {
+            return;
+        }
+        receiveThread = std::thread(batchSize > 1 ? &UdpSocket::receiveBatch : &UdpSocket::receiveData, this);
+    }
+
+    // 停止接收并等待接收线程结束，析构时自动调用；不能在接收回调里调用
+    void stopReceiving()
+    {
+        if (!receiveThread.joinable())
+        {
+            return;
+        }
+        stopping = true;
+        // 唤醒阻塞在 recvfrom / recvmmsg 上的接收线程，之后接收立即返回 0
+        shutdown(serverSocket, SHUT_RD);
+        receiveThread.join();
     }
 
     void startReceiving(int port)
@@ -125,8 +392,7 @@ public:
         {
             bindSocket(port);
         }
-        std::thread receiveThread(&UdpSocket::receiveData, this);
-        receiveThread.detach();
+        startReceiving();
     }
     bool send_data_in_chunks(const char *data, size_t len, const struct sockaddr *client, size_t chunk_size = 1470)
     {
@@ -175,27 +441,132 @@ private:
     int serverSocket;
     std::function<void(const char *, int)> dataHandler;
     std::function<void(const char *, int, UdpSocket *, struct sockaddr *)> dataHandler1;
+    BatchHandler batchHandler;
+    int batchSize = 1;
+    int slotSize = 2048;
+    UdpRecvStats recvStats;
+    std::thread receiveThread;
+    std::atomic<bool> stopping{false};
+
+    // 交给回调：有批量回调时整批交出，否则逐个调用原来的回调
+    void dispatch(const UdpPacket *packets, int count)
+    {
+        if (batchHandler)
+        {
+            batchHandler(packets, count);
+            return;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if (dataHandler)
+            {
+                dataHandler(packets[i].data, packets[i].len);
+            }
+            if (dataHandler1)
+            {
+                dataHandler1(packets[i].data, packets[i].len, this, (struct sockaddr *)packets[i].from);
+            }
+        }
+    }
+
+    // recvmmsg 批量接收：阻塞到至少一个数据包（MSG_WAITFORONE），再把已经到达的一起取走
+    void receiveBatch()
+    {
+        int on = 1;
+        if (setsockopt(serverSocket, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) != 0)
+        {
+            perror("set SO_RXQ_OVFL failed");
+        }
+        const size_t controlSize = CMSG_SPACE(sizeof(uint32_t));
+        // 接收环：槽位多留 1 字节，和逐个接收一样在数据后补 '\0'
+        std::vector<char> ring((size_t)batchSize * (slotSize + 1));
+        std::vector<char> control((size_t)batchSize * controlSize);
+        std::vector<struct sockaddr_in> addrs(batchSize);
+        std::vector<struct iovec> iovs(batchSize);
+        std::vector<struct mmsghdr> msgs(batchSize);
+        std::vector<UdpPacket> packets(batchSize);
+        for (int i = 0; i < batchSize; i++)
+        {
+            iovs[i].iov_base = ring.data() + (size_t)i * (slotSize + 1);
+            iovs[i].iov_len = slotSize;
+        }
+
+        while (!stopping)
+        {
+            // recvmmsg 会改写地址和控制信息的长度，每次重新设置
+            for (int i = 0; i < batchSize; i++)
+            {
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_name = &addrs[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_control = control.data() + (size_t)i * controlSize;
+                msgs[i].msg_hdr.msg_controllen = controlSize;
+            }
+            int got = recvmmsg(serverSocket, msgs.data(), batchSize, MSG_WAITFORONE, nullptr);
+            recvStats.syscalls++;
+            if (got < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN)
+                {
+                    continue;
+                }
+                perror("recvmmsg failed");
+                return;
+            }
+            int count = 0;
+            for (int i = 0; i < got; i++)
+            {
+                struct msghdr &hdr = msgs[i].msg_hdr;
+                // 套接字累计丢包数随每个数据包一起返回
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+                    {
+                        uint32_t drops;
+                        memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                        recvStats.kernel_drops.store(drops, std::memory_order_relaxed);
+                    }
+                }
+                if (hdr.msg_flags & MSG_TRUNC)
+                {
+                    recvStats.truncated++;
+                    continue;
+                }
+                char *data = (char *)iovs[i].iov_base;
+                data[msgs[i].msg_len] = '\0';
+                packets[count].data = data;
+                packets[count].len = (int)msgs[i].msg_len;
+                packets[count].from = &addrs[i];
+                recvStats.bytes += msgs[i].msg_len;
+                count++;
+            }
+            recvStats.datagrams += count;
+            if (count > 0)
+            {
+                dispatch(packets.data(), count);
+            }
+        }
+    }
     void receiveData()
     {
         char buffer[4096];
         struct sockaddr_in clientAddr;
         socklen_t addrLen = sizeof(clientAddr);
 
-        while (true)
+        while (!stopping)
         {
             int len = recvfrom(serverSocket, buffer, sizeof(buffer) - 1, 0, (struct sockaddr *)&clientAddr, &addrLen);
+            recvStats.syscalls++;
             if (len > 0)
             {
                 buffer[len] = '\0';
-                if (dataHandler)
-                {
-                    dataHandler(buffer, len);
-                }
-                if (dataHandler1)
-                {
-                    // sendto(serverSocket, buffer, len, 0,(struct sockaddr *)& clientAddr, sizeof(clientAddr));
-                    dataHandler1(buffer, len, this, (struct sockaddr *)&clientAddr);
-                }
+                recvStats.datagrams++;
+                recvStats.bytes += len;
+                // sendto(serverSocket, buffer, len, 0,(struct sockaddr *)& clientAddr, sizeof(clientAddr));
+                UdpPacket packet = {buffer, len, &clientAddr};
+                dispatch(&packet, 1);
             }
         }
     }
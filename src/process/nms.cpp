@@ -0,0 +1,246 @@
+// 非极大值抑制（NMS）
+
+#include "nms.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+namespace yolo
+{
+#define NMS_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define NMS_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+    static const int g_nms_grid_min_boxes = 32; // 框数较少时两两比较更快
+    static const int g_nms_grid_max_side = 64;  // 网格每边的最大格数
+
+    void NmsBoxes::reserve(size_t n)
+    {
+        xmin.reserve(n);
+        ymin.reserve(n);
+        xmax.reserve(n);
+        ymax.reserve(n);
+        score.reserve(n);
+        classId.reserve(n);
+    }
+
+    void NmsBoxes::clear()
+    {
+        xmin.clear();
+        ymin.clear();
+        xmax.clear();
+        ymax.clear();
+        score.clear();
+        classId.clear();
+    }
+
+    void NmsBoxes::push_back(float x0, float y0, float x1, float y1, float s, int cls)
+    {
+        xmin.push_back(x0);
+        ymin.push_back(y0);
+        xmax.push_back(x1);
+        ymax.push_back(y1);
+        score.push_back(s);
+        classId.push_back(cls);
+    }
+
+    float IOU(float XMin1, float YMin1, float XMax1, float YMax1, float XMin2, float YMin2, float XMax2, float YMax2)
+    {
+        float XMin = NMS_MAX(XMin1, XMin2);
+        float YMin = NMS_MAX(YMin1, YMin2);
+        float XMax = NMS_MIN(XMax1, XMax2);
+        float YMax = NMS_MIN(YMax1, YMax2);
+
+        float InterWidth = XMax - XMin;
+        float InterHeight = YMax - YMin;
+
+        InterWidth = (InterWidth >= 0) ? InterWidth : 0;
+        InterHeight = (InterHeight >= 0) ? InterHeight : 0;
+
+        float Inter = InterWidth * InterHeight;
+
+        float Area1 = (XMax1 - XMin1) * (YMax1 - YMin1);
+        float Area2 = (XMax2 - XMin2) * (YMax2 - YMin2);
+
+        float Total = Area1 + Area2 - Inter;
+
+        return float(Inter) / float(Total);
+    }
+
+    // 分数相同的框按下标排序，保证两种实现、多次运行的顺序一致
+    void NmsEngine::SortByScore(const NmsBoxes &boxes)
+    {
+        int n = (int)boxes.size();
+        order_.resize(n);
+        for (int i = 0; i < n; i++)
+        {
+            order_[i] = i;
+        }
+        const float *score = boxes.score.data();
+        std::sort(order_.begin(), order_.end(),
+                  [score](int a, int b) -> bool
+                  { return score[a] > score[b] || (score[a] == score[b] && a < b); });
+    }
+
+    int NmsEngine::Run(const NmsBoxes &boxes, const NmsOptions &opt, std::vector<int> &keep)
+    {
+        keep.clear();
+        iou_count_ = 0;
+        if (boxes.size() == 0)
+        {
+            return 0;
+        }
+        SortByScore(boxes);
+
+        // 阈值小于 0 时不相交的框也会被抑制，网格索引不再适用
+        if (opt.engine == NMS_ENGINE_QUADRATIC || opt.iou_threshold < 0 || (int)boxes.size() < g_nms_grid_min_boxes)
+        {
+            return RunQuadratic(boxes, opt, keep);
+        }
+        return RunGrid(boxes, opt, keep);
+    }
+
+    int NmsEngine::RunQuadratic(const NmsBoxes &boxes, const NmsOptions &opt, std::vector<int> &keep)
+    {
+        int n = (int)order_.size();
+        removed_.assign(n, 0);
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (removed_[i])
+            {
+                continue;
+            }
+            int a = order_[i];
+            keep.push_back(a);
+            if (opt.max_det > 0 && (int)keep.size() >= opt.max_det)
+            {
+                break;
+            }
+
+            for (int j = i + 1; j < n; ++j)
+            {
+                int b = order_[j];
+                if (removed_[j] || (opt.mode == NMS_CLASS_AWARE && boxes.classId[a] != boxes.classId[b]))
+                {
+                    continue;
+                }
+                iou_count_++;
+                float iou = IOU(boxes.xmin[a], boxes.ymin[a], boxes.xmax[a], boxes.ymax[a],
+                                boxes.xmin[b], boxes.ymin[b], boxes.xmax[b], boxes.ymax[b]);
+                if (iou > opt.iou_threshold)
+                {
+                    removed_[j] = 1;
+                }
+            }
+        }
+        return (int)keep.size();
+    }
+
+    /*
+     * 网格实现：
+     * IOU > 阈值（阈值 >= 0）要求两个框的交集面积大于 0，即两个框的内部有公共点，
+     * 这个点所在的网格一定同时被两个框覆盖。所以每个保留的框登记到它覆盖的所有网格，
+     * 后续的框只需要和它覆盖的网格中登记过的保留框计算 IOU，结果与两两比较完全一致。
+     */
+    int NmsEngine::RunGrid(const NmsBoxes &boxes, const NmsOptions &opt, std::vector<int> &keep)
+    {
+        int n = (int)order_.size();
+
+        // 网格覆盖所有框的范围
+        float ox = boxes.xmin[0], oy = boxes.ymin[0], ex = boxes.xmax[0], ey = boxes.ymax[0];
+        for (int i = 1; i < n; i++)
+        {
+            ox = NMS_MIN(ox, boxes.xmin[i]);
+            oy = NMS_MIN(oy, boxes.ymin[i]);
+            ex = NMS_MAX(ex, boxes.xmax[i]);
+            ey = NMS_MAX(ey, boxes.ymax[i]);
+        }
+        if (!(ex > ox) || !(ey > oy))
+        {
+            return RunQuadratic(boxes, opt, keep);
+        }
+
+        int side = (int)sqrtf((float)n);
+        side = NMS_MAX(side, 1);
+        side = NMS_MIN(side, g_nms_grid_max_side);
+        float inv_w = side / (ex - ox);
+        float inv_h = side / (ey - oy);
+
+        auto cell_x = [&](float x) -> int
+        {
+            int c = (int)((x - ox) * inv_w);
+            return NMS_MAX(0, NMS_MIN(side - 1, c));
+        };
+        auto cell_y = [&](float y) -> int
+        {
+            int c = (int)((y - oy) * inv_h);
+            return NMS_MAX(0, NMS_MIN(side - 1, c));
+        };
+
+        cell_head_.assign(side * side, -1);
+        node_next_.clear();
+        node_box_.clear();
+        visit_stamp_.assign(n, -1);
+
+        for (int i = 0; i < n; ++i)
+        {
+            int b = order_[i];
+            int cx0 = cell_x(boxes.xmin[b]), cx1 = cell_x(boxes.xmax[b]);
+            int cy0 = cell_y(boxes.ymin[b]), cy1 = cell_y(boxes.ymax[b]);
+
+            // 与已保留的框比较，只查询当前框覆盖的网格
+            bool suppressed = false;
+            for (int cy = cy0; cy <= cy1 && !suppressed; cy++)
+            {
+                for (int cx = cx0; cx <= cx1 && !suppressed; cx++)
+                {
+                    for (int node = cell_head_[cy * side + cx]; node != -1; node = node_next_[node])
+                    {
+                        int a = node_box_[node];
+                        if (visit_stamp_[a] == i)
+                        {
+                            continue;
+                        }
+                        visit_stamp_[a] = i;
+                        if (opt.mode == NMS_CLASS_AWARE && boxes.classId[a] != boxes.classId[b])
+                        {
+                            continue;
+                        }
+                        iou_count_++;
+                        float iou = IOU(boxes.xmin[a], boxes.ymin[a], boxes.xmax[a], boxes.ymax[a],
+                                        boxes.xmin[b], boxes.ymin[b], boxes.xmax[b], boxes.ymax[b]);
+                        if (iou > opt.iou_threshold)
+                        {
+                            suppressed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            if (suppressed)
+            {
+                continue;
+            }
+
+            keep.push_back(b);
+            if (opt.max_det > 0 && (int)keep.size() >= opt.max_det)
+            {
+                break;
+            }
+
+            // 登记到覆盖的所有网格
+            for (int cy = cy0; cy <= cy1; cy++)
+            {
+                for (int cx = cx0; cx <= cx1; cx++)
+                {
+                    int cell = cy * side + cx;
+                    node_box_.push_back(b);
+                    node_next_.push_back(cell_head_[cell]);
+                    cell_head_[cell] = (int)node_box_.size() - 1;
+                }
+            }
+        }
+        return (int)keep.size();
+    }
+}
@@ -0,0 +1,81 @@
+// 非极大值抑制（NMS）
+
+#ifndef RK3588_DEMO_NMS_H
+#define RK3588_DEMO_NMS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace yolo
+{
+    // 候选框，结构体数组（SoA）布局，坐标为归一化后的 [0, 1]
+    struct NmsBoxes
+    {
+        std::vector<float> xmin;
+        std::vector<float> ymin;
+        std::vector<float> xmax;
+        std::vector<float> ymax;
+        std::vector<float> score;
+        std::vector<int> classId;
+
+        size_t size() const { return score.size(); }
+        void reserve(size_t n);
+        void clear();
+        void push_back(float x0, float y0, float x1, float y1, float s, int cls);
+    };
+
+    typedef enum
+    {
+        NMS_CLASS_AGNOSTIC = 0, // 不区分类别，任意类别的框之间都会互相抑制（原始实现）
+        NMS_CLASS_AWARE = 1,    // 只在同类别的框之间抑制
+    } nms_mode_e;
+
+    typedef enum
+    {
+        NMS_ENGINE_QUADRATIC = 0, // 两两比较，作为参考实现保留
+        NMS_ENGINE_GRID = 1,      // 均匀网格索引，只比较范围有重叠的框
+    } nms_engine_e;
+
+    struct NmsOptions
+    {
+        float iou_threshold = 0.45f;
+        nms_mode_e mode = NMS_CLASS_AGNOSTIC;
+        nms_engine_e engine = NMS_ENGINE_GRID;
+        int max_det = 0; // 最多保留的框数，<= 0 表示不限制
+    };
+
+    float IOU(float XMin1, float YMin1, float XMax1, float YMax1, float XMin2, float YMin2, float XMax2, float YMax2);
+
+    class NmsEngine
+    {
+    public:
+        /**
+         * @brief 贪心 NMS：按分数从高到低，保留未被抑制的框，并抑制与其 IOU 大于阈值的后续框
+         * 两种实现的保留结果完全一致，网格实现只是跳过了不可能相交的框
+         * @param boxes 候选框
+         * @param opt NMS 参数
+         * @param keep 输出保留的框的下标，按分数降序
+         * @return int 保留的框数
+         */
+        int Run(const NmsBoxes &boxes, const NmsOptions &opt, std::vector<int> &keep);
+
+        // 最近一次 Run 计算 IOU 的次数，用于评估抑制开销
+        uint64_t GetIouCount() const { return iou_count_; }
+
+    private:
+        void SortByScore(const NmsBoxes &boxes);
+        int RunQuadratic(const NmsBoxes &boxes, const NmsOptions &opt, std::vector<int> &keep);
+        int RunGrid(const NmsBoxes &boxes, const NmsOptions &opt, std::vector<int> &keep);
+
+        std::vector<int> order_;         // 按分数降序的下标
+        std::vector<uint8_t> removed_;   // 排序后第 i 个框是否被抑制
+        std::vector<int> cell_head_;     // 每个网格的链表头
+        std::vector<int> node_next_;     // 链表节点：下一个节点
+        std::vector<int> node_box_;      // 链表节点：保留框的下标
+        std::vector<int> visit_stamp_;   // 防止同一对框在多个网格中重复计算
+        uint64_t iou_count_ = 0;
+    };
+}
+
+#endif // RK3588_DEMO_NMS_H
@@ -7,6 +7,8 @@
 #include <algorithm>
 
 #include "utils/logging.h"
+#include "process/simd_decode.h"
+#include "process/nms.h"
 
 int get_top(float *pfProb, float *pfMaxProb, uint32_t *pMaxClass, uint32_t outputCount, uint32_t topNum)
 {
@@ -42,42 +44,6 @@ int get_top(float *pfProb, float *pfMaxProb, uint32_t *pMaxClass, uint32_t outpu
 
 namespace yolo
 {
-    typedef struct
-    {
-        float xmin;
-        float ymin;
-        float xmax;
-        float ymax;
-        float score;
-        int classId;
-        int P_ID = -1;
-    } DetectRect;
-    static int input_w = 640;
-    static int input_h = 640;
-    static float objectThreshold = 0.35;
-    static float nmsThreshold = 0.15;
-    static int headNum = 4;
-    static int class_num = 4; // 类别数
-                              // static int strides[4] = {8, 16, 32, 64};
-
-     static int strides[4] = {4, 8, 16, 32}; // p2 p2 p3  p4 p5 的strides 
-    // static int strides[3] = {8, 16, 32}; // p2 p2 p3  p2 的strides 
-
-
-
-    // static int strides[1] = {4};
-   // static int strides[4] = {8, 16, 32, 64}; // P3, P4, P5, P6
-
-    // static int mapSize[4][2] = {{80, 80}, {40, 40}, {20, 20}, {10, 10}};
-    //   static int mapSize[4][2] = {{240, 240}, {120, 120}, {60, 60}, {30, 30}};
-     static int mapSize[4][2] = {{160, 160}, {80, 80}, {40, 40}, {20, 20}};  // p2 p3  p4 p5
-
-    // static int mapSize[3][2] = { {80, 80}, {40, 40}, {20, 20}};  //  p3  p4 p5  官方自带的
-
-
-    // static int mapSize[1][2] = {{160, 160}};
-#define ZQ_MAX(a, b) ((a) > (b) ? (a) : (b))
-#define ZQ_MIN(a, b) ((a) < (b) ? (a) : (b))
     static inline float fast_exp(float x)
     {
         // return exp(x);
@@ -95,77 +61,197 @@ namespace yolo
         return 1 / (1 + fast_exp(-x));
     }
 
-    static inline float IOU(float XMin1, float YMin1, float XMax1, float YMax1, float XMin2, float YMin2, float XMax2, float YMax2)
+    static float DeQnt2F32(int8_t qnt, int zp, float scale)
     {
-        float Inter = 0;
-        float Total = 0;
-        float XMin = 0;
-        float YMin = 0;
-        float XMax = 0;
-        float YMax = 0;
-        float Area1 = 0;
-        float Area2 = 0;
-        float InterWidth = 0;
-        float InterHeight = 0;
+        return ((float)qnt - (float)zp) * scale;
+    }
 
-        XMin = ZQ_MAX(XMin1, XMin2);
-        YMin = ZQ_MAX(YMin1, YMin2);
-        XMax = ZQ_MIN(XMax1, XMax2);
-        YMax = ZQ_MIN(YMax1, YMax2);
+    /**
+     * @brief 把浮点阈值换算成量化域的类别门限
+     * sigmoid(DeQnt2F32(q)) 随 q 单调不减，从小到大找到第一个分数超过阈值的 q 即可，
+     * 用 q >= 门限 判断和逐个反量化后再比较的结果完全一致
+     * @return 门限，范围 [-128, 128]，128 表示这个输出头不可能有分数超过阈值的格子
+     */
+    static int QntThreshold(float threshold, int zp, float scale)
+    {
+        for (int q = -128; q <= 127; q++)
+        {
+            if (sigmoid(DeQnt2F32((int8_t)q, zp, scale)) > threshold)
+            {
+                return q;
+            }
+        }
+        return 128;
+    }
 
-        InterWidth = XMax - XMin;
-        InterHeight = YMax - YMin;
+    // 生成 int8 到 sigmoid 分数的查找表，下标为 q + 128
+    static void GenerateSigmoidLut(int zp, float scale, float *lut)
+    {
+        for (int q = -128; q <= 127; q++)
+        {
+            lut[q + 128] = sigmoid(DeQnt2F32((int8_t)q, zp, scale));
+        }
+    }
 
-        InterWidth = (InterWidth >= 0) ? InterWidth : 0;
-        InterHeight = (InterHeight >= 0) ? InterHeight : 0;
+    // 框坐标限制在输入图像内，并归一化后放入候选框
+    static inline void AppendRect(float xmin, float ymin, float xmax, float ymax, int input_w, int input_h,
+                                  int cls_index, float cls_max, NmsBoxes &detectRects)
+    {
+        xmin = xmin > 0 ? xmin : 0;
+        ymin = ymin > 0 ? ymin : 0;
+        xmax = xmax < input_w ? xmax : input_w;
+        ymax = ymax < input_h ? ymax : input_h;
 
-        Inter = InterWidth * InterHeight;
+        if (xmin >= 0 && ymin >= 0 && xmax <= input_w && ymax <= input_h)
+        {
+            detectRects.push_back(xmin / input_w, ymin / input_h, xmax / input_w, ymax / input_h, cls_max, cls_index);
+        }
+    }
 
-        Area1 = (XMax1 - XMin1) * (YMax1 - YMin1);
-        Area2 = (XMax2 - XMin2) * (YMax2 - YMin2);
+    /**
+     * @brief 对一个格子做 int8 框回归
+     * @param reg 回归输出，平面布局 [4][plane]
+     * @param offset 格子在平面中的下标
+     * @param grid 格子在 meshgrid 中的中心坐标 (x, y)
+     */
+    static inline void AppendRectInt8(const int8_t *reg, int plane, int offset, const float *grid, int stride,
+                                      int quant_zp_reg, float quant_scale_reg, int input_w, int input_h,
+                                      int cls_index, float cls_max, NmsBoxes &detectRects)
+    {
+        float xmin = (grid[0] - DeQnt2F32(reg[0 * plane + offset], quant_zp_reg, quant_scale_reg)) * stride;
+        float ymin = (grid[1] - DeQnt2F32(reg[1 * plane + offset], quant_zp_reg, quant_scale_reg)) * stride;
+        float xmax = (grid[0] + DeQnt2F32(reg[2 * plane + offset], quant_zp_reg, quant_scale_reg)) * stride;
+        float ymax = (grid[1] + DeQnt2F32(reg[3 * plane + offset], quant_zp_reg, quant_scale_reg)) * stride;
 
-        Total = Area1 + Area2 - Inter;
+        AppendRect(xmin, ymin, xmax, ymax, input_w, input_h, cls_index, cls_max, detectRects);
+    }
 
-        return float(Inter) / float(Total);
+    // 对候选框做 NMS，保留的框下标放入 keep
+    static int NmsRects(DecodeScratch &scratch, float nmsThreshold, int max_det)
+    {
+        NmsOptions opt;
+        opt.iou_threshold = nmsThreshold;
+        opt.mode = NMS_CLASS_AGNOSTIC;
+        opt.engine = NMS_ENGINE_GRID;
+        opt.max_det = max_det;
+
+        NN_LOG_DEBUG("NMS Before num :%ld", scratch.boxes.size());
+        int num = scratch.nms.Run(scratch.boxes, opt, scratch.keep);
+        NN_LOG_DEBUG("NMS After num :%d, iou count: %lu", num, (unsigned long)scratch.nms.GetIouCount());
+        return num;
     }
 
-    static float DeQnt2F32(int8_t qnt, int zp, float scale)
+    // 从张量属性中取出 NCHW 排列的 C、H、W
+    static bool GetCHW(const tensor_attr_s &attr, int &c, int &h, int &w)
     {
-        return ((float)qnt - (float)zp) * scale;
+        if (attr.n_dims != 4)
+        {
+            return false;
+        }
+        if (attr.layout == NN_TENSOR_NHWC)
+        {
+            c = attr.dims[3];
+            h = attr.dims[1];
+            w = attr.dims[2];
+        }
+        else
+        {
+            c = attr.dims[1];
+            h = attr.dims[2];
+            w = attr.dims[3];
+        }
+        return true;
     }
 
-    std::vector<float> GenerateMeshgrid()
+    nn_error_e DetectionDecoder::Init(const tensor_attr_s &input, const std::vector<tensor_attr_s> &outputs)
     {
-        std::vector<float> meshgrid;
-        if (headNum == 0)
+        int input_c = 0;
+        if (!GetCHW(input, input_c, input_h_, input_w_))
         {
-            NN_LOG_ERROR("=== yolov8 Meshgrid  Generate failed! ");
-            exit(-1);
+            NN_LOG_ERROR("yolov8 decoder: unsupported input dims %d", input.n_dims);
+            return NN_RKNN_INPUT_ATTR_ERROR;
         }
 
-        for (int index = 0; index < headNum; index++)
+        if (outputs.empty() || outputs.size() % 2 != 0)
         {
-            for (int i = 0; i < mapSize[index][0]; i++)
+            NN_LOG_ERROR("yolov8 decoder: output tensor number should be (reg, cls) pairs, but %ld", outputs.size());
+            return NN_RKNN_OUTPUT_ATTR_ERROR;
+        }
+
+        heads_.clear();
+        grid_base_.clear();
+        meshgrid_.clear();
+        class_num_ = 0;
+
+        for (size_t index = 0; index < outputs.size() / 2; index++)
+        {
+            const tensor_attr_s &reg = outputs[index * 2 + 0];
+            const tensor_attr_s &cls = outputs[index * 2 + 1];
+
+            // 后处理按平面（NCHW）读取输出
+            if (reg.layout == NN_TENSOR_NHWC || cls.layout == NN_TENSOR_NHWC)
+            {
+                NN_LOG_ERROR("yolov8 decoder: head %ld output layout is NHWC, only NCHW is supported", index);
+                return NN_RKNN_OUTPUT_ATTR_ERROR;
+            }
+
+            int reg_c = 0, reg_h = 0, reg_w = 0;
+            int cls_c = 0, cls_h = 0, cls_w = 0;
+            if (!GetCHW(reg, reg_c, reg_h, reg_w) || !GetCHW(cls, cls_c, cls_h, cls_w))
+            {
+                NN_LOG_ERROR("yolov8 decoder: head %ld output dims is not 4", index);
+                return NN_RKNN_OUTPUT_ATTR_ERROR;
+            }
+            if (reg_c != 4 || reg_h != cls_h || reg_w != cls_w || reg_h <= 0 || reg_w <= 0)
+            {
+                NN_LOG_ERROR("yolov8 decoder: head %ld shape mismatch, reg=[%d, %d, %d], cls=[%d, %d, %d]",
+                             index, reg_c, reg_h, reg_w, cls_c, cls_h, cls_w);
+                return NN_RKNN_OUTPUT_ATTR_ERROR;
+            }
+            if (class_num_ != 0 && cls_c != class_num_)
             {
-                for (int j = 0; j < mapSize[index][1]; j++)
+                NN_LOG_ERROR("yolov8 decoder: head %ld class num %d, expect %d", index, cls_c, class_num_);
+                return NN_RKNN_OUTPUT_ATTR_ERROR;
+            }
+            class_num_ = cls_c;
+
+            HeadLayout head;
+            head.grid_h = reg_h;
+            head.grid_w = reg_w;
+            head.stride = input_h_ / reg_h;
+            if (head.stride * reg_h != input_h_ || head.stride * reg_w != input_w_)
+            {
+                NN_LOG_ERROR("yolov8 decoder: head %ld grid %dx%d does not match input %dx%d",
+                             index, reg_w, reg_h, input_w_, input_h_);
+                return NN_RKNN_OUTPUT_ATTR_ERROR;
+            }
+
+            grid_base_.push_back((int)meshgrid_.size());
+            for (int i = 0; i < head.grid_h; i++)
+            {
+                for (int j = 0; j < head.grid_w; j++)
                 {
-                    meshgrid.push_back(float(j + 0.5));
-                    meshgrid.push_back(float(i + 0.5));
+                    meshgrid_.push_back(float(j + 0.5));
+                    meshgrid_.push_back(float(i + 0.5));
                 }
             }
+            heads_.push_back(head);
+            NN_LOG_INFO("yolov8 head %ld: grid %dx%d, stride %d", index, head.grid_w, head.grid_h, head.stride);
         }
+        NN_LOG_INFO("yolov8 decoder: input %dx%d, head num %ld, class num %d", input_w_, input_h_, heads_.size(), class_num_);
 
-        return meshgrid;
+        return NN_SUCCESS;
     }
-    // int8版本
-    int GetConvDetectionResultInt8(int8_t **pBlob, std::vector<int> &qnt_zp, std::vector<float> &qnt_scale,
-                                   std::vector<float> &DetectiontRects)
+
+    void DetectionDecoder::SetThreshold(float objectThreshold, float nmsThreshold)
     {
-        static auto meshgrid = GenerateMeshgrid();
-        int ret = 0;
+        objectThreshold_ = objectThreshold;
+        nmsThreshold_ = nmsThreshold;
+    }
 
-        int gridIndex = -2;
-        float xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+    int DetectionDecoder::GetConvDetectionResultInt8(int8_t **pBlob, const std::vector<int> &qnt_zp, const std::vector<float> &qnt_scale,
+                                                     DecodeScratch &scratch, int8_decode_mode_e mode) const
+    {
         float cls_val = 0;
         float cls_max = 0;
         int cls_index = 0;
@@ -173,11 +259,14 @@ namespace yolo
         int quant_zp_cls = 0, quant_zp_reg = 0;
         float quant_scale_cls = 0, quant_scale_reg = 0;
 
-        DetectRect temp;
-        std::vector<DetectRect> detectRects;
+        NmsBoxes &detectRects = scratch.boxes;
+        std::vector<int32_t> &candidates = scratch.candidates;
+        detectRects.clear();
 
-        for (int index = 0; index < headNum; index++)
+        for (int index = 0; index < (int)heads_.size(); index++)
         {
+            const HeadLayout &head = heads_[index];
+            const float *meshgrid = &meshgrid_[grid_base_[index]];
             int8_t *reg = (int8_t *)pBlob[index * 2 + 0];
             int8_t *cls = (int8_t *)pBlob[index * 2 + 1];
 
@@ -187,235 +276,113 @@ namespace yolo
             quant_scale_reg = qnt_scale[index * 2 + 0];
             quant_scale_cls = qnt_scale[index * 2 + 1];
 
-            for (int h = 0; h < mapSize[index][0]; h++)
+            int plane = head.grid_h * head.grid_w;
+
+            if (mode == INT8_DECODE_QNT_THRESH)
             {
-                for (int w = 0; w < mapSize[index][1]; w++)
+                // 量化域门限和分数查找表，每个输出头的 zp/scale 不同，需要分别计算
+                int qnt_thresh_cls = QntThreshold(objectThreshold_, quant_zp_cls, quant_scale_cls);
+                float sigmoid_lut[256];
+                GenerateSigmoidLut(quant_zp_cls, quant_scale_cls, sigmoid_lut);
+
+                // 向量化扫描所有类别平面，只留下最大类别值不低于门限的格子
+                candidates.resize(plane);
+                int cand_num = ScanInt8Candidates(cls, class_num_, plane, qnt_thresh_cls, candidates.data());
+
+                for (int k = 0; k < cand_num; k++)
                 {
-                    gridIndex += 2;
+                    int offset = candidates[k];
 
-                    for (int cl = 0; cl < class_num; cl++)
+                    // 通过门限的格子查表得到分数，取第一个分数最大的类别，与原始实现一致
+                    for (int cl = 0; cl < class_num_; cl++)
                     {
-                        cls_val = sigmoid(
-                            DeQnt2F32(cls[cl * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w],
-                                      quant_zp_cls, quant_scale_cls));
+                        cls_val = sigmoid_lut[cls[cl * plane + offset] + 128];
 
-                        if (0 == cl)
+                        if (0 == cl || cls_val > cls_max)
                         {
                             cls_max = cls_val;
                             cls_index = cl;
                         }
-                        else
-                        {
-                            if (cls_val > cls_max)
-                            {
-                                cls_max = cls_val;
-                                cls_index = cl;
-                            }
-                        }
                     }
 
-                    if (cls_max > objectThreshold)
+                    if (cls_max > objectThreshold_)
                     {
-                        xmin = (meshgrid[gridIndex + 0] -
-                                DeQnt2F32(reg[0 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w],
-                                          quant_zp_reg, quant_scale_reg)) *
-                               strides[index];
-                        ymin = (meshgrid[gridIndex + 1] -
-                                DeQnt2F32(reg[1 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w],
-                                          quant_zp_reg, quant_scale_reg)) *
-                               strides[index];
-                        xmax = (meshgrid[gridIndex + 0] +
-                                DeQnt2F32(reg[2 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w],
-                                          quant_zp_reg, quant_scale_reg)) *
-                               strides[index];
-                        ymax = (meshgrid[gridIndex + 1] +
-                                DeQnt2F32(reg[3 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w],
-                                          quant_zp_reg, quant_scale_reg)) *
-                               strides[index];
-                                    
-                        xmin = xmin > 0 ? xmin : 0;
-                        ymin = ymin > 0 ? ymin : 0;
-                        xmax = xmax < input_w ? xmax : input_w;
-                        ymax = ymax < input_h ? ymax : input_h;
-
-                        if (xmin >= 0 && ymin >= 0 && xmax <= input_w && ymax <= input_h)
-                        {
-                            temp.xmin = xmin / input_w;
-                            temp.ymin = ymin / input_h;
-                            temp.xmax = xmax / input_w;
-                            temp.ymax = ymax / input_h;
-                            temp.classId = cls_index;
-                            temp.score = cls_max;
-                            temp.P_ID = index;
-                            detectRects.push_back(temp);
-                        }
+                        AppendRectInt8(reg, plane, offset, &meshgrid[offset * 2], head.stride, quant_zp_reg, quant_scale_reg,
+                                       input_w_, input_h_, cls_index, cls_max, detectRects);
                     }
                 }
+                continue;
             }
-        }
 
-        std::sort(detectRects.begin(), detectRects.end(),
-                  [](DetectRect &Rect1, DetectRect &Rect2) -> bool
-                  { return (Rect1.score > Rect2.score); });
-
-        NN_LOG_DEBUG("NMS Before num :%ld", detectRects.size());
-        for (int i = 0; i < detectRects.size(); ++i)
-        {
-            float xmin1 = detectRects[i].xmin;
-            float ymin1 = detectRects[i].ymin;
-            float xmax1 = detectRects[i].xmax;
-            float ymax1 = detectRects[i].ymax;
-            int classId = detectRects[i].classId;
-            float score = detectRects[i].score;
-
-            if (classId != -1)
+            for (int offset = 0; offset < plane; offset++)
             {
-                // 将检测结果按照classId、score、xmin1、ymin1、xmax1、ymax1 的格式存放在vector<float>中
-                DetectiontRects.push_back(float(classId));
-                DetectiontRects.push_back(float(score));
-                DetectiontRects.push_back(float(xmin1));
-                DetectiontRects.push_back(float(ymin1));
-                DetectiontRects.push_back(float(xmax1));
-                DetectiontRects.push_back(float(ymax1));
-
-                for (int j = i + 1; j < detectRects.size(); ++j)
+                for (int cl = 0; cl < class_num_; cl++)
                 {
-                    float xmin2 = detectRects[j].xmin;
-                    float ymin2 = detectRects[j].ymin;
-                    float xmax2 = detectRects[j].xmax;
-                    float ymax2 = detectRects[j].ymax;
-                    float iou = IOU(xmin1, ymin1, xmax1, ymax1, xmin2, ymin2, xmax2, ymax2);
-                    if (iou > nmsThreshold)
+                    cls_val = sigmoid(DeQnt2F32(cls[cl * plane + offset], quant_zp_cls, quant_scale_cls));
+
+                    if (0 == cl || cls_val > cls_max)
                     {
-                        detectRects[j].classId = -1;
+                        cls_max = cls_val;
+                        cls_index = cl;
                     }
                 }
+
+                if (cls_max > objectThreshold_)
+                {
+                    AppendRectInt8(reg, plane, offset, &meshgrid[offset * 2], head.stride, quant_zp_reg, quant_scale_reg,
+                                   input_w_, input_h_, cls_index, cls_max, detectRects);
+                }
             }
         }
 
-        return ret;
+        return NmsRects(scratch, nmsThreshold_, max_det_);
     }
-    // 浮点数版本
-    int GetConvDetectionResult(float **pBlob, std::vector<float> &DetectiontRects)
-    {
-        static auto meshgrid = GenerateMeshgrid();
-        int ret = 0;
 
-        int gridIndex = -2;
-        float xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+    int DetectionDecoder::GetConvDetectionResult(float **pBlob, DecodeScratch &scratch) const
+    {
         float cls_val = 0;
         float cls_max = 0;
         int cls_index = 0;
 
-        DetectRect temp;
-        std::vector<DetectRect> detectRects;
+        NmsBoxes &detectRects = scratch.boxes;
+        detectRects.clear();
 
-        for (int index = 0; index < headNum; index++)
+        for (int index = 0; index < (int)heads_.size(); index++)
         {
+            const HeadLayout &head = heads_[index];
+            const float *meshgrid = &meshgrid_[grid_base_[index]];
             float *reg = (float *)pBlob[index * 2 + 0];
             float *cls = (float *)pBlob[index * 2 + 1];
 
-            for (int h = 0; h < mapSize[index][0]; h++)
+            int plane = head.grid_h * head.grid_w;
+
+            for (int offset = 0; offset < plane; offset++)
             {
-                for (int w = 0; w < mapSize[index][1]; w++)
+                for (int cl = 0; cl < class_num_; cl++)
                 {
-                    gridIndex += 2;
-
-                    for (int cl = 0; cl < class_num; cl++)
-                    {
-                        cls_val = sigmoid(
-                            cls[cl * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w]);
-
-                        if (0 == cl)
-                        {
-                            cls_max = cls_val;
-                            cls_index = cl;
-                        }
-                        else
-                        {
-                            if (cls_val > cls_max)
-                            {
-                                cls_max = cls_val;
-                                cls_index = cl;
-                            }
-                        }
-                    }
+                    cls_val = sigmoid(cls[cl * plane + offset]);
 
-                    if (cls_max > objectThreshold)
+                    if (0 == cl || cls_val > cls_max)
                     {
-                        xmin = (meshgrid[gridIndex + 0] -
-                                reg[0 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w]) *
-                               strides[index];
-                        ymin = (meshgrid[gridIndex + 1] -
-                                reg[1 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w]) *
-                               strides[index];
-                        xmax = (meshgrid[gridIndex + 0] +
-                                reg[2 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w]) *
-                               strides[index];
-                        ymax = (meshgrid[gridIndex + 1] +
-                                reg[3 * mapSize[index][0] * mapSize[index][1] + h * mapSize[index][1] + w]) *
-                               strides[index];
-
-                        xmin = xmin > 0 ? xmin : 0;
-                        ymin = ymin > 0 ? ymin : 0;
-                        xmax = xmax < input_w ? xmax : input_w;
-                        ymax = ymax < input_h ? ymax : input_h;
-
-                        if (xmin >= 0 && ymin >= 0 && xmax <= input_w && ymax <= input_h)
-                        {
-                            temp.xmin = xmin / input_w;
-                            temp.ymin = ymin / input_h;
-                            temp.xmax = xmax / input_w;
-                            temp.ymax = ymax / input_h;
-                            temp.classId = cls_index;
-                            temp.score = cls_max;
-                            detectRects.push_back(temp);
-                        }
+                        cls_max = cls_val;
+                        cls_index = cl;
                     }
                 }
-            }
-        }
-
-        std::sort(detectRects.begin(), detectRects.end(),
-                  [](DetectRect &Rect1, DetectRect &Rect2) -> bool
-                  { return (Rect1.score > Rect2.score); });
 
-        NN_LOG_DEBUG("NMS Before num :%ld", detectRects.size());
-        for (int i = 0; i < detectRects.size(); ++i)
-        {
-            float xmin1 = detectRects[i].xmin;
-            float ymin1 = detectRects[i].ymin;
-            float xmax1 = detectRects[i].xmax;
-            float ymax1 = detectRects[i].ymax;
-            int classId = detectRects[i].classId;
-            float score = detectRects[i].score;
-
-            if (classId != -1)
-            {
-                // 将检测结果按照classId、score、xmin1、ymin1、xmax1、ymax1 的格式存放在vector<float>中
-                DetectiontRects.push_back(float(classId));
-                DetectiontRects.push_back(float(score));
-                DetectiontRects.push_back(float(xmin1));
-                DetectiontRects.push_back(float(ymin1));
-                DetectiontRects.push_back(float(xmax1));
-                DetectiontRects.push_back(float(ymax1));
-
-                for (int j = i + 1; j < detectRects.size(); ++j)
+                if (cls_max > objectThreshold_)
                 {
-                    float xmin2 = detectRects[j].xmin;
-                    float ymin2 = detectRects[j].ymin;
-                    float xmax2 = detectRects[j].xmax;
-                    float ymax2 = detectRects[j].ymax;
-                    float iou = IOU(xmin1, ymin1, xmax1, ymax1, xmin2, ymin2, xmax2, ymax2);
-                    if (iou > nmsThreshold)
-                    {
-                        detectRects[j].classId = -1;
-                    }
+                    const float *grid = &meshgrid[offset * 2];
+                    float xmin = (grid[0] - reg[0 * plane + offset]) * head.stride;
+                    float ymin = (grid[1] - reg[1 * plane + offset]) * head.stride;
+                    float xmax = (grid[0] + reg[2 * plane + offset]) * head.stride;
+                    float ymax = (grid[1] + reg[3 * plane + offset]) * head.stride;
+
+                    AppendRect(xmin, ymin, xmax, ymax, input_w_, input_h_, cls_index, cls_max, detectRects);
                 }
             }
         }
 
-        return ret;
+        return NmsRects(scratch, nmsThreshold_, max_det_);
     }
 
-}
\ No newline at end of file
+}
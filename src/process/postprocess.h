@@ -1,16 +1,82 @@
-
 #ifndef RK3588_DEMO_POSTPROCESS_H
 #define RK3588_DEMO_POSTPROCESS_H
 
 #include <stdint.h>
 #include <vector>
 
+#include "types/datatype.h"
+#include "process/nms.h"
+
 int get_top(float *pfProb, float *pfMaxProb, uint32_t *pMaxClass, uint32_t outputCount, uint32_t topNum);
 
 namespace yolo
 {
-    int GetConvDetectionResultInt8(int8_t **pBlob, std::vector<int> &qnt_zp, std::vector<float> &qnt_scale, std::vector<float> &DetectiontRects); // int8版本
-    int GetConvDetectionResult(float **pBlob, std::vector<float> &DetectiontRects);
+    // int8 后处理的解码方式
+    typedef enum
+    {
+        INT8_DECODE_DEQNT = 0,      // 每个类别先反量化再 sigmoid，最后与阈值比较（原始实现）
+        INT8_DECODE_QNT_THRESH = 1, // 阈值预先换算成每个输出头的 int8 门限，只对通过门限的格子做反量化和框回归
+    } int8_decode_mode_e;
+
+    // 一个检测头的布局
+    struct HeadLayout
+    {
+        int grid_h; // 特征图高
+        int grid_w; // 特征图宽
+        int stride; // 下采样倍数
+    };
+
+    // 一次解码用到的临时缓冲区，由调用者持有并在多帧之间重复使用，容量稳定后解码不再申请内存
+    // 解码结果为 boxes 中下标在 keep 里的框，按分数降序，坐标为归一化后的 [0, 1]
+    struct DecodeScratch
+    {
+        NmsBoxes boxes;                  // NMS 之前的候选框
+        std::vector<int32_t> candidates; // int8 门限扫描得到的格子
+        NmsEngine nms;
+        std::vector<int> keep;           // NMS 保留的框
+    };
+
+    // 检测结果解码器，每个模型一个
+    // 检测头的数量、特征图大小、stride 和类别数在加载模型时由输入输出张量的形状推导，
+    // meshgrid 也由解码器自己持有，不同结构的模型（P3-P5 三个头、带 P2 的四个头）可以在同一进程中同时使用
+    class DetectionDecoder
+    {
+    public:
+        /**
+         * @brief 根据模型输入输出张量推导检测头布局，生成 meshgrid
+         * 输出张量按 (回归, 类别) 成对排列，回归为 [1, 4, H, W]，类别为 [1, class_num, H, W]
+         * @param input 输入张量属性
+         * @param outputs 输出张量属性
+         * @return nn_error_e 错误码
+         */
+        nn_error_e Init(const tensor_attr_s &input, const std::vector<tensor_attr_s> &outputs);
+
+        // int8版本，返回保留的框数
+        int GetConvDetectionResultInt8(int8_t **pBlob, const std::vector<int> &qnt_zp, const std::vector<float> &qnt_scale,
+                                       DecodeScratch &scratch, int8_decode_mode_e mode = INT8_DECODE_QNT_THRESH) const;
+        // 浮点数版本，返回保留的框数
+        int GetConvDetectionResult(float **pBlob, DecodeScratch &scratch) const;
+
+        void SetThreshold(float objectThreshold, float nmsThreshold);
+        // NMS 最多保留的框数，<= 0 表示不限制
+        void SetMaxDetections(int max_det) { max_det_ = max_det; }
+
+        int GetHeadNum() const { return (int)heads_.size(); }
+        int GetClassNum() const { return class_num_; }
+        int GetOutputNum() const { return (int)heads_.size() * 2; }
+        const std::vector<HeadLayout> &GetHeads() const { return heads_; }
+
+    private:
+        int input_w_ = 0;
+        int input_h_ = 0;
+        int class_num_ = 0;
+        float objectThreshold_ = 0.35;
+        float nmsThreshold_ = 0.15;
+        int max_det_ = 0;
+        std::vector<HeadLayout> heads_;
+        std::vector<int> grid_base_; // 每个检测头在 meshgrid 中的起始位置
+        std::vector<float> meshgrid_;
+    };
 
 }
 
@@ -4,6 +4,13 @@
 
 #include "utils/logging.h"
 
+#include <algorithm>
+#include <math.h>
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 // opencv 版本的 letterbox
 LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio)
 {
@@ -58,6 +65,31 @@ LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_rat
      */
     // 使用cv::copyMakeBorder函数进行填充边界
     cv::copyMakeBorder(img, img_letterbox, padding_ver, padding_ver, padding_hor, padding_hor, cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
+    info.width = img_letterbox.cols;
+    info.height = img_letterbox.rows;
+    return info;
+}
+
+// 与 letterbox 相同的计算，但不生成填充后的图像
+LetterBoxInfo letterbox_info(int img_width, int img_height, float wh_ratio)
+{
+    LetterBoxInfo info;
+    if ((float)img_width / (float)img_height > wh_ratio)
+    {
+        info.hor = false;
+        int letterbox_height = (float)img_width / wh_ratio;
+        info.pad = (letterbox_height - img_height) / 2.f;
+        info.width = img_width;
+        info.height = img_height + info.pad * 2;
+    }
+    else
+    {
+        info.hor = true;
+        int letterbox_width = (float)img_height * wh_ratio;
+        info.pad = (letterbox_width - img_width) / 2.f;
+        info.width = img_width + info.pad * 2;
+        info.height = img_height;
+    }
     return info;
 }
 
@@ -82,3 +114,247 @@ void mat2Tensor(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data
 }
 
 
+
+// 拷贝 NV12 视图，去掉行对齐，得到紧凑的单通道 Mat
+void nv12View2Mat(const nv12_frame_view &frame, cv::Mat &nv12)
+{
+    nv12.create(frame.height + frame.height / 2, frame.width, CV_8UC1);
+    for (int y = 0; y < frame.height; y++)
+    {
+        memcpy(nv12.ptr(y), frame.y + (size_t)y * frame.y_stride, frame.width);
+    }
+    for (int y = 0; y < frame.height / 2; y++)
+    {
+        memcpy(nv12.ptr(frame.height + y), frame.uv + (size_t)y * frame.uv_stride, frame.width);
+    }
+}
+
+nv12_frame_view nv12Mat2View(const cv::Mat &nv12)
+{
+    nv12_frame_view frame;
+    frame.width = nv12.cols;
+    frame.height = nv12.rows * 2 / 3;
+    frame.y = nv12.ptr(0);
+    frame.uv = nv12.ptr(frame.height);
+    frame.y_stride = (int)nv12.step;
+    frame.uv_stride = (int)nv12.step;
+    return frame;
+}
+
+// 定点系数位数，与 OpenCV INTER_RESIZE_COEF_BITS 一致
+static const int kResizeCoefBits = 11;
+static const int kResizeCoefScale = 1 << kResizeCoefBits;
+
+// 计算一个方向上的插值系数
+// 坐标映射与 cv::resize(INTER_LINEAR) 相同，作用在填充后的图像上（长度 padded_len，原图从 pad 开始）
+// 落在填充区的采样点权重为 0，下标取一个合法值，这样不需要额外的分支
+static void ComputeResizeCoefs(int src_len, int pad, int padded_len, int dst_len,
+                               int32_t *ofs, int16_t *coef)
+{
+    double scale = (double)padded_len / dst_len;
+    for (int d = 0; d < dst_len; d++)
+    {
+        float f = (float)((d + 0.5) * scale - 0.5);
+        int s = (int)floorf(f);
+        f -= s;
+        if (s < 0)
+        {
+            s = 0;
+            f = 0.f;
+        }
+        if (s >= padded_len - 1)
+        {
+            s = padded_len - 1;
+            f = 0.f;
+        }
+        int16_t c0 = (int16_t)std::min(kResizeCoefScale, (int)lrintf((1.f - f) * kResizeCoefScale));
+        int16_t c1 = (int16_t)(kResizeCoefScale - c0);
+
+        int taps[2] = {s - pad, std::min(s + 1, padded_len - 1) - pad};
+        int16_t w[2] = {c0, c1};
+        for (int k = 0; k < 2; k++)
+        {
+            if (taps[k] < 0 || taps[k] >= src_len)
+            {
+                taps[k] = 0;
+                w[k] = 0;
+            }
+            ofs[d * 2 + k] = taps[k];
+            coef[d * 2 + k] = w[k];
+        }
+    }
+}
+
+void LetterboxResizer::Init(int src_w, int src_h, int dst_w, int dst_h)
+{
+    if (src_w == src_w_ && src_h == src_h_ && dst_w == dst_w_ && dst_h == dst_h_)
+    {
+        return;
+    }
+    src_w_ = src_w;
+    src_h_ = src_h;
+    dst_w_ = dst_w;
+    dst_h_ = dst_h;
+    info_ = letterbox_info(src_w, src_h, (float)dst_w / (float)dst_h);
+
+    int pad_x = info_.hor ? info_.pad : 0;
+    int pad_y = info_.hor ? 0 : info_.pad;
+
+    xofs_.resize(dst_w * 2);
+    alpha_.resize(dst_w * 2);
+    ComputeResizeCoefs(src_w, pad_x, info_.width, dst_w, xofs_.data(), alpha_.data());
+
+    yofs_.resize(dst_h * 2);
+    beta_.resize(dst_h * 2);
+    ComputeResizeCoefs(src_h, pad_y, info_.height, dst_h, yofs_.data(), beta_.data());
+
+    for (int i = 0; i < 2; i++)
+    {
+        rows_[i].resize(dst_w * 3);
+        row_y_[i] = -1;
+    }
+}
+
+// 水平方向插值，同时完成 BGR -> RGB
+void LetterboxResizer::ResizeRow(const uint8_t *src_row, int32_t *dst_row) const
+{
+    const int32_t *xofs = xofs_.data();
+    const int16_t *alpha = alpha_.data();
+    for (int x = 0; x < dst_w_; x++)
+    {
+        const uint8_t *p0 = src_row + xofs[x * 2] * 3;
+        const uint8_t *p1 = src_row + xofs[x * 2 + 1] * 3;
+        int a0 = alpha[x * 2];
+        int a1 = alpha[x * 2 + 1];
+        dst_row[x * 3 + 0] = p0[2] * a0 + p1[2] * a1;
+        dst_row[x * 3 + 1] = p0[1] * a0 + p1[1] * a1;
+        dst_row[x * 3 + 2] = p0[0] * a0 + p1[0] * a1;
+    }
+}
+
+// NV12 转 RGB 的定点系数（BT.601 limited range），与 cv::COLOR_YUV2BGR_NV12 一致
+static const int kYuvShift = 20;
+static const int kYuvCY = 1220542;
+static const int kYuvCUB = 2116026;
+static const int kYuvCUG = -409993;
+static const int kYuvCVG = -852492;
+static const int kYuvCVR = 1673527;
+
+static inline uint8_t ClampU8(int v)
+{
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static inline void YuvToRgb(int y, int u, int v, int rgb[3])
+{
+    int yy = std::max(0, y - 16) * kYuvCY;
+    int round = 1 << (kYuvShift - 1);
+    u -= 128;
+    v -= 128;
+    rgb[0] = ClampU8((yy + kYuvCVR * v + round) >> kYuvShift);
+    rgb[1] = ClampU8((yy + kYuvCVG * v + kYuvCUG * u + round) >> kYuvShift);
+    rgb[2] = ClampU8((yy + kYuvCUB * u + round) >> kYuvShift);
+}
+
+// NV12 行的水平插值，每个采样点先转成 RGB 再加权
+void LetterboxResizer::ResizeRowNV12(const uint8_t *y_row, const uint8_t *uv_row, int32_t *dst_row) const
+{
+    const int32_t *xofs = xofs_.data();
+    const int16_t *alpha = alpha_.data();
+    for (int x = 0; x < dst_w_; x++)
+    {
+        int rgb0[3], rgb1[3];
+        int x0 = xofs[x * 2];
+        int x1 = xofs[x * 2 + 1];
+        YuvToRgb(y_row[x0], uv_row[x0 & ~1], uv_row[(x0 & ~1) + 1], rgb0);
+        YuvToRgb(y_row[x1], uv_row[x1 & ~1], uv_row[(x1 & ~1) + 1], rgb1);
+        int a0 = alpha[x * 2];
+        int a1 = alpha[x * 2 + 1];
+        dst_row[x * 3 + 0] = rgb0[0] * a0 + rgb1[0] * a1;
+        dst_row[x * 3 + 1] = rgb0[1] * a0 + rgb1[1] * a1;
+        dst_row[x * 3 + 2] = rgb0[2] * a0 + rgb1[2] * a1;
+    }
+}
+
+// 取源图第 sy 行的水平插值结果，相邻目标行通常共用源行，命中缓存时不重复计算
+const int32_t *LetterboxResizer::GetRow(int sy, int slot)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (row_y_[i] == sy)
+        {
+            return rows_[i].data();
+        }
+    }
+    // 另一行缓存正在被当前目标行使用，只能覆盖 slot 指定的那一个
+    if (nv12_ != nullptr)
+    {
+        ResizeRowNV12(nv12_->y + (size_t)sy * nv12_->y_stride, nv12_->uv + (size_t)(sy / 2) * nv12_->uv_stride,
+                      rows_[slot].data());
+    }
+    else
+    {
+        ResizeRow(bgr_ + (size_t)sy * bgr_stride_, rows_[slot].data());
+    }
+    row_y_[slot] = sy;
+    return rows_[slot].data();
+}
+
+void LetterboxResizer::Run(const uint8_t *bgr, int src_stride, uint8_t *dst)
+{
+    bgr_ = bgr;
+    bgr_stride_ = src_stride;
+    nv12_ = nullptr;
+    Resize(dst);
+}
+
+void LetterboxResizer::Run(const nv12_frame_view &frame, uint8_t *dst)
+{
+    bgr_ = nullptr;
+    nv12_ = &frame;
+    Resize(dst);
+    nv12_ = nullptr;
+}
+
+void LetterboxResizer::Resize(uint8_t *dst)
+{
+    const int row_len = dst_w_ * 3;
+    const int32_t delta = 1 << (kResizeCoefBits * 2 - 1);
+    row_y_[0] = row_y_[1] = -1;
+
+    for (int y = 0; y < dst_h_; y++)
+    {
+        int b0 = beta_[y * 2];
+        int b1 = beta_[y * 2 + 1];
+        uint8_t *out = dst + (size_t)y * row_len;
+        if (b0 == 0 && b1 == 0)
+        {
+            // 整行落在填充区
+            memset(out, 0, row_len);
+            continue;
+        }
+        const int32_t *r0 = GetRow(yofs_[y * 2], 0);
+        // 第一行命中的是 slot 1 时，第二行只能写 slot 0
+        int slot1 = (r0 == rows_[1].data()) ? 0 : 1;
+        const int32_t *r1 = GetRow(yofs_[y * 2 + 1], slot1);
+
+        int x = 0;
+#if defined(__aarch64__) || defined(__ARM_NEON)
+        int32x4_t vdelta = vdupq_n_s32(delta);
+        for (; x + 8 <= row_len; x += 8)
+        {
+            int32x4_t lo = vmlaq_n_s32(vmulq_n_s32(vld1q_s32(r0 + x), b0), vld1q_s32(r1 + x), b1);
+            int32x4_t hi = vmlaq_n_s32(vmulq_n_s32(vld1q_s32(r0 + x + 4), b0), vld1q_s32(r1 + x + 4), b1);
+            lo = vshrq_n_s32(vaddq_s32(lo, vdelta), kResizeCoefBits * 2);
+            hi = vshrq_n_s32(vaddq_s32(hi, vdelta), kResizeCoefBits * 2);
+            int16x8_t v = vcombine_s16(vmovn_s32(lo), vmovn_s32(hi));
+            vst1_u8(out + x, vqmovun_s16(v));
+        }
+#endif
+        for (; x < row_len; x++)
+        {
+            int v = (r0[x] * b0 + r1[x] * b1 + delta) >> (kResizeCoefBits * 2);
+            out[x] = (uint8_t)std::min(255, std::max(0, v));
+        }
+    }
+}
@@ -5,14 +5,62 @@
 
 #include <opencv2/opencv.hpp>
 #include "types/datatype.h"
+#include "types/video_infos_type.h"
+
+#include <vector>
 
 struct LetterBoxInfo
 {
     bool hor;
     int pad;
+    int width;  // 填充后图像的宽
+    int height; // 填充后图像的高
 };
 
 LetterBoxInfo letterbox(const cv::Mat &img, cv::Mat &img_letterbox, float wh_ratio);
+LetterBoxInfo letterbox_info(int img_width, int img_height, float wh_ratio); // 只计算 letterbox 信息，不生成填充后的图像
 void mat2Tensor(const cv::Mat &img, uint32_t width, uint32_t height, tensor_data_s &tensor);
+// 把 NV12 视图拷贝成紧凑的单通道 Mat（高度为 height * 3 / 2），以及反过来从这样的 Mat 构造视图
+void nv12View2Mat(const nv12_frame_view &frame, cv::Mat &nv12);
+nv12_frame_view nv12Mat2View(const cv::Mat &nv12);
+
+// 融合的 letterbox + resize + BGR2RGB（或 NV12 转 RGB）
+// 源图只读一次，缩放、通道交换和填充的结果直接写入 NHWC uint8 输入张量，中间不分配内存
+// 缩放系数在 Init 时预先计算为定点整数，双线性插值与 letterbox + cv::resize(INTER_LINEAR) 的结果相差不超过 1
+class LetterboxResizer
+{
+public:
+    // 源图或目标尺寸变化时重新计算系数，尺寸不变时直接返回
+    void Init(int src_w, int src_h, int dst_w, int dst_h);
+    // bgr: 源图数据，src_stride: 源图每行字节数，dst: 张量数据（dst_h * dst_w * 3）
+    void Run(const uint8_t *bgr, int src_stride, uint8_t *dst);
+    // NV12 输入，只对参与插值的采样点做 YUV -> RGB 转换，不生成整帧 BGR 图像
+    void Run(const nv12_frame_view &frame, uint8_t *dst);
+    const LetterBoxInfo &GetInfo() const { return info_; }
+
+private:
+    void Resize(uint8_t *dst);
+    void ResizeRow(const uint8_t *src_row, int32_t *dst_row) const;
+    void ResizeRowNV12(const uint8_t *y_row, const uint8_t *uv_row, int32_t *dst_row) const;
+    const int32_t *GetRow(int sy, int slot);
+
+    // 当前这次 Run 的输入，二选一
+    const uint8_t *bgr_ = nullptr;
+    int bgr_stride_ = 0;
+    const nv12_frame_view *nv12_ = nullptr;
+
+    int src_w_ = 0;
+    int src_h_ = 0;
+    int dst_w_ = 0;
+    int dst_h_ = 0;
+    LetterBoxInfo info_ = {false, 0, 0, 0};
+
+    std::vector<int32_t> xofs_;  // 每个目标列的两个源像素列号
+    std::vector<int16_t> alpha_; // 每个目标列的两个水平权重，落在填充区的权重为 0
+    std::vector<int32_t> yofs_;  // 每个目标行的两个源行号
+    std::vector<int16_t> beta_;  // 每个目标行的两个垂直权重，落在填充区的权重为 0
+    std::vector<int32_t> rows_[2]; // 水平缩放后的行缓存
+    int row_y_[2] = {-1, -1};      // 行缓存对应的源行号
+};
 
 #endif // RK3588_DEMO_PREPROCESS_H
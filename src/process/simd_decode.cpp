@@ -0,0 +1,115 @@
+// int8 检测头的向量化扫描
+
+#include "simd_decode.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define YOLO_SIMD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define YOLO_SIMD_SSE2 1
+#endif
+
+namespace yolo
+{
+    // 按位扫描 16 个格子的比较结果，把选中的格子下标写入 candidates
+    static inline int EmitCandidates(uint32_t mask, int base, int32_t *candidates, int num)
+    {
+        while (mask)
+        {
+            candidates[num++] = base + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+        return num;
+    }
+
+    // 16 个格子的通用实现，同时用于尾部不足 16 个格子的情况
+    static inline uint32_t ScanBlockGeneric(const int8_t *cls, int class_num, int cells, int base, int count, int qnt_thresh)
+    {
+        uint32_t mask = 0;
+        for (int i = 0; i < count; i++)
+        {
+            int8_t qnt_max = cls[base + i];
+            for (int cl = 1; cl < class_num; cl++)
+            {
+                int8_t v = cls[cl * cells + base + i];
+                qnt_max = v > qnt_max ? v : qnt_max;
+            }
+            if (qnt_max >= qnt_thresh)
+            {
+                mask |= 1u << i;
+            }
+        }
+        return mask;
+    }
+
+    int ScanInt8Candidates(const int8_t *cls, int class_num, int cells, int qnt_thresh, int32_t *candidates)
+    {
+        int num = 0;
+        if (class_num <= 0 || cells <= 0 || qnt_thresh > 127)
+        {
+            return 0;
+        }
+        if (qnt_thresh <= -128)
+        {
+            // 门限低于 int8 最小值，所有格子都通过
+            for (int i = 0; i < cells; i++)
+            {
+                candidates[num++] = i;
+            }
+            return num;
+        }
+
+        int i = 0;
+        // qnt_max >= qnt_thresh 等价于 qnt_max > qnt_thresh - 1，此时 qnt_thresh - 1 仍在 int8 范围内
+        int8_t thresh_gt = (int8_t)(qnt_thresh - 1);
+#if defined(YOLO_SIMD_NEON)
+        static const uint8_t kBitWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        const uint8x16_t vweights = vld1q_u8(kBitWeights);
+        const int8x16_t vthresh = vdupq_n_s8(thresh_gt);
+        for (; i + 16 <= cells; i += 16)
+        {
+            int8x16_t vmax = vld1q_s8(cls + i);
+            for (int cl = 1; cl < class_num; cl++)
+            {
+                vmax = vmaxq_s8(vmax, vld1q_s8(cls + cl * cells + i));
+            }
+            uint8x16_t vcmp = vcgtq_s8(vmax, vthresh);
+            // 绝大多数格子都低于门限，先整体判断一次
+            if (vmaxvq_u8(vcmp) == 0)
+            {
+                continue;
+            }
+            uint8x16_t vbits = vandq_u8(vcmp, vweights);
+            uint32_t mask = vaddv_u8(vget_low_u8(vbits)) | ((uint32_t)vaddv_u8(vget_high_u8(vbits)) << 8);
+            num = EmitCandidates(mask, i, candidates, num);
+        }
+#elif defined(YOLO_SIMD_SSE2)
+        // SSE2 没有有符号 int8 的 max，先异或 0x80 转成无符号再求最大值
+        const __m128i vbias = _mm_set1_epi8((char)0x80);
+        const __m128i vthresh = _mm_set1_epi8(thresh_gt);
+        for (; i + 16 <= cells; i += 16)
+        {
+            __m128i vmax = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(cls + i)), vbias);
+            for (int cl = 1; cl < class_num; cl++)
+            {
+                __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(cls + cl * cells + i)), vbias);
+                vmax = _mm_max_epu8(vmax, v);
+            }
+            __m128i vcmp = _mm_cmpgt_epi8(_mm_xor_si128(vmax, vbias), vthresh);
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(vcmp);
+            num = EmitCandidates(mask, i, candidates, num);
+        }
+#else
+        for (; i + 16 <= cells; i += 16)
+        {
+            num = EmitCandidates(ScanBlockGeneric(cls, class_num, cells, i, 16, qnt_thresh), i, candidates, num);
+        }
+#endif
+        if (i < cells)
+        {
+            num = EmitCandidates(ScanBlockGeneric(cls, class_num, cells, i, cells - i, qnt_thresh), i, candidates, num);
+        }
+        return num;
+    }
+}
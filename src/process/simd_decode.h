@@ -0,0 +1,23 @@
+// int8 检测头的向量化扫描
+
+#ifndef RK3588_DEMO_SIMD_DECODE_H
+#define RK3588_DEMO_SIMD_DECODE_H
+
+#include <stdint.h>
+
+namespace yolo
+{
+    /**
+     * @brief 每次处理 16 个格子，在 class_num 个类别平面上求纵向最大值，与门限比较后按位扫描得到候选格子
+     * RK3588 上使用 NEON，x86 上使用 SSE2，其余平台使用通用实现
+     * @param cls 类别输出，平面布局 [class_num][cells]
+     * @param class_num 类别数
+     * @param cells 每个平面的格子数（H * W）
+     * @param qnt_thresh 量化域门限，最大类别值 >= 门限的格子会被选中，范围 [-128, 128]
+     * @param candidates 输出候选格子下标，容量至少为 cells，结果按下标升序
+     * @return int 候选格子个数
+     */
+    int ScanInt8Candidates(const int8_t *cls, int class_num, int cells, int qnt_thresh, int32_t *candidates);
+}
+
+#endif // RK3588_DEMO_SIMD_DECODE_H
@@ -67,12 +67,13 @@ static size_t nn_tensor_type_to_size(tensor_datatype_e type)
     }
 }
 
-static void nn_tensor_attr_to_cvimg_input_data(const tensor_attr_s &attr, tensor_data_s &data)
+// 输入张量属性转换为 NHWC uint8 图像输入，dims[0] 为批大小，size 包含整批
+static nn_error_e nn_tensor_attr_to_cvimg_input_data(const tensor_attr_s &attr, tensor_data_s &data)
 {
     if (attr.n_dims != 4)
     {
-        NN_LOG_ERROR("unsupported input dims");
-        exit(-1);
+        NN_LOG_ERROR("unsupported input dims %d", attr.n_dims);
+        return NN_RKNN_INPUT_ATTR_ERROR;
     }
     data.attr.n_dims = attr.n_dims;
     data.attr.index = 0;
@@ -95,12 +96,17 @@ static void nn_tensor_attr_to_cvimg_input_data(const tensor_attr_s &attr, tensor
     else
     {
         NN_LOG_ERROR("unsupported input layout");
-        exit(-1);
+        return NN_RKNN_INPUT_ATTR_ERROR;
+    }
+    if (data.attr.dims[0] < 1)
+    {
+        data.attr.dims[0] = 1;
     }
     // multiply all dims
     data.attr.n_elems = data.attr.dims[0] * data.attr.dims[1] *
                         data.attr.dims[2] * data.attr.dims[3];
     data.attr.size = data.attr.n_elems * sizeof(uint8_t);
+    return NN_SUCCESS;
 }
 
 #endif // RK3588_DEMO_DATATYPE_H
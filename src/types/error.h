@@ -18,6 +18,9 @@ typedef enum
     NN_RKNN_MODEL_NOT_LOAD = -10,   // rknn模型未加载
     NN_STOPED = -11,                // 程序已停止
     NN_TIMEOUT = -12,          // 超时
+    NN_INVALID_PARAM = -13,         // 参数无效
+    NN_QUEUE_FULL = -14,            // 队列已满，数据被丢弃
+    NN_UNSUPPORTED = -15,           // 引擎不支持该功能
 } nn_error_e;
 
 #endif // RK3588_DEMO_ERROR_H
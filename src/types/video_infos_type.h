@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include <stdint.h>
 
 
 // video_infos_type.h
@@ -24,3 +25,14 @@ struct  video_encoder_info
     int encoder_delay;  // 编码器延迟（单位：毫秒）
 };
 
+
+// NV12 帧视图，只引用解码器输出的 Y/UV 平面，不持有内存
+struct nv12_frame_view
+{
+    const uint8_t *y;   // Y 平面
+    const uint8_t *uv;  // 交错的 UV 平面，高度为 Y 平面的一半
+    int y_stride;       // Y 平面每行字节数
+    int uv_stride;      // UV 平面每行字节数
+    int width;          // 图像宽度（单位：像素）
+    int height;         // 图像高度（单位：像素）
+};
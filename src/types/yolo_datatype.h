@@ -3,6 +3,11 @@
 #ifndef RK3588_DEMO_NN_DATATYPE_H
 #define RK3588_DEMO_NN_DATATYPE_H
 
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 
 typedef struct _nn_object_s {
@@ -14,13 +19,202 @@ typedef struct _nn_object_s {
     int class_id;
 } nn_object_s;
 
+// 一个检测框，只保存类别编号，名称和颜色在绘制、序列化时从模型的类别表中查
 struct Detection
 {
     int class_id{0};
-    std::string className{};
     float confidence{0.0};
-    cv::Scalar color{};
     cv::Rect box{};
 };
 
+// 检测结果的内存池：每块 block_size 个检测框（每帧最多保留的框数），用完归还
+// 块只在池中不够用时申请，数量等于同时持有检测结果的帧数的峰值，稳态下不再申请内存
+class DetectionArena
+{
+public:
+    explicit DetectionArena(int block_size) : block_size_(block_size > 0 ? block_size : 1) {}
+
+    DetectionArena(const DetectionArena &) = delete;
+    DetectionArena &operator=(const DetectionArena &) = delete;
+
+    int block_size() const { return block_size_; }
+
+    Detection *Acquire()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (free_.empty())
+        {
+            blocks_.emplace_back(new Detection[block_size_]);
+            return blocks_.back().get();
+        }
+        Detection *block = free_.back();
+        free_.pop_back();
+        return block;
+    }
+
+    void Release(Detection *block)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        free_.push_back(block);
+    }
+
+    // 已申请的块数
+    size_t GetBlockCount()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return blocks_.size();
+    }
+
+private:
+    int block_size_;
+    std::mutex mtx_;
+    std::vector<Detection *> free_;
+    std::vector<std::unique_ptr<Detection[]>> blocks_;
+};
+
+// 一帧的检测结果，随帧一起传递，存储是从 DetectionArena 取得的一块，移动时只交换指针
+// 没有存储的列表（默认构造、没有检测框）只有几个指针大小，重排缓冲区中的空槽位不占检测框的内存
+// 存储由解码器用 Reset 取得，容量为每帧最多保留的框数，超出容量的框被丢弃
+class DetectionList
+{
+public:
+    DetectionList() = default;
+    DetectionList(const DetectionList &other) { *this = other; }
+    DetectionList(DetectionList &&other) noexcept { swap(other); }
+    ~DetectionList() { Release(); }
+
+    DetectionList &operator=(const DetectionList &other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+        count_ = 0;
+        if (other.count_ == 0)
+        {
+            return *this;
+        }
+        // 已有的块放得下时沿用，稳态下复制不申请内存
+        if (items_ == nullptr || capacity() < other.count_)
+        {
+            Reset(other.arena_);
+        }
+        std::copy(other.begin(), other.end(), items_);
+        count_ = other.count_;
+        return *this;
+    }
+
+    DetectionList &operator=(DetectionList &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Release();
+            swap(other);
+        }
+        return *this;
+    }
+
+    void swap(DetectionList &other) noexcept
+    {
+        std::swap(arena_, other.arena_);
+        std::swap(items_, other.items_);
+        std::swap(count_, other.count_);
+    }
+
+    // 清空，并确保存储来自 arena；已有同一个 arena 的块时沿用
+    void Reset(const std::shared_ptr<DetectionArena> &arena)
+    {
+        count_ = 0;
+        if (arena == arena_ && items_ != nullptr)
+        {
+            return;
+        }
+        Release();
+        arena_ = arena;
+        items_ = arena_ != nullptr ? arena_->Acquire() : nullptr;
+    }
+
+    int capacity() const { return items_ != nullptr ? arena_->block_size() : 0; }
+    int size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    void clear() { count_ = 0; }
+
+    // 已满（或者还没有存储）时返回 false
+    bool push_back(const Detection &det)
+    {
+        if (count_ >= capacity())
+        {
+            return false;
+        }
+        items_[count_++] = det;
+        return true;
+    }
+
+    Detection &operator[](int i) { return items_[i]; }
+    const Detection &operator[](int i) const { return items_[i]; }
+    Detection *begin() { return items_; }
+    Detection *end() { return items_ + count_; }
+    const Detection *begin() const { return items_; }
+    const Detection *end() const { return items_ + count_; }
+
+private:
+    void Release()
+    {
+        if (items_ != nullptr)
+        {
+            arena_->Release(items_);
+            items_ = nullptr;
+        }
+        arena_.reset();
+        count_ = 0;
+    }
+
+    std::shared_ptr<DetectionArena> arena_; // 列表持有 arena 的引用，块总能归还
+    Detection *items_ = nullptr;
+    int count_ = 0;
+};
+
+// 每个模型一份的类别名称和颜色表
+// 超出名称表的类别编号用编号本身作为名称，在构造时生成，查表时不再拼接字符串
+class ClassTable
+{
+public:
+    ClassTable() = default;
+    ClassTable(const std::vector<std::string> &names, int class_num, const cv::Scalar &color = cv::Scalar(0, 0, 255))
+    {
+        int num = class_num > (int)names.size() ? class_num : (int)names.size();
+        for (int i = 0; i < num; i++)
+        {
+            names_.push_back(i < (int)names.size() ? names[i] : std::to_string(i));
+            colors_.push_back(color);
+        }
+    }
+
+    int size() const { return (int)names_.size(); }
+
+    const std::string &Name(int class_id) const
+    {
+        static const std::string unknown = "unknown";
+        return class_id >= 0 && class_id < size() ? names_[class_id] : unknown;
+    }
+
+    const cv::Scalar &Color(int class_id) const
+    {
+        static const cv::Scalar fallback(0, 0, 255);
+        return class_id >= 0 && class_id < size() ? colors_[class_id] : fallback;
+    }
+
+    void SetColor(int class_id, const cv::Scalar &color)
+    {
+        if (class_id >= 0 && class_id < size())
+        {
+            colors_[class_id] = color;
+        }
+    }
+
+private:
+    std::vector<std::string> names_;
+    std::vector<cv::Scalar> colors_;
+};
+
 #endif //RK3588_DEMO_NN_DATATYPE_H
@@ -0,0 +1,249 @@
+// 有界阻塞队列：一个 mutex 保护的环形缓冲区，满或空时在条件变量上等待
+
+#ifndef RK3588_DEMO_BLOCKING_QUEUE_H
+#define RK3588_DEMO_BLOCKING_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// 队列满时的处理策略
+enum queue_overflow_e
+{
+    QUEUE_OVERFLOW_BLOCK = 0,       // 阻塞等待空位
+    QUEUE_OVERFLOW_DROP_OLDEST = 1, // 挤掉最早入队的元素
+    QUEUE_OVERFLOW_DROP_NEWEST = 2, // 丢弃当前要入队的元素
+};
+
+// 任务队列和流水线各阶段之间使用的队列，接口与 MPMCQueue 相同
+// 每秒几十到几百帧的负载下锁几乎没有竞争，bench_queue 中它不比无锁队列慢，所以热路径上用它
+template <typename T>
+class BlockingQueue
+{
+public:
+    explicit BlockingQueue(size_t capacity) : items_(capacity > 0 ? capacity : 1) {}
+
+    BlockingQueue(const BlockingQueue &) = delete;
+    BlockingQueue &operator=(const BlockingQueue &) = delete;
+
+    // 非阻塞入队，队列满或已退出时返回 false，此时 value 不会被移动
+    bool try_push(T &&value)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (exit_ || count_ == items_.size())
+        {
+            return false;
+        }
+        enqueue(std::move(value), lock);
+        return true;
+    }
+
+    // 非阻塞出队，队列空时返回 false
+    bool try_pop(T &value)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (count_ == 0)
+        {
+            return false;
+        }
+        dequeue(value, lock);
+        return true;
+    }
+
+    // 阻塞入队，队列退出时返回 false
+    bool push(T &&value)
+    {
+        return push_until(std::move(value), nullptr);
+    }
+
+    // 阻塞出队，队列退出且为空时返回 false
+    bool pop(T &value)
+    {
+        return pop_until(value, nullptr);
+    }
+
+    // 限时入队，超时或队列退出时返回 false
+    bool push_for(T &&value, std::chrono::microseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return push_until(std::move(value), &deadline);
+    }
+
+    // 限时出队，超时或队列退出且为空时返回 false
+    bool pop_for(T &value, std::chrono::microseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return pop_until(value, &deadline);
+    }
+
+    // 按溢出策略入队
+    // DROP_OLDEST 时被挤掉的元素交给 on_evict 处理（在锁外调用）；返回 false 表示 value 没有入队（DROP_NEWEST 且队列满，或队列已退出）
+    template <typename F>
+    bool push(T &&value, queue_overflow_e policy, F &&on_evict)
+    {
+        switch (policy)
+        {
+        case QUEUE_OVERFLOW_DROP_NEWEST:
+            return try_push(std::move(value));
+        case QUEUE_OVERFLOW_DROP_OLDEST:
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (exit_)
+            {
+                return false;
+            }
+            if (count_ < items_.size())
+            {
+                enqueue(std::move(value), lock);
+                return true;
+            }
+            // 队列满：取出队首，新元素放到队尾，队列大小不变，不需要唤醒
+            T evicted = std::move(items_[head_]);
+            items_[head_] = std::move(value);
+            head_ = (head_ + 1) % items_.size();
+            lock.unlock();
+            on_evict(evicted);
+            return true;
+        }
+        default:
+            return push(std::move(value));
+        }
+    }
+
+    // 唤醒所有等待者，之后 push 失败，pop 取完剩余元素后失败
+    void exit()
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        exit_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    bool is_exit() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return exit_;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return count_;
+    }
+
+    size_t capacity() const
+    {
+        return items_.size();
+    }
+
+    // 因队列满或空而进入等待的次数，用于观察竞争情况
+    uint64_t get_wait_count() const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return wait_count_;
+    }
+
+private:
+    // 调用时持有锁，只在有等待者时通知；在锁内通知，单核上实测比先解锁再通知的多生产者 / 多消费者吞吐高
+    void enqueue(T &&value, std::unique_lock<std::mutex> &lock)
+    {
+        items_[(head_ + count_) % items_.size()] = std::move(value);
+        count_++;
+        if (pop_waiters_ > 0)
+        {
+            not_empty_.notify_one();
+        }
+        lock.unlock();
+    }
+
+    void dequeue(T &value, std::unique_lock<std::mutex> &lock)
+    {
+        value = std::move(items_[head_]);
+        items_[head_] = T();
+        head_ = (head_ + 1) % items_.size();
+        count_--;
+        if (push_waiters_ > 0)
+        {
+            not_full_.notify_one();
+        }
+        lock.unlock();
+    }
+
+    bool push_until(T &&value, const std::chrono::steady_clock::time_point *deadline)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!exit_ && count_ == items_.size())
+        {
+            wait_count_++;
+            push_waiters_++;
+            bool timeout = false;
+            if (deadline == nullptr)
+            {
+                not_full_.wait(lock);
+            }
+            else
+            {
+                timeout = not_full_.wait_until(lock, *deadline) == std::cv_status::timeout;
+            }
+            push_waiters_--;
+            if (timeout && !exit_ && count_ == items_.size())
+            {
+                return false;
+            }
+        }
+        if (exit_)
+        {
+            return false;
+        }
+        enqueue(std::move(value), lock);
+        return true;
+    }
+
+    bool pop_until(T &value, const std::chrono::steady_clock::time_point *deadline)
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!exit_ && count_ == 0)
+        {
+            wait_count_++;
+            pop_waiters_++;
+            bool timeout = false;
+            if (deadline == nullptr)
+            {
+                not_empty_.wait(lock);
+            }
+            else
+            {
+                timeout = not_empty_.wait_until(lock, *deadline) == std::cv_status::timeout;
+            }
+            pop_waiters_--;
+            if (timeout && count_ == 0)
+            {
+                return false;
+            }
+        }
+        if (count_ == 0)
+        {
+            return false;
+        }
+        dequeue(value, lock);
+        return true;
+    }
+
+    std::vector<T> items_; // 环形缓冲区，[head_, head_ + count_) 为有效元素
+    size_t head_ = 0;
+    size_t count_ = 0;
+    bool exit_ = false;
+    int push_waiters_ = 0;
+    int pop_waiters_ = 0;
+    uint64_t wait_count_ = 0;
+    mutable std::mutex mtx_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif // RK3588_DEMO_BLOCKING_QUEUE_H
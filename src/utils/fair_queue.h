@@ -0,0 +1,166 @@
+// 多路输入的公平队列：每路一个有界队列，消费者按轮询顺序取出
+
+#ifndef RK3588_DEMO_FAIR_QUEUE_H
+#define RK3588_DEMO_FAIR_QUEUE_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "blocking_queue.h"
+
+// 每路（lane）各自有容量和溢出策略，一路输入过快只会挤掉或阻塞自己的元素，不会占满其他路的位置
+// 消费者每次从上一次之后的下一路开始找，所有路都有积压时每路轮流取出一个
+// 每路各自加锁，只有所有路都为空时消费者才在公共的条件变量上等待
+template <typename T>
+class FairQueue
+{
+public:
+    FairQueue(int lane_num, size_t lane_capacity)
+    {
+        for (int i = 0; i < (lane_num > 0 ? lane_num : 1); i++)
+        {
+            lanes_.emplace_back(new BlockingQueue<T>(lane_capacity));
+        }
+    }
+
+    FairQueue(const FairQueue &) = delete;
+    FairQueue &operator=(const FairQueue &) = delete;
+
+    // 按溢出策略写入第 lane 路，语义同 BlockingQueue::push(value, policy, on_evict)
+    template <typename F>
+    bool push(int lane, T &&value, queue_overflow_e policy, F &&on_evict)
+    {
+        if (!lanes_[lane]->push(std::move(value), policy, on_evict))
+        {
+            return false;
+        }
+        wake();
+        return true;
+    }
+
+    // 非阻塞出队，所有路都为空时返回 false
+    bool try_pop(T &value)
+    {
+        size_t n = lanes_.size();
+        size_t start = cursor_.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < n; i++)
+        {
+            if (lanes_[(start + i) % n]->try_pop(value))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 阻塞出队，队列退出且为空时返回 false
+    bool pop(T &value)
+    {
+        return pop_until(value, nullptr);
+    }
+
+    // 限时出队，超时或队列退出且为空时返回 false
+    bool pop_for(T &value, std::chrono::microseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return pop_until(value, &deadline);
+    }
+
+    // 唤醒所有等待者，之后 push 失败，pop 取完剩余元素后失败
+    void exit()
+    {
+        for (auto &lane : lanes_)
+        {
+            lane->exit();
+        }
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        exit_.store(true, std::memory_order_release);
+        not_empty_.notify_all();
+    }
+
+    bool is_exit() const
+    {
+        return exit_.load(std::memory_order_acquire);
+    }
+
+    int lane_num() const
+    {
+        return (int)lanes_.size();
+    }
+
+    // 第 lane 路的近似大小
+    size_t size(int lane) const
+    {
+        return lanes_[lane]->size();
+    }
+
+    // 第 lane 路的容量
+    size_t capacity(int lane) const
+    {
+        return lanes_[lane]->capacity();
+    }
+
+private:
+    void wake()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pop_waiters_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            not_empty_.notify_all();
+        }
+    }
+
+    // “登记 -> 重试 -> 等待”：先登记为等待者再重试一次，push 之后的 wake 不会丢失
+    bool pop_until(T &value, const std::chrono::steady_clock::time_point *deadline)
+    {
+        while (true)
+        {
+            if (try_pop(value))
+            {
+                return true;
+            }
+            if (exit_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            pop_waiters_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool ok = try_pop(value);
+            if (!ok && !exit_.load(std::memory_order_acquire))
+            {
+                if (deadline == nullptr)
+                {
+                    not_empty_.wait(lock);
+                }
+                else if (not_empty_.wait_until(lock, *deadline) == std::cv_status::timeout)
+                {
+                    ok = try_pop(value);
+                    pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    return ok;
+                }
+            }
+            pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            if (ok)
+            {
+                return true;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<BlockingQueue<T>>> lanes_;
+    std::atomic<size_t> cursor_{0};
+    std::atomic<bool> exit_{false};
+    std::atomic<int> pop_waiters_{0};
+    std::mutex wait_mutex_;
+    std::condition_variable not_empty_;
+};
+
+#endif // RK3588_DEMO_FAIR_QUEUE_H
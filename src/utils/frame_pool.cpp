@@ -0,0 +1,184 @@
+#include "frame_pool.h"
+
+#include "utils/logging.h"
+
+// UMatData::allocatorFlags_ 中标记缓冲区来自池
+static const int kPooledBlock = 1;
+
+FramePool::FramePool(int block_num) : block_num_(block_num > 0 ? block_num : 1) {}
+
+FramePool::~FramePool()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (free_list_.size() != blocks_.size())
+    {
+        NN_LOG_ERROR("frame pool destroyed with %ld blocks in use", blocks_.size() - free_list_.size());
+    }
+    for (auto block : blocks_)
+    {
+        cv::fastFree(block);
+    }
+}
+
+void FramePool::SetBlockNum(int block_num)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    block_num_ = block_num > 0 ? block_num : 1;
+}
+
+int FramePool::GetBlockNum() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return block_num_;
+}
+
+// 调用时已持有 mtx_，且所有缓冲区都空闲；缓冲区之后按需分配
+void FramePool::ResizeBlocks(size_t block_size) const
+{
+    for (auto block : blocks_)
+    {
+        cv::fastFree(block);
+    }
+    blocks_.clear();
+    free_list_.clear();
+    block_size_ = block_size;
+    NN_LOG_INFO("frame pool: up to %d blocks of %ld bytes", block_num_, block_size);
+}
+
+// 调用时已持有 mtx_；第 1、2、4、8 ... 次溢出时打印，避免持续溢出时刷屏
+void FramePool::LogOverflow(const char *reason, size_t size) const
+{
+    overflow_count_++;
+    if ((overflow_count_ & (overflow_count_ - 1)) == 0)
+    {
+        NN_LOG_WARNING("frame pool overflow #%lu: %s, %ld bytes from heap (%d/%d blocks in use)", (unsigned long)overflow_count_,
+                       reason, size, (int)(blocks_.size() - free_list_.size()), block_num_);
+    }
+}
+
+// 与 OpenCV 默认 allocator 相同的 step 计算，只是数据缓冲区优先从池中取
+cv::UMatData *FramePool::allocate(int dims, const int *sizes, int type, void *data0, size_t *step,
+                                  cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data0 && step[i] != CV_AUTOSTEP)
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uint8_t *data = (uint8_t *)data0;
+    bool pooled = false;
+    if (data == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (total != block_size_ && free_list_.size() == blocks_.size())
+        {
+            // 第一次分配或分辨率变化
+            ResizeBlocks(total);
+        }
+        if (total == block_size_ && free_list_.empty() && (int)blocks_.size() < block_num_)
+        {
+            uint8_t *block = (uint8_t *)cv::fastMalloc(total);
+            blocks_.push_back(block);
+            free_list_.push_back(block);
+        }
+        if (total == block_size_ && !free_list_.empty())
+        {
+            data = free_list_.back();
+            free_list_.pop_back();
+            pooled = true;
+            alloc_count_++;
+            int in_use = (int)(blocks_.size() - free_list_.size());
+            if (in_use > high_water_)
+            {
+                high_water_ = in_use;
+            }
+        }
+        else
+        {
+            LogOverflow(total != block_size_ ? "size mismatch while blocks are in use" : "all blocks in use", total);
+        }
+    }
+    if (data == nullptr)
+    {
+        data = (uint8_t *)cv::fastMalloc(total);
+    }
+
+    cv::UMatData *u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0)
+    {
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    }
+    if (pooled)
+    {
+        u->allocatorFlags_ |= kPooledBlock;
+    }
+    return u;
+}
+
+bool FramePool::allocate(cv::UMatData *u, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const
+{
+    return u != nullptr;
+}
+
+void FramePool::deallocate(cv::UMatData *u) const
+{
+    if (u == nullptr)
+    {
+        return;
+    }
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        if (u->allocatorFlags_ & kPooledBlock)
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            free_list_.push_back(u->origdata);
+        }
+        else
+        {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+int FramePool::GetInUse() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return (int)(blocks_.size() - free_list_.size());
+}
+
+int FramePool::GetHighWater() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return high_water_;
+}
+
+uint64_t FramePool::GetAllocCount() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return alloc_count_;
+}
+
+uint64_t FramePool::GetOverflowCount() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return overflow_count_;
+}
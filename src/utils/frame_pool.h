@@ -0,0 +1,56 @@
+// 帧内存池
+
+#ifndef RK3588_DEMO_FRAME_POOL_H
+#define RK3588_DEMO_FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// 最多 block_num 个、固定大小的帧缓冲区，作为 cv::Mat 的 allocator 使用
+// Mat 本身带引用计数，帧在解码 -> 推理 -> 绘制 -> 编码之间传递时只复制 Mat 头，最后一个引用释放时缓冲区回到池中
+// 缓冲区按需分配，之后不再释放，内存占用等于同时使用数量的峰值；block_num 应按各级队列的容量设置，只是上限
+// 缓冲区大小由第一次分配决定；分辨率变化且所有缓冲区都空闲时按新大小重新分配
+// 池用完或大小不符时退回普通堆分配，计数并打印警告，不会让调用者失败
+// 池必须比所有从它分配的 Mat 活得久
+class FramePool : public cv::MatAllocator
+{
+public:
+    explicit FramePool(int block_num);
+    ~FramePool();
+
+    // 让 mat 之后的 create 从池中分配
+    void Bind(cv::Mat &mat) { mat.allocator = this; }
+
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData *data, cv::AccessFlag accessflags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData *data) const override;
+
+    // 调整缓冲区数量上限，已分配的缓冲区不受影响
+    void SetBlockNum(int block_num);
+    int GetBlockNum() const;
+    int GetInUse() const;              // 正在使用的池内缓冲区数量
+    int GetHighWater() const;          // 池内缓冲区同时使用数量的最大值
+    uint64_t GetAllocCount() const;    // 从池中分配的次数
+    uint64_t GetOverflowCount() const; // 退回堆分配的次数
+
+private:
+    void ResizeBlocks(size_t block_size) const;
+    void LogOverflow(const char *reason, size_t size) const;
+
+    int block_num_;
+    mutable std::mutex mtx_;
+    mutable size_t block_size_ = 0;
+    mutable std::vector<uint8_t *> blocks_;     // 全部缓冲区
+    mutable std::vector<uint8_t *> free_list_;  // 空闲缓冲区
+    mutable int high_water_ = 0;
+    mutable uint64_t alloc_count_ = 0;
+    mutable uint64_t overflow_count_ = 0;
+};
+
+#endif // RK3588_DEMO_FRAME_POOL_H
@@ -0,0 +1,355 @@
+// 有界无锁多生产者多消费者队列（Vyukov bounded MPMC）
+
+#ifndef RK3588_DEMO_MPMC_QUEUE_H
+#define RK3588_DEMO_MPMC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "blocking_queue.h"
+
+// try_push / try_pop 是无锁的，每个槽位用一个序号区分“可写”和“可读”
+// 阻塞版本只在队列满或空时才进入 mutex + condition_variable 等待，快速路径不加锁
+// 接口与 BlockingQueue 相同；在单核上实测没有优势，目前只在 bench_queue 中对比，多核上测出收益之前不替换热路径上的 BlockingQueue
+template <typename T>
+class MPMCQueue
+{
+public:
+    // 容量向上取整为 2 的幂
+    explicit MPMCQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = std::vector<Cell>(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue &) = delete;
+    MPMCQueue &operator=(const MPMCQueue &) = delete;
+
+    // 非阻塞入队，队列满时返回 false，此时 value 不会被移动
+    bool try_push(T &&value)
+    {
+        if (!enqueue(std::move(value)))
+        {
+            return false;
+        }
+        wake(pop_waiters_, not_empty_);
+        return true;
+    }
+
+    // 非阻塞出队，队列空时返回 false
+    bool try_pop(T &value)
+    {
+        if (!dequeue(value))
+        {
+            return false;
+        }
+        wake(push_waiters_, not_full_);
+        return true;
+    }
+
+    // 阻塞入队，队列退出时返回 false
+    bool push(T &&value)
+    {
+        return push_until(std::move(value), nullptr);
+    }
+
+    // 阻塞出队，队列退出且为空时返回 false
+    bool pop(T &value)
+    {
+        return pop_until(value, nullptr);
+    }
+
+    // 限时入队，超时或队列退出时返回 false
+    bool push_for(T &&value, std::chrono::microseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return push_until(std::move(value), &deadline);
+    }
+
+    // 限时出队，超时或队列退出且为空时返回 false
+    bool pop_for(T &value, std::chrono::microseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return pop_until(value, &deadline);
+    }
+
+    // 按溢出策略入队
+    // DROP_OLDEST 时被挤掉的元素交给 on_evict 处理；返回 false 表示 value 没有入队（DROP_NEWEST 且队列满，或队列已退出）
+    template <typename F>
+    bool push(T &&value, queue_overflow_e policy, F &&on_evict)
+    {
+        switch (policy)
+        {
+        case QUEUE_OVERFLOW_DROP_NEWEST:
+            return !exit_.load(std::memory_order_acquire) && try_push(std::move(value));
+        case QUEUE_OVERFLOW_DROP_OLDEST:
+            while (!exit_.load(std::memory_order_acquire))
+            {
+                if (try_push(std::move(value)))
+                {
+                    return true;
+                }
+                T evicted;
+                if (dequeue(evicted))
+                {
+                    on_evict(evicted);
+                }
+            }
+            return false;
+        default:
+            return push(std::move(value));
+        }
+    }
+
+    // 唤醒所有等待者，之后 push 失败，pop 取完剩余元素后失败
+    void exit()
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        exit_.store(true, std::memory_order_release);
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    bool is_exit() const
+    {
+        return exit_.load(std::memory_order_acquire);
+    }
+
+    // 近似大小，并发修改时只作参考
+    size_t size() const
+    {
+        size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+    // 因队列满或空而进入等待的次数，用于观察竞争情况
+    uint64_t get_wait_count() const
+    {
+        return wait_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const size_t kCacheLine = 64;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+
+        Cell() : sequence(0) {}
+        Cell(Cell &&other) : sequence(other.sequence.load(std::memory_order_relaxed)), data(std::move(other.data)) {}
+        Cell &operator=(Cell &&other)
+        {
+            sequence.store(other.sequence.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            data = std::move(other.data);
+            return *this;
+        }
+    };
+
+    bool enqueue(T &&value)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // 队列满
+                return false;
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool dequeue(T &value)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // 队列空
+                return false;
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 有等待者时才加锁通知。与等待方的 “登记 -> 重试” 配合，fence 保证不会丢失唤醒
+    void wake(std::atomic<int> &waiters, std::condition_variable &cv)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            cv.notify_all();
+        }
+    }
+
+    bool push_until(T &&value, const std::chrono::steady_clock::time_point *deadline)
+    {
+        while (true)
+        {
+            if (exit_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            if (try_push(std::move(value)))
+            {
+                return true;
+            }
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            push_waiters_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool ok = enqueue(std::move(value));
+            if (!ok && !exit_.load(std::memory_order_acquire))
+            {
+                wait_count_.fetch_add(1, std::memory_order_relaxed);
+                if (deadline == nullptr)
+                {
+                    not_full_.wait(lock);
+                }
+                else if (not_full_.wait_until(lock, *deadline) == std::cv_status::timeout)
+                {
+                    ok = enqueue(std::move(value));
+                    push_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    lock.unlock();
+                    if (ok)
+                    {
+                        wake(pop_waiters_, not_empty_);
+                    }
+                    return ok;
+                }
+            }
+            push_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+            if (ok)
+            {
+                wake(pop_waiters_, not_empty_);
+                return true;
+            }
+        }
+    }
+
+    bool pop_until(T &value, const std::chrono::steady_clock::time_point *deadline)
+    {
+        while (true)
+        {
+            if (try_pop(value))
+            {
+                return true;
+            }
+            if (exit_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            pop_waiters_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool ok = dequeue(value);
+            if (!ok && !exit_.load(std::memory_order_acquire))
+            {
+                wait_count_.fetch_add(1, std::memory_order_relaxed);
+                if (deadline == nullptr)
+                {
+                    not_empty_.wait(lock);
+                }
+                else if (not_empty_.wait_until(lock, *deadline) == std::cv_status::timeout)
+                {
+                    ok = dequeue(value);
+                    pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    lock.unlock();
+                    if (ok)
+                    {
+                        wake(push_waiters_, not_full_);
+                    }
+                    return ok;
+                }
+            }
+            pop_waiters_.fetch_sub(1, std::memory_order_relaxed);
+            lock.unlock();
+            if (ok)
+            {
+                wake(push_waiters_, not_full_);
+                return true;
+            }
+        }
+    }
+
+    std::vector<Cell> cells_;
+    size_t mask_ = 0;
+    // 入队和出队位置之间用填充隔开至少一个缓存行，避免生产者和消费者互相干扰
+    // 不用 alignas(64)：C++14 的 new 不保证超过 16 字节的对齐，对象在堆上时对齐不生效
+    char pad0_[kCacheLine];
+    std::atomic<size_t> enqueue_pos_;
+    char pad1_[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_;
+    char pad2_[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<bool> exit_{false};
+    std::atomic<int> push_waiters_{0};
+    std::atomic<int> pop_waiters_{0};
+    std::atomic<uint64_t> wait_count_{0};
+    std::mutex wait_mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif // RK3588_DEMO_MPMC_QUEUE_H
@@ -252,13 +252,18 @@ namespace rk_helper
             cond_.notify_one();
         }
 
+        // 队列为空时等待；exit() 之后不再等待，队列为空时返回 T()
         T pop()
         {
             std::unique_lock<std::mutex> lock(mutex_);
-            while (queue_.empty())
+            while (queue_.empty() && !exit_)
             {
                 cond_.wait(lock);
             }
+            if (queue_.empty())
+            {
+                return T();
+            }
             T value = queue_.front();
             queue_.pop();
             return value;
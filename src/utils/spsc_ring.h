@@ -0,0 +1,154 @@
+// 单生产者单消费者字节环形缓冲区
+
+#ifndef RK3588_DEMO_SPSC_RING_H
+#define RK3588_DEMO_SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// 一个线程 write，一个线程 read，读写位置各自只被一个线程修改，批量 memcpy，不加锁
+// 读端在缓冲区空时可以阻塞等待；写端从不阻塞，空间不足时丢弃放不下的部分并计数（接收线程不能被解码拖住）
+class SPSCByteRing
+{
+public:
+    // 容量向上取整为 2 的幂
+    explicit SPSCByteRing(size_t capacity = 4 * 1024 * 1024)
+    {
+        size_t size = 64;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        buffer_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SPSCByteRing(const SPSCByteRing &) = delete;
+    SPSCByteRing &operator=(const SPSCByteRing &) = delete;
+
+    // 写入数据，返回实际写入的字节数
+    size_t write(const uint8_t *data, size_t len)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t space = buffer_.size() - (tail - head);
+        size_t n = std::min(len, space);
+        if (n < len)
+        {
+            dropped_bytes_.fetch_add(len - n, std::memory_order_relaxed);
+        }
+        if (n == 0)
+        {
+            return 0;
+        }
+        size_t pos = tail & mask_;
+        size_t first = std::min(n, buffer_.size() - pos);
+        memcpy(buffer_.data() + pos, data, first);
+        memcpy(buffer_.data(), data + first, n - first);
+        tail_.store(tail + n, std::memory_order_release);
+
+        // 读端在等待时才加锁唤醒，fence 与读端的 “登记 -> 重新检查” 配合，保证不会丢失唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (reader_waiting_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cond_.notify_one();
+        }
+        return n;
+    }
+
+    // 非阻塞读取，最多 len 字节，返回实际读到的字节数
+    size_t read(uint8_t *data, size_t len)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        size_t n = std::min(len, tail - head);
+        if (n == 0)
+        {
+            return 0;
+        }
+        size_t pos = head & mask_;
+        size_t first = std::min(n, buffer_.size() - pos);
+        memcpy(data, buffer_.data() + pos, first);
+        memcpy(data + first, buffer_.data(), n - first);
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // 阻塞读取，至少读到 1 字节才返回；退出且已读空时返回 0
+    size_t read_wait(uint8_t *data, size_t len)
+    {
+        while (true)
+        {
+            size_t n = read(data, len);
+            if (n > 0 || exit_.load(std::memory_order_acquire))
+            {
+                return n;
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            reader_waiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (empty() && !exit_.load(std::memory_order_acquire))
+            {
+                cond_.wait(lock);
+            }
+            reader_waiting_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // 唤醒读端，之后 read_wait 读完剩余数据后返回 0
+    void exit()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_.store(true, std::memory_order_release);
+        cond_.notify_all();
+    }
+
+    bool is_exit() const
+    {
+        return exit_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return buffer_.size();
+    }
+
+    // 缓冲区满被丢弃的字节数
+    uint64_t get_dropped_bytes() const
+    {
+        return dropped_bytes_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<uint8_t> buffer_;
+    size_t mask_ = 0;
+    // 读写位置单调递增，取模得到下标；分开放在不同的缓存行
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<bool> reader_waiting_{false};
+    std::atomic<bool> exit_{false};
+    std::atomic<uint64_t> dropped_bytes_{0};
+    std::mutex mutex_;
+    std::condition_variable cond_;
+};
+
+#endif // RK3588_DEMO_SPSC_RING_H
@@ -12,11 +12,14 @@ extern "C"
 
 #include <opencv2/imgcodecs.hpp>
 #include "utils/rk_helper.cpp"
+#include "utils/spsc_ring.h"
 #include "MPPDecoder.h"
 #include "types/video_infos_type.h"
 typedef void (*CallbackFunction)(unsigned char *data, int size, int w, int h, AVPixelFormat format, void *handler);
 typedef void (*CallbackFunctionAVFrame)(AVFrame *frame, void *handler);
 typedef void (*CallbackFunctionMat)(cv::Mat mat, video_decoder_info, void *handler);
+// frame 只在回调期间有效，需要保留时由调用者拷贝
+typedef void (*CallbackFunctionNV12)(const nv12_frame_view &frame, video_decoder_info, void *handler);
 typedef void (*StringCallback)(const char *);
 
 using namespace rk_helper;
@@ -33,9 +36,9 @@ namespace FCourier
 
     private:
         /// <summary>
-        /// 原始数据队列,用于存放原始的数据
+        /// 原始数据环形缓冲区,用于存放原始的数据（接收线程写，AVIO 读）
         /// </summary>
-        SafeQueue<uint8_t> _raw_queue;
+        SPSCByteRing _raw_ring;
         SafeQueue<AVPacket *> _avpacke_queue;
         const AVCodec *_codec = nullptr;
         AVCodecContext *_ctx = nullptr;
@@ -50,6 +53,8 @@ namespace FCourier
         CallbackFunction _raw_cb = nullptr;
         CallbackFunctionAVFrame _avframe_cb = nullptr;
         CallbackFunctionMat _mat_cb = nullptr;
+        CallbackFunctionNV12 _nv12_cb = nullptr;
+        cv::MatAllocator *_frame_allocator = nullptr;
         SwsContext *_swsContext = nullptr;
         AVFrame *_target_frame = nullptr;
         FPSCalculator _fps_calculator;
@@ -131,6 +136,22 @@ namespace FCourier
             _mat_cb = cb;
         }
 
+        /// <summary>
+        /// 设置 NV12 回调，设置后直接输出解码器的 NV12 平面，不再做 BGR 转换和 Mat 回调
+        /// </summary>
+        void set_nv12_callback(CallbackFunctionNV12 cb)
+        {
+            _nv12_cb = cb;
+        }
+
+        /// <summary>
+        /// 设置 Mat 回调输出帧使用的内存池，为空时使用默认分配
+        /// </summary>
+        void set_frame_allocator(cv::MatAllocator *allocator)
+        {
+            _frame_allocator = allocator;
+        }
+
         void set_object_instance(void *handler)
         {
             _object_instance = handler;
@@ -144,8 +165,8 @@ namespace FCourier
 
         void set_raw_data(uint8_t *inputbuf, size_t size)
         {
-            // 将数据放入队列
-            _raw_queue.push(inputbuf, size);
+            // 将数据批量写入环形缓冲区
+            _raw_ring.write(inputbuf, size);
         }
 
         void start()
@@ -184,7 +205,7 @@ namespace FCourier
         void stop()
         {
             _is_start = false;
-            _raw_queue.exit();
+            _raw_ring.exit();
             _avpacke_queue.exit();
         }
 
@@ -203,35 +224,26 @@ namespace FCourier
             if (is_use_rtps_)
             {
                 AVInputFormat *informat = NULL;
-                av_dict_set(&avfmtOps, "rtsp_transport", rtsp_type_.c_str(), 0);
+                // 传输方式为空时按普通 url 打开（例如本地文件）
+                if (!rtsp_type_.empty())
+                {
+                    av_dict_set(&avfmtOps, "rtsp_transport", rtsp_type_.c_str(), 0);
+                }
                 ret = avformat_open_input(&tmp_ctx, rtsp_url_.c_str(), informat, &avfmtOps);
             }
             else
             {
-                int IOBufferSize = 1 * 1024;
+                int IOBufferSize = 32 * 1024;
                 uint8_t *IOBuffer = (uint8_t *)av_malloc(IOBufferSize + AV_INPUT_BUFFER_PADDING_SIZE);
-                avio = avio_alloc_context(IOBuffer, IOBufferSize, 0, &_raw_queue, [](void *opaque, uint8_t *buf, int buf_size)
+                avio = avio_alloc_context(IOBuffer, IOBufferSize, 0, &_raw_ring, [](void *opaque, uint8_t *buf, int buf_size)
                                           {
-                    SafeQueue<uint8_t>* queue = (SafeQueue<uint8_t>*)opaque;
-                    if (queue->is_exit()) {
+                    SPSCByteRing* ring = (SPSCByteRing*)opaque;
+                    // 有数据就立即返回，没有数据时阻塞等待
+                    size_t size = ring->read_wait(buf, buf_size);
+                    if (size == 0) {
                         return AVERROR_EOF;
                     }
-                    // 从队列中取出数据
-                    while (queue->empty()) {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                        if (queue->is_exit()) {
-                            return AVERROR_EOF;
-                        }
-                    }
-                    int size = queue->size();
-                    if (size > buf_size) {
-                        size = buf_size;
-                    }
-
-                    for (int i = 0; i < size; i++) {
-                        buf[i] = queue->pop();
-                    }
-                    return size; }, NULL, NULL);
+                    return (int)size; }, NULL, NULL);
 
                 tmp_ctx->pb = avio;
                 tmp_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
@@ -449,32 +461,13 @@ namespace FCourier
             // 创建 OpenCV Mat 对象用于 NV12 数据
             cv::Mat nv12(height + height / 2, width, CV_8UC1, nv12_buf);
 
-            // 计算 BGR888 数据的大小
-            auto size = width * height * 3; // For BGR888
-
-            if (size != yuv_size)
-            {
-                yuv_size = size;
-
-                if (yuv_buf == nullptr)
-                {
-                    std::cerr << "初始化 YUV 缓冲区!\n";
-                    yuv_buf = new uint8_t[yuv_size];
-                }
-                else
-                {
-                    std::cerr << "重新初始化 YUV 缓冲区!\n";
-                    delete[] yuv_buf;
-                    yuv_buf = new uint8_t[yuv_size];
-                }
-            }
-
-            // 使用 OpenCV 进行 NV12 到 BGR888 的颜色转换
+            // 使用 OpenCV 进行 NV12 到 BGR888 的颜色转换，直接写入输出 Mat，不再额外 clone
+            // 设置了帧内存池时，输出缓冲区从池中分配
             try
             {
-                cv::Mat bgr(height, width, CV_8UC3, yuv_buf);
-                cv::cvtColor(nv12, bgr, cv::COLOR_YUV2BGR_NV12);
-                mat = bgr.clone();
+                mat.release();
+                mat.allocator = _frame_allocator;
+                cv::cvtColor(nv12, mat, cv::COLOR_YUV2BGR_NV12);
 
                 if (!mat.empty())
                 {
@@ -644,7 +637,24 @@ namespace FCourier
                         // save_frame_as_png(_frame);
                         _fps_calculator.CountAFrame();
 
-                        if (_mat_cb)
+                        if (_nv12_cb)
+                        {
+                            nv12_frame_view frame;
+                            frame.y = _frame->data[0];
+                            frame.uv = _frame->data[1];
+                            frame.y_stride = _frame->linesize[0];
+                            frame.uv_stride = _frame->linesize[1];
+                            frame.width = _frame->width;
+                            frame.height = _frame->height;
+
+                            video_decoder_info info;
+                            info.decoder_delay = decoding_delay;
+                            info.fps = _fps_calculator.getFramePerSecond();
+                            info.width = _frame->width;
+                            info.height = _frame->height;
+                            _nv12_cb(frame, info, _object_instance);
+                        }
+                        else if (_mat_cb)
                         {
                             // 创建一个 Mat 并自动获取分辨率
                             cv::Mat yuvImg;
@@ -2,6 +2,7 @@
 #define RKMPP_ENCODER_H
 
 #include <iostream>
+#include <atomic>
 #include <functional>
 #include <vector>
 #include <fstream>
@@ -41,6 +42,8 @@ class RKMPPEncoder
 {
 private:
     std::function<void(uint8_t *data, int size)> on_encoder_ok = nullptr;
+    std::function<void(uint8_t *data, int size, int64_t pts_90k)> on_encoder_packet = nullptr;
+    int64_t m_frame_index = 0; // 送入编码器的帧数，作为帧的 pts
     AVCodecContext *m_pCodecCtx = nullptr; // 编码器上下文
     const AVCodec *m_pCodec = nullptr;     // 编码器
     AVPacket *m_packet = nullptr;          // Packet
@@ -52,7 +55,7 @@ private:
     int m_in_w;
     int m_in_h;
     int64_t bit_rate;
-    bool is_start = false;
+    std::atomic<bool> is_start{false};
 
     SafeQueue<cv::Mat> *m_mat_queue = nullptr;
 
@@ -64,30 +67,37 @@ private:
     void matToNV12UsingRGA(const cv::Mat &mat, AVFrame *frame);
 
 public:
+    static const int kQueueCapacity = 128; // 待编码帧队列的容量，满时丢弃最早的帧
+
     RKMPPEncoder(int w = 1920, int h = 1080, double rate = 1.0, AVPixelFormat format = AV_PIX_FMT_BGR24);
     ~RKMPPEncoder();
 
     bool init();
     void add_data(const cv::Mat &data);
+    // 编码循环，在调用者的线程上运行到 stop()
     void encoder();
+    // 唤醒并结束编码循环，不释放编码器，可以在其他线程上调用
+    void stop();
     void release();
     void set_on_encoder_ok_cb(std::function<void(uint8_t *data, int size)> cb);
+    // 与 set_on_encoder_ok_cb 相同，另外带上 90 kHz 的 pts（RTP 时间戳）
+    void set_on_encoder_packet_cb(std::function<void(uint8_t *data, int size, int64_t pts_90k)> cb);
 };
 
 // 构造函数
-RKMPPEncoder::RKMPPEncoder(int w, int h, double rate, AVPixelFormat format)
+inline RKMPPEncoder::RKMPPEncoder(int w, int h, double rate, AVPixelFormat format)
     : m_src_format(format), m_in_w(w), m_in_h(h), bit_rate(static_cast<int64_t>(rate * 1000000.0))
 {
     printf("bit_rate: %ld\n", bit_rate);
 }
 
 // 析构函数
-RKMPPEncoder::~RKMPPEncoder()
+inline RKMPPEncoder::~RKMPPEncoder()
 {
     cleanup();
 }
 
-void RKMPPEncoder::cleanup()
+inline void RKMPPEncoder::cleanup()
 {
     if (m_pFrame)
     {
@@ -116,7 +126,7 @@ void RKMPPEncoder::cleanup()
     }
 }
 
-bool RKMPPEncoder::initializeEncoder()
+inline bool RKMPPEncoder::initializeEncoder()
 {
     av_log_set_level(AV_LOG_INFO);
 
@@ -215,10 +225,11 @@ bool RKMPPEncoder::initializeEncoder()
     return true;
 }
 
-bool RKMPPEncoder::init()
+inline bool RKMPPEncoder::init()
 {
     m_mat_queue = new SafeQueue<cv::Mat>();
-    m_mat_queue->set_max_capacity(128);
+    m_mat_queue->set_max_capacity(kQueueCapacity);
+    is_start = true;
 
     if (!initializeEncoder())
     {
@@ -232,12 +243,12 @@ bool RKMPPEncoder::init()
     }
 }
 
-void RKMPPEncoder::add_data(const cv::Mat &data)
+inline void RKMPPEncoder::add_data(const cv::Mat &data)
 {
     m_mat_queue->push(data);
 }
 
-void RKMPPEncoder::matToAvFrame(const cv::Mat &mat, AVFrame *frame)
+inline void RKMPPEncoder::matToAvFrame(const cv::Mat &mat, AVFrame *frame)
 {
     if (frame->width != mat.cols || frame->height != mat.rows || frame->format != m_src_format)
     {
@@ -256,7 +267,7 @@ void RKMPPEncoder::matToAvFrame(const cv::Mat &mat, AVFrame *frame)
     }
 }
 
-AVFrame *RKMPPEncoder::convertToNV12(AVFrame *srcFrame)
+inline AVFrame *RKMPPEncoder::convertToNV12(AVFrame *srcFrame)
 {
     if (!srcFrame || !m_pFrameNV12)
     {
@@ -281,13 +292,17 @@ AVFrame *RKMPPEncoder::convertToNV12(AVFrame *srcFrame)
     return m_pFrameNV12;
 }
 
-void RKMPPEncoder::encoder()
+inline void RKMPPEncoder::encoder()
 {
-    is_start = true;
     printf("开始编码循环\n");
     while (is_start)
     {
         cv::Mat mat = m_mat_queue->pop();
+        if (mat.empty())
+        {
+            // stop() 退出了队列
+            break;
+        }
 
         // 转换 cv::Mat 到 AVFrame (BGR24)
         matToNV12UsingRGA(mat, m_pFrameNV12);
@@ -299,7 +314,8 @@ void RKMPPEncoder::encoder()
         //     continue;
         // }
 
-        // 发送帧到编码器
+        // 发送帧到编码器，pts 按 time_base 逐帧递增
+        m_pFrameNV12->pts = m_frame_index++;
         int ret = avcodec_send_frame(m_pCodecCtx, m_pFrameNV12);
         if (ret < 0)
         {
@@ -333,6 +349,19 @@ void RKMPPEncoder::encoder()
                     fprintf(stderr, "回调函数异常: %s\n", e.what());
                 }
             }
+            if (on_encoder_packet)
+            {
+                int64_t pts = m_packet->pts != AV_NOPTS_VALUE ? m_packet->pts : m_frame_index - 1;
+                try
+                {
+                    on_encoder_packet(m_packet->data, m_packet->size,
+                                      av_rescale_q(pts, m_pCodecCtx->time_base, AVRational{1, 90000}));
+                }
+                catch (const std::exception &e)
+                {
+                    fprintf(stderr, "回调函数异常: %s\n", e.what());
+                }
+            }
 
             av_packet_unref(m_packet);
         }
@@ -340,18 +369,32 @@ void RKMPPEncoder::encoder()
     printf("编码循环结束\n");
 }
 
-void RKMPPEncoder::release()
+inline void RKMPPEncoder::stop()
+{
+    is_start = false;
+    if (m_mat_queue)
+    {
+        m_mat_queue->exit();
+    }
+}
+
+inline void RKMPPEncoder::release()
 {
     is_start = false;
     cleanup();
 }
 
-void RKMPPEncoder::set_on_encoder_ok_cb(std::function<void(uint8_t *data, int size)> cb)
+inline void RKMPPEncoder::set_on_encoder_ok_cb(std::function<void(uint8_t *data, int size)> cb)
 {
     on_encoder_ok = cb;
 }
 
-void RKMPPEncoder::matToNV12UsingRGA(const cv::Mat &mat, AVFrame *frame)
+inline void RKMPPEncoder::set_on_encoder_packet_cb(std::function<void(uint8_t *data, int size, int64_t pts_90k)> cb)
+{
+    on_encoder_packet = cb;
+}
+
+inline void RKMPPEncoder::matToNV12UsingRGA(const cv::Mat &mat, AVFrame *frame)
 {
     if (mat.empty() || !frame)
     {
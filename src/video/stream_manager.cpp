@@ -0,0 +1,328 @@
+#include "stream_manager.h"
+
+#include <random>
+
+#include "process/preprocess.h"
+#include "utils/logging.h"
+
+void VideoStream::OnPacket(const uint8_t *data, size_t len)
+{
+    if (rtp_in)
+    {
+        rtp_in->Input(data, len);
+    }
+    else
+    {
+        decoder.set_raw_data(const_cast<uint8_t *>(data), len);
+    }
+}
+
+StreamManager::~StreamManager()
+{
+    Stop();
+}
+
+int StreamManager::AddStream(const StreamConfig &config)
+{
+    int id = (int)streams_.size();
+    streams_.emplace_back(new VideoStream(id, config));
+    return id;
+}
+
+bool StreamManager::Start(ThreadPool *pool, ResultHandler on_result)
+{
+    pool_ = pool;
+    on_result_ = on_result;
+    for (auto &stream : streams_)
+    {
+        if (!StartStream(*stream))
+        {
+            NN_LOG_ERROR("stream %d (%s %s) start failed", stream->id, stream->config.Type.c_str(),
+                         stream->config.Url.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+void StreamManager::Stop()
+{
+    // 先停止输入：udp 接收线程结束后不再写入解码器
+    for (auto &stream : streams_)
+    {
+        if (stream->receiver)
+        {
+            stream->receiver->stopReceiving();
+        }
+        stream->decoder.stop();
+    }
+    if (pool_ != nullptr)
+    {
+        pool_->stopAll();
+    }
+    for (auto &stream : streams_)
+    {
+        for (std::thread *t : {&stream->result_thread, &stream->encode_thread, &stream->publish_thread})
+        {
+            if (t->joinable())
+            {
+                t->join();
+            }
+        }
+    }
+}
+
+void StreamManager::LogStats()
+{
+    for (auto &stream : streams_)
+    {
+        stream->encode_bytes.Update();
+        NN_LOG_INFO("视频流 %d: 解码器FPS: %d, 推理及编码速率: %lf kB/s, 已交付 %lu 帧", stream->id,
+                    stream->decoder.get_fps(), stream->encode_bytes.getFramePerSecond() / 1024.0,
+                    (unsigned long)stream->result_count);
+        AdmissionStats stats;
+        if (pool_ != nullptr && pool_->getAdmissionStats(stream->id, stats))
+        {
+            NN_LOG_INFO("视频流 %d: 推理间隔 %d, 推理FPS %.1f, 延迟 p50 %.1f ms p99 %.1f ms, 推理 %lu 跳过 %lu, 调整 +%lu/-%lu",
+                        stream->id, stats.stride, stats.infer_fps, stats.p50_ms, stats.p99_ms,
+                        (unsigned long)stats.admitted, (unsigned long)stats.skipped, (unsigned long)stats.raised,
+                        (unsigned long)stats.lowered);
+        }
+        if (stream->receiver)
+        {
+            const UdpRecvStats &recv = stream->receiver->getRecvStats();
+            uint64_t calls = recv.syscalls.load();
+            NN_LOG_INFO("视频流 %d: 接收系统调用 %lu, 数据包 %lu, 平均每次 %.1f 个包, 内核丢包 %lu, 截断 %lu", stream->id,
+                        (unsigned long)calls, (unsigned long)recv.datagrams.load(),
+                        calls ? (double)recv.datagrams.load() / calls : 0.0, (unsigned long)recv.kernel_drops.load(),
+                        (unsigned long)recv.truncated.load());
+        }
+        if (stream->rtp_in)
+        {
+            const RtpDepacketizerStats &rtp = stream->rtp_in->GetStats();
+            NN_LOG_INFO("视频流 %d: RTP 包 %lu, 丢包 %lu, 乱序 %lu, 完整帧 %lu, 丢弃帧 %lu, 错误包 %lu, 重新同步 %lu",
+                        stream->id, (unsigned long)rtp.packets.load(), (unsigned long)rtp.lost_packets.load(),
+                        (unsigned long)rtp.late_packets.load(), (unsigned long)rtp.frames.load(),
+                        (unsigned long)rtp.dropped_frames.load(), (unsigned long)rtp.bad_packets.load(),
+                        (unsigned long)rtp.resyncs.load());
+        }
+        if (stream->fec_in)
+        {
+            const UdpFecStats &fec = stream->fec_in->GetStats();
+            NN_LOG_INFO("视频流 %d: FEC 数据包 %lu, 校验包 %lu, 恢复 %lu, 未恢复 %lu, 晚到 %lu, 错误包 %lu, 重新同步 %lu",
+                        stream->id, (unsigned long)fec.data.load(), (unsigned long)fec.parity.load(),
+                        (unsigned long)fec.recovered.load(), (unsigned long)fec.unrecovered.load(),
+                        (unsigned long)fec.late.load(), (unsigned long)fec.bad.load(), (unsigned long)fec.resyncs.load());
+        }
+        if (stream->sender)
+        {
+            const UdpSendStats &send = stream->sender->get_stats();
+            uint64_t batches = send.batches.load();
+            NN_LOG_INFO("视频流 %d: 发送方式 %d, 系统调用 %lu, 数据包 %lu, 平均每帧 %.2f 次调用 %.1f 个包, 失败 %lu",
+                        stream->id, (int)stream->sender->get_send_mode(), (unsigned long)send.syscalls.load(),
+                        (unsigned long)send.datagrams.load(), batches ? (double)send.syscalls.load() / batches : 0.0,
+                        batches ? (double)send.datagrams.load() / batches : 0.0, (unsigned long)send.errors.load());
+        }
+    }
+}
+
+bool StreamManager::StartStream(VideoStream &stream)
+{
+    const StreamConfig &config = stream.config;
+    // 加 FEC 时分包变小，留出 FEC 头，数据包和校验包都不超过 kPacketSize
+    bool fec = config.FecRows > 0 && config.FecCols > 0;
+    size_t payload_size = fec ? kPacketSize - kFecHeaderSize : kPacketSize;
+    stream.packets.reset(new PacketManager(1024 * 1024, payload_size, fec ? kFecHeaderSize : 0));
+    if (!config.SendIP.empty())
+    {
+        stream.sender.reset(new UDPSender(config.SendIP, config.SendPort));
+        udp_send_mode_e mode = config.SendMode == "single" ? UDP_SEND_SINGLE
+                               : config.SendMode == "mmsg" ? UDP_SEND_MMSG
+                                                           : UDP_SEND_GSO;
+        stream.sender->set_send_mode(mode, kPacketSize);
+        if (fec)
+        {
+            stream.fec_out.reset(new UdpFecEncoder(config.FecRows, config.FecCols, payload_size));
+        }
+    }
+    stream.encoder.reset(new RKMPPEncoder(config.Width, config.Height, 4));
+    if (!stream.encoder->init())
+    {
+        NN_LOG_ERROR("编码器初始化失败！");
+        return false;
+    }
+    VideoStream *ctx = &stream;
+    if (config.SendFormat == "rtp")
+    {
+        stream.rtp_out.reset(new RtpH264Packetizer(payload_size, std::random_device()()));
+    }
+    stream.encoder->set_on_encoder_packet_cb([ctx](uint8_t *data, int size, int64_t pts)
+                                             {
+        ctx->encode_bytes.CountFrames(size);
+        if (!ctx->rtp_out)
+        {
+            ctx->packets->SplitIntoPackets(reinterpret_cast<const char *>(data), size);
+            return;
+        }
+        // RTP 包头和负载一起拷贝进发送缓冲区
+        ctx->rtp_out->Packetize(data, size, (uint32_t)pts, [ctx](const uint8_t *head, size_t head_len, const uint8_t *payload, size_t len, bool last)
+                                { ctx->packets->AddPacket(head, head_len, payload, len, last); }); });
+
+    // 解码器回调是函数指针，通过 object_instance 找到所属的视频流
+    stream.manager = this;
+    stream.decoder.set_object_instance(&stream);
+    stream.decoder.set_frame_allocator(bgr_pool_);
+    stream.decoder.set_nv12_callback(&StreamManager::OnNV12Frame);
+    if (!stream.decoder.init())
+    {
+        NN_LOG_ERROR("解码器初始化失败。");
+        return false;
+    }
+
+    if (config.Type == "udp")
+    {
+        stream.decoder.start();
+        if (config.RecvFormat == "rtp")
+        {
+            stream.rtp_in.reset(new RtpH264Depacketizer([ctx](const uint8_t *data, size_t len, uint32_t timestamp)
+                                                        { ctx->decoder.set_raw_data(const_cast<uint8_t *>(data), len); }));
+        }
+        if (config.RecvFec)
+        {
+            stream.fec_in.reset(new UdpFecDecoder([ctx](const uint8_t *data, size_t len)
+                                                  { ctx->OnPacket(data, len); },
+                                                  config.RecvFecLatencyMs));
+        }
+        // 一次 recvmmsg 收到的一批数据包依次写入解码器的环形缓冲区，FEC 输入先恢复丢包，RTP 输入再还原成完整的帧
+        // FEC 的等待超时在收到下一个包时检查，视频流持续有包，不另设定时器
+        stream.receiver.reset(new UdpSocket(UdpSocket::BatchHandler([ctx](const UdpPacket *packets, int count)
+                                                                    {
+            for (int i = 0; i < count; i++)
+            {
+                if (ctx->fec_in)
+                {
+                    ctx->fec_in->Input((const uint8_t *)packets[i].data, packets[i].len);
+                }
+                else
+                {
+                    ctx->OnPacket((const uint8_t *)packets[i].data, packets[i].len);
+                }
+            } })));
+        int rcvbuf = stream.receiver->setReceiveBuffer(config.RecvBuffer);
+        NN_LOG_INFO("stream %d udp receive buffer %d, batch %d", stream.id, rcvbuf, config.RecvBatch);
+        stream.receiver->setBatchReceive(config.RecvBatch);
+        stream.receiver->bindSocket(config.ListenPort);
+        stream.receiver->startReceiving();
+    }
+    else if (config.Type == "rtsp")
+    {
+        stream.decoder.start(config.Url, config.RtspTransport);
+    }
+    else if (config.Type == "file")
+    {
+        stream.decoder.start(config.Url, "");
+    }
+    else
+    {
+        NN_LOG_ERROR("unsupported stream type %s", config.Type.c_str());
+        return false;
+    }
+
+    running_++;
+    stream.result_thread = std::thread(&StreamManager::ResultLoop, this, ctx);
+    stream.encode_thread = std::thread([ctx]()
+                                       { ctx->encoder->encoder(); });
+    stream.publish_thread = std::thread(&StreamManager::PublishLoop, ctx);
+    NN_LOG_INFO("stream %d started: %s %s", stream.id, config.Type.c_str(),
+                config.Type == "udp" ? std::to_string(config.ListenPort).c_str() : config.Url.c_str());
+    return true;
+}
+
+void StreamManager::OnNV12Frame(const nv12_frame_view &frame, video_decoder_info info, void *handler)
+{
+    VideoStream *stream = (VideoStream *)handler;
+    StreamManager *self = stream->manager;
+    if (self->pool_ == nullptr)
+    {
+        return;
+    }
+    // 解码器会复用帧内存，这里拷贝成紧凑的 NV12，缓冲区来自帧内存池
+    cv::Mat nv12;
+    self->nv12_pool_->Bind(nv12);
+    nv12View2Mat(frame, nv12);
+    self->pool_->submitFrame(nv12, stream->next_frame_id++, stream->id);
+}
+
+void StreamManager::ResultLoop(VideoStream *stream)
+{
+    while (true)
+    {
+        FrameResult result;
+        auto ret = pool_->pop_next(result, 5000, stream->id);
+        if (ret == NN_STOPED)
+        {
+            break;
+        }
+        if (ret == NN_TIMEOUT && result.id < 0)
+        {
+            // 这段时间内该路没有提交新帧
+            continue;
+        }
+        if (ret != NN_SUCCESS)
+        {
+            NN_LOG_INFO("获取视频流 %d 帧 %d 结果时出错。", stream->id, result.id);
+            continue;
+        }
+        stream->frame_end_id = result.id + 1;
+        stream->result_count++;
+        if (result.img.empty())
+        {
+            NN_LOG_ERROR("接收到空图像。");
+            continue;
+        }
+        on_result_(*stream, result);
+    }
+    // 线程池已停止，不会再有图像送去编码：结束编码循环，再唤醒发送线程
+    stream->encoder->stop();
+    stream->packets->Stop();
+    running_--;
+}
+
+void StreamManager::PublishLoop(VideoStream *stream)
+{
+    // 分包直接指向 PacketManager 的 slab，发送完再归还，不拷贝
+    std::vector<PacketManager::PacketView> frame;
+    std::vector<struct iovec> chunks;
+    while (stream->packets->GetNextFramePackets(frame))
+    {
+        if (frame.empty())
+        {
+            continue;
+        }
+        if (stream->sender)
+        {
+            chunks.clear();
+            if (stream->fec_out)
+            {
+                // 就地写入 FEC 头，校验包插在对应的数据包之后一起发送；一帧结束时结束矩阵，不等下一帧
+                stream->fec_out->BeginBatch();
+                for (const auto &view : frame)
+                {
+                    stream->fec_out->Protect(stream->packets->MutableData(view), view.len - kFecHeaderSize, view.frameEnd, chunks);
+                }
+            }
+            else
+            {
+                for (const auto &view : frame)
+                {
+                    chunks.push_back(iovec{const_cast<char *>(stream->packets->Data(view)), view.len});
+                }
+            }
+            if (!stream->sender->send_batch(chunks.data(), chunks.size()))
+            {
+                printf("视频流 %d UDP发送失败！\n", stream->id);
+            }
+        }
+        stream->packets->Release(frame.back());
+    }
+}
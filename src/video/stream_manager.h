@@ -0,0 +1,150 @@
+// 多路视频流管理：每路一个解码器、编码器和发送端，所有视频流共用一个推理线程池
+
+#ifndef RK3588_DEMO_STREAM_MANAGER_H
+#define RK3588_DEMO_STREAM_MANAGER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "video/rkmpp_decoder.h"
+#include "video/rkmpp_encoder.h"
+#include "io/CircularQueue.h"
+#include "io/udp.h"
+#include "io/rtp_h264.h"
+#include "io/udp_fec.h"
+#include "yolo/yolov8_thread_pool.h"
+#include "utils/frame_pool.h"
+#include "utils/json.hpp"
+
+// 一路视频流的配置，缺省的字段使用默认值
+struct StreamConfig
+{
+    std::string Type = "udp";          // 输入类型：udp（H.264 裸流）、rtsp、file
+    std::string Url;                   // rtsp 地址或文件路径
+    std::string RtspTransport = "tcp"; // rtsp 传输方式：tcp / udp
+    int ListenPort = 8818;             // udp 输入的监听端口
+    int RecvBuffer = 4 * 1024 * 1024;  // udp 输入的套接字接收缓冲区大小
+    int RecvBatch = 64;                // udp 输入每次 recvmmsg 最多接收的数据包数，1 为逐个 recvfrom
+    std::string RecvFormat = "raw";    // udp 输入格式：raw（H.264 裸流）、rtp（RTP/H.264，丢包时只丢弃不完整的帧）
+    bool RecvFec = false;              // udp 输入带有 FEC 校验包（发送端 FecRows / FecCols 非 0），先恢复丢包
+    int RecvFecLatencyMs = 50;         // FEC 恢复最多等待的时间，超过后跳过丢失的包
+    std::string SendIP;                // 编码后视频的发送地址，为空时不发送
+    int SendPort = 0;
+    std::string SendMode = "gso";      // 发送方式：single（每包一次 sendto）、mmsg（每帧一次 sendmmsg）、gso（UDP_SEGMENT）
+    std::string SendFormat = "raw";    // 输出格式：raw（H.264 裸流按包大小切分）、rtp（RTP/H.264，FU-A 分片）
+    int FecRows = 0;                   // 输出的二维 XOR 校验矩阵大小，为 0 时不加 FEC；一帧的包填满矩阵时开销为 (行 + 列) / (行 x 列)，
+    int FecCols = 0;                   // 帧短时更高（4x4 时 1 个包 100%，6 个包 67%，10 个包 70%）；列数即一行的数据包数，
+                                       // 一帧超过一行时能恢复连续 FecCols 个以内的突发丢包
+    std::string Subject;               // 检测结果发布的 NATS 主题，为空时为 ai.infos.<编号>
+    int Width = 1920;                  // 编码器输出大小
+    int Height = 1088;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(StreamConfig, Type, Url, RtspTransport, ListenPort, RecvBuffer, RecvBatch,
+                                                RecvFormat, RecvFec, RecvFecLatencyMs, SendIP, SendPort, SendMode, SendFormat,
+                                                FecRows, FecCols, Subject, Width, Height)
+};
+
+class StreamManager;
+
+// 一路视频流：输入 -> 解码 -> 线程池（该路的帧号序列）-> 结果回调 -> 编码 -> 发送
+class VideoStream
+{
+public:
+    VideoStream(int id, const StreamConfig &config) : id(id), config(config)
+    {
+        if (this->config.Subject.empty())
+        {
+            this->config.Subject = "ai.infos." + std::to_string(id);
+        }
+    }
+
+    const int id;
+    StreamConfig config;
+    StreamManager *manager = nullptr;
+    FCourier::RKMPPDecoder decoder;
+    std::unique_ptr<UdpSocket> receiver;   // udp 输入
+    std::unique_ptr<RtpH264Depacketizer> rtp_in; // RTP 输入时还原成完整的帧
+    std::unique_ptr<UdpFecDecoder> fec_in;       // FEC 输入时恢复丢包，按发送顺序交出数据包
+    std::unique_ptr<RKMPPEncoder> encoder;
+    std::unique_ptr<PacketManager> packets; // 编码后的数据拷贝进 slab，按 UDP 包大小切分
+    std::unique_ptr<UDPSender> sender;
+    std::unique_ptr<RtpH264Packetizer> rtp_out; // RTP 输出时的封包器
+    std::unique_ptr<UdpFecEncoder> fec_out;     // FEC 输出时生成校验包，只在发送线程上使用
+    FPSCalculator encode_bytes; // 编码输出字节数
+    int next_frame_id = 0;      // 下一帧的帧号，只在解码线程上使用
+    int frame_end_id = 0;       // 最近交付的帧号 + 1
+    uint64_t result_count = 0;  // 已交付的结果数
+
+    // 结果、编码、发送线程，由 StreamManager 启动，在 Stop 中等待结束
+    std::thread result_thread;
+    std::thread encode_thread;
+    std::thread publish_thread;
+
+    // 一个 udp 输入的数据包（FEC 输入时为恢复后的）：RTP 输入先还原成完整的帧，裸流直接写入解码器
+    void OnPacket(const uint8_t *data, size_t len);
+};
+
+class StreamManager
+{
+public:
+    // 结果回调，在该路的结果线程上按帧号顺序调用
+    typedef std::function<void(VideoStream &stream, FrameResult &result)> ResultHandler;
+
+    // nv12_pool 为提交推理的 NV12 帧分配内存，bgr_pool 为解码器 Mat 回调的帧分配内存
+    StreamManager(FramePool *nv12_pool, FramePool *bgr_pool) : nv12_pool_(nv12_pool), bgr_pool_(bgr_pool) {}
+    // 停止并等待所有线程，线程池需要在这之后析构
+    ~StreamManager();
+
+    // 添加一路视频流，返回视频流编号，需在线程池启动之前添加完
+    int AddStream(const StreamConfig &config);
+
+    int GetStreamNum() const { return (int)streams_.size(); }
+    VideoStream &GetStream(int id) { return *streams_[id]; }
+
+    /**
+     * @brief 启动所有视频流：编码器、发送端、解码器和输入，以及每路的结果、编码、发送线程
+     * @param pool 已经按 GetStreamNum() 路启动的线程池
+     * @param on_result 结果回调，负责把图像交给编码器和发布检测结果
+     * @return true 全部启动成功
+     */
+    bool Start(ThreadPool *pool, ResultHandler on_result);
+
+    /**
+     * @brief 停止所有视频流并等待各路的结果、编码、发送线程和 udp 接收线程结束，可以重复调用
+     * 先停止输入，再调用线程池的 stopAll：结果线程取不到结果后退出，并依次停止该路的编码器和发送端
+     * 不能在结果回调里调用，结果回调中需要结束时调用线程池的 stopAll
+     */
+    void Stop();
+
+    // 还有结果线程在运行，线程池 stopAll 之后变为 false
+    bool IsRunning() const { return running_ > 0; }
+
+    // 每路的解码帧率、编码输出速率、准入控制的决策，以及收发的系统调用次数和丢包
+    void LogStats();
+
+private:
+    bool StartStream(VideoStream &stream);
+
+    // 解码线程回调：每帧拷贝成紧凑的 NV12，按该路的帧号提交到线程池
+    static void OnNV12Frame(const nv12_frame_view &frame, video_decoder_info info, void *handler);
+
+    // 结果线程：按帧号顺序取出该路的结果，交给结果回调；线程池停止后停止该路的编码器和发送端
+    void ResultLoop(VideoStream *stream);
+
+    // 发送线程：阻塞等待一帧编码数据的所有分包，一次批量发到该路的目标地址
+    static void PublishLoop(VideoStream *stream);
+
+    static const size_t kPacketSize = 1470; // UDP 输出的分包大小
+
+    FramePool *nv12_pool_;
+    FramePool *bgr_pool_;
+    ThreadPool *pool_ = nullptr;
+    ResultHandler on_result_;
+    std::vector<std::unique_ptr<VideoStream>> streams_;
+    std::atomic<int> running_{0}; // 运行中的结果线程数
+};
+
+#endif // RK3588_DEMO_STREAM_MANAGER_H
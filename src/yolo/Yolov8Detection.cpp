@@ -1,50 +1,56 @@
 #include "Yolov8Detection.h"
-#include <random>
 #include "utils/logging.h"
 #include "process/preprocess.h"
-#include "process/postprocess.h"
+
+#include <algorithm>
 
 // define global classes
 
 static std::vector<std::string> g_classes = {
     "person","bus","car","truck"};
 
-Yolov8Detection::Yolov8Detection()
+const int Yolov8Detection::kDefaultMaxDetections;
+
+Yolov8Detection::Yolov8Detection(std::shared_ptr<NNEngine> engine)
 {
-    engine_ = CreateRKNNEngine();
-    input_tensor_.data = nullptr;
+    engine_ = engine;
     want_float_ = false; // 是否使用浮点数版本的后处理
+    output_mode_ = NN_OUTPUT_COPY;
     ready_ = false;
+    batch_ = 1;
+    max_det_ = kDefaultMaxDetections;
 }
 
 Yolov8Detection::~Yolov8Detection()
 {
     // release input tensor and output tensor
-    NN_LOG_DEBUG("release input tensor");
-    if (input_tensor_.data != nullptr)
-    {
-        free(input_tensor_.data);
-        input_tensor_.data = nullptr;
-    }
-    NN_LOG_DEBUG("release output tensor");
-    for (auto &tensor : output_tensors_)
-    {
-        if (tensor.data != nullptr)
-        {
-            free(tensor.data);
-            tensor.data = nullptr;
-        }
-    }
+    NN_LOG_DEBUG("release slot tensors");
+    ReleaseSlot(slot_);
 }
 
 nn_error_e Yolov8Detection::LoadModel(const char *model_path)
 {
+    if (engine_ == nullptr)
+    {
+        engine_ = CreateEngine(model_path);
+    }
     auto ret = engine_->LoadModelFile(model_path);
     if (ret != NN_SUCCESS)
     {
         NN_LOG_ERROR("yolov8 load model file failed");
         return ret;
     }
+    return InitModel();
+}
+
+// 引擎已经加载模型后，按输入输出张量准备预处理、后处理和槽位
+nn_error_e Yolov8Detection::InitModel()
+{
+    if (engine_ == nullptr)
+    {
+        NN_LOG_ERROR("yolov8 engine is not set");
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
     // get input tensor
     auto input_shapes = engine_->GetInputShapes();
 
@@ -54,59 +60,206 @@ nn_error_e Yolov8Detection::LoadModel(const char *model_path)
         NN_LOG_ERROR("yolov8 input tensor number is not 1, but %ld", input_shapes.size());
         return NN_RKNN_INPUT_ATTR_ERROR;
     }
-    nn_tensor_attr_to_cvimg_input_data(input_shapes[0], input_tensor_);
-    input_tensor_.data = malloc(input_tensor_.attr.size);
+    tensor_data_s input_tensor;
+    auto ret = nn_tensor_attr_to_cvimg_input_data(input_shapes[0], input_tensor);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    input_attr_ = input_tensor.attr;
+    batch_ = input_attr_.dims[0];
 
     auto output_shapes = engine_->GetOutputShapes();
-    if (output_shapes.size() != output_num_) // 这里改成8 是因为 p2要多两个输出
+    // 检测头数量、特征图大小、类别数都由输出形状推导，P3-P5 和带 P2 的模型都可以加载
+    ret = decoder_.Init(input_shapes[0], output_shapes);
+    if (ret != NN_SUCCESS)
     {
-        NN_LOG_ERROR("yolov8 output tensor number is not 6, but %ld", output_shapes.size());
-        return NN_RKNN_OUTPUT_ATTR_ERROR;
+        NN_LOG_ERROR("yolov8 output tensor layout is not supported, output num %ld", output_shapes.size());
+        return ret;
     }
+    // 每帧最多保留的框数与检测结果每块的大小一致
+    decoder_.SetMaxDetections(max_det_);
+    arena_ = std::make_shared<DetectionArena>(max_det_);
+    // 类别数由模型决定，超出类别表时用类别编号作为名称
+    classes_ = ClassTable(g_classes, decoder_.GetClassNum());
+    want_float_ = false;
     if (output_shapes[0].type == NN_TENSOR_FLOAT16)
     {
         want_float_ = true;
         NN_LOG_WARNING("yolov8 output tensor type is float16, want type set to float32");
     }
+    else if (output_shapes[0].type == NN_TENSOR_FLOAT)
+    {
+        want_float_ = true;
+    }
+    output_attrs_.clear();
+    out_zps_.clear();
+    out_scales_.clear();
     for (int i = 0; i < output_shapes.size(); i++)
     {
-        tensor_data_s tensor;
-        tensor.attr.n_elems = output_shapes[i].n_elems;
-        tensor.attr.n_dims = output_shapes[i].n_dims;
-        for (int j = 0; j < output_shapes[i].n_dims; j++)
+        // 批量模型的输出按帧连续排列，每帧占 n_elems / batch_
+        if (output_shapes[i].dims[0] != (uint32_t)batch_ || output_shapes[i].n_elems % batch_ != 0)
         {
-            tensor.attr.dims[j] = output_shapes[i].dims[j];
+            NN_LOG_ERROR("yolov8 output[%d] batch %u not match input batch %d", i, output_shapes[i].dims[0], batch_);
+            return NN_RKNN_OUTPUT_ATTR_ERROR;
         }
+        tensor_attr_s attr = output_shapes[i];
         // output tensor needs to be float32
-        tensor.attr.type = want_float_ ? NN_TENSOR_FLOAT : output_shapes[i].type;
-        tensor.attr.index = 0;
-        tensor.attr.size = output_shapes[i].n_elems * nn_tensor_type_to_size(tensor.attr.type);
-        tensor.data = malloc(tensor.attr.size);
-        output_tensors_.push_back(tensor);
+        attr.type = want_float_ ? NN_TENSOR_FLOAT : output_shapes[i].type;
+        attr.index = 0;
+        attr.size = output_shapes[i].n_elems * nn_tensor_type_to_size(attr.type);
+        output_attrs_.push_back(attr);
         out_zps_.push_back(output_shapes[i].zp);
         out_scales_.push_back(output_shapes[i].scale);
     }
 
+    // 优先让引擎直接写入槽位的输出张量，不支持时退回拷贝
+    if (engine_->SetOutputMode(NN_OUTPUT_PREALLOC) == NN_SUCCESS)
+    {
+        output_mode_ = NN_OUTPUT_PREALLOC;
+    }
+    else
+    {
+        engine_->SetOutputMode(NN_OUTPUT_COPY);
+        output_mode_ = NN_OUTPUT_COPY;
+    }
+
     ready_ = true;
+    ret = CreateSlot(slot_);
+    if (ret != NN_SUCCESS)
+    {
+        ready_ = false;
+        return ret;
+    }
     return NN_SUCCESS;
 }
 
-nn_error_e Yolov8Detection::Preprocess(const cv::Mat &img, const std::string process_type, cv::Mat &image_letterbox)
+// 切换输出绑定方式，Run 使用的槽位按新方式重新创建，流水线的槽位需要在切换之后创建
+nn_error_e Yolov8Detection::SetOutputMode(nn_output_mode_e mode)
+{
+    auto ret = engine_->SetOutputMode(mode);
+    if (ret != NN_SUCCESS)
+    {
+        NN_LOG_WARNING("engine does not support output mode %d, keep mode %d", mode, output_mode_);
+        return ret;
+    }
+    ReleaseSlot(slot_);
+    output_mode_ = mode;
+    return ready_ ? CreateSlot(slot_) : NN_SUCCESS;
+}
+
+// 按模型输入输出分配一个槽位的张量
+nn_error_e Yolov8Detection::CreateSlot(DetectionSlot &slot)
+{
+    if (!ready_)
+    {
+        NN_LOG_ERROR("yolov8 model is not loaded");
+        return NN_RKNN_MODEL_NOT_LOAD;
+    }
+    ReleaseSlot(slot);
+    tensor_data_s input;
+    input.attr = input_attr_;
+    input.data = malloc(input_attr_.size);
+    slot.inputs.push_back(input);
+    for (const auto &attr : output_attrs_)
+    {
+        tensor_data_s tensor;
+        tensor.attr = attr;
+        // 借用引擎缓冲区时输出由 Inference 填入
+        tensor.data = output_mode_ == NN_OUTPUT_BORROW ? nullptr : malloc(attr.size);
+        slot.outputs.push_back(tensor);
+    }
+    slot.output_data.resize(slot.outputs.size());
+    slot.letterbox_info.assign(batch_, LetterBoxInfo{false, 0, 0, 0});
+    return NN_SUCCESS;
+}
+
+void Yolov8Detection::ReleaseSlot(DetectionSlot &slot)
+{
+    for (auto &tensor : slot.inputs)
+    {
+        free(tensor.data);
+    }
+    if (output_mode_ == NN_OUTPUT_BORROW)
+    {
+        // 推理后没有经过后处理的槽位还借着引擎的缓冲区
+        if (!slot.outputs.empty() && slot.outputs[0].data != nullptr)
+        {
+            engine_->ReleaseOutputs(slot.outputs);
+        }
+    }
+    else
+    {
+        for (auto &tensor : slot.outputs)
+        {
+            free(tensor.data);
+        }
+    }
+    slot.inputs.clear();
+    slot.outputs.clear();
+    slot.output_data.clear();
+}
+
+nn_error_e Yolov8Detection::Preprocess(const cv::Mat &img, DetectionSlot &slot, int index)
+{
+    return Preprocess(img, "fused", slot, index);
+}
+
+nn_error_e Yolov8Detection::Preprocess(const nv12_frame_view &frame, DetectionSlot &slot, int index)
+{
+    if (index < 0 || index >= batch_)
+    {
+        NN_LOG_ERROR("batch index %d out of range [0, %d)", index, batch_);
+        return NN_INVALID_PARAM;
+    }
+    tensor_data_s &input = slot.inputs[0];
+    uint8_t *dst = (uint8_t *)input.data + (size_t)index * (input.attr.size / batch_);
+    resizer_.Init(frame.width, frame.height, input.attr.dims[2], input.attr.dims[1]);
+    resizer_.Run(frame, dst);
+    slot.letterbox_info[index] = resizer_.GetInfo();
+    return NN_SUCCESS;
+}
+
+nn_error_e Yolov8Detection::Preprocess(const cv::Mat &img, const std::string process_type, DetectionSlot &slot, int index)
 {
 
     // 预处理包含：letterbox、归一化、BGR2RGB、NCWH
     // 其中RKNN会做：归一化、NCWH转换（详见课程文档），所以这里只需要做letterbox、BGR2RGB
+    if (index < 0 || index >= batch_)
+    {
+        NN_LOG_ERROR("batch index %d out of range [0, %d)", index, batch_);
+        return NN_INVALID_PARAM;
+    }
+    // 批量输入按帧连续排列，第 index 帧写入对应的位置
+    tensor_data_s input = slot.inputs[0];
+    input.data = (uint8_t *)input.data + (size_t)index * (input.attr.size / batch_);
+    input.attr.dims[0] = 1;
+    input.attr.n_elems /= batch_;
+    input.attr.size /= batch_;
 
     // 比例
-    float wh_ratio = (float)input_tensor_.attr.dims[2] / (float)input_tensor_.attr.dims[1];
+    float wh_ratio = (float)input.attr.dims[2] / (float)input.attr.dims[1];
 
     // lettorbox
 
-    if (process_type == "opencv")
+    if (process_type == "fused")
+    {
+        // letterbox、resize、BGR2RGB 一次完成，直接写入输入张量，不生成填充后的图像
+        if (img.type() != CV_8UC3)
+        {
+            NN_LOG_ERROR("img has to be 3 channels uint8");
+            return NN_RKNN_INPUT_ATTR_ERROR;
+        }
+        resizer_.Init(img.cols, img.rows, input.attr.dims[2], input.attr.dims[1]);
+        resizer_.Run(img.data, (int)img.step, (uint8_t *)input.data);
+        slot.letterbox_info[index] = resizer_.GetInfo();
+    }
+    else if (process_type == "opencv")
     {
-        // BGR2RGB，resize，再放入input_tensor_中
-        letterbox_info_ = letterbox(img, image_letterbox, wh_ratio);
-        mat2Tensor(image_letterbox, input_tensor_.attr.dims[2], input_tensor_.attr.dims[1], input_tensor_);
+        // BGR2RGB，resize，再放入输入张量中
+        cv::Mat image_letterbox;
+        slot.letterbox_info[index] = letterbox(img, image_letterbox, wh_ratio);
+        mat2Tensor(image_letterbox, input.attr.dims[2], input.attr.dims[1], input);
     }
     else if (process_type == "rga")
     {
@@ -120,59 +273,12 @@ nn_error_e Yolov8Detection::Preprocess(const cv::Mat &img, const std::string pro
     return NN_SUCCESS;
 }
 
-nn_error_e Yolov8Detection::Inference()
+nn_error_e Yolov8Detection::Inference(DetectionSlot &slot)
 {
-    std::vector<tensor_data_s> inputs;
-    inputs.push_back(input_tensor_);
-    return engine_->Run(inputs, output_tensors_, want_float_);
+    return engine_->Run(slot.inputs, slot.outputs, want_float_);
 }
 
-nn_error_e Yolov8Detection::Postprocess(const cv::Mat &img, std::vector<Detection> &objects)
-{
-    void *output_data[8];
-    for (int i = 0; i < 8; i++)
-    {
-        output_data[i] = (void *)output_tensors_[i].data;
-    }
-    std::vector<float> DetectiontRects;
-
-    // 使用量化版本的后处理，只能处理量化的模型
-     yolo::GetConvDetectionResultInt8((int8_t **)output_data, out_zps_, out_scales_, DetectiontRects);
-    //  yolo::GetConvDetectionResult((float **)output_data, DetectiontRects);
-    //  NN_LOG_INFO("use int8 version postprocess");
-
-    int img_width = img.cols;
-    int img_height = img.rows;
-    for (int i = 0; i < DetectiontRects.size(); i += 6)
-    {
-        int classId = int(DetectiontRects[i + 0]);
-        float conf = DetectiontRects[i + 1];
-        int xmin = int(DetectiontRects[i + 2] * float(img_width) + 0.5);
-        int ymin = int(DetectiontRects[i + 3] * float(img_height) + 0.5);
-        int xmax = int(DetectiontRects[i + 4] * float(img_width) + 0.5);
-        int ymax = int(DetectiontRects[i + 5] * float(img_height) + 0.5);
-        Detection result;
-        result.class_id = classId;
-        result.confidence = conf;
-
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<int> dis(100, 255);
-        result.color = cv::Scalar(dis(gen),
-                                  dis(gen),
-                                  dis(gen));
-        result.color = cv::Scalar(0, // 纯红色
-                                  0,
-                                  255);
-        result.className = g_classes[result.class_id];
-        result.box = cv::Rect(xmin, ymin, xmax - xmin, ymax - ymin);
-
-        objects.push_back(result);
-    }
-
-    return NN_SUCCESS;
-}
-void letterbox_decode(std::vector<Detection> &objects, bool hor, int pad)
+void letterbox_decode(DetectionList &objects, bool hor, int pad)
 {
     for (auto &obj : objects)
     {
@@ -187,42 +293,132 @@ void letterbox_decode(std::vector<Detection> &objects, bool hor, int pad)
     }
 }
 
-nn_error_e Yolov8Detection::Run(const cv::Mat &img, std::vector<Detection> &objects)
+
+nn_error_e Yolov8Detection::Postprocess(DetectionSlot &slot, DetectionList &objects)
 {
+    auto ret = Decode(slot, 0, objects);
+    auto release_ret = FinishSlot(slot);
+    return ret != NN_SUCCESS ? ret : release_ret;
+}
 
-    // letterbox后的图像
-    cv::Mat image_letterbox;
-    // 预处理，支持opencv或rga
+nn_error_e Yolov8Detection::Decode(DetectionSlot &slot, int index, DetectionList &objects)
+{
+    if (index < 0 || index >= batch_)
+    {
+        NN_LOG_ERROR("batch index %d out of range [0, %d)", index, batch_);
+        return NN_INVALID_PARAM;
+    }
+    // 批量输出按帧连续排列，取第 index 帧的起始位置
+    for (size_t i = 0; i < slot.outputs.size(); i++)
+    {
+        size_t frame_bytes = output_attrs_[i].size / batch_;
+        slot.output_data[i] = (void *)((uint8_t *)slot.outputs[i].data + index * frame_bytes);
+    }
 
-    // 记录预处理时间
-    // auto start = std::chrono::high_resolution_clock::now();
-    Preprocess(img, "opencv", image_letterbox);
-    // auto end = std::chrono::high_resolution_clock::now();
-    // auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    //  std::cout << "预处理耗时: " << duration.count() << " 毫秒" << std::endl;
+    // 量化模型使用 int8 版本的后处理，浮点输出（float16 模型、CPU 引擎的 float 输出）使用浮点版本
+    if (want_float_)
+    {
+        decoder_.GetConvDetectionResult((float **)slot.output_data.data(), slot.decode);
+    }
+    else
+    {
+        decoder_.GetConvDetectionResultInt8((int8_t **)slot.output_data.data(), out_zps_, out_scales_, slot.decode);
+    }
 
-    // Preprocess(img, "rga", image_letterbox);
+    const yolo::NmsBoxes &boxes = slot.decode.boxes;
+    const LetterBoxInfo &info = slot.letterbox_info[index];
+    float img_width = float(info.width);
+    float img_height = float(info.height);
+    objects.Reset(arena_);
+    for (int k : slot.decode.keep)
+    {
+        int xmin = int(boxes.xmin[k] * img_width + 0.5);
+        int ymin = int(boxes.ymin[k] * img_height + 0.5);
+        int xmax = int(boxes.xmax[k] * img_width + 0.5);
+        int ymax = int(boxes.ymax[k] * img_height + 0.5);
+        Detection result;
+        result.class_id = boxes.classId[k];
+        result.confidence = boxes.score[k];
+        result.box = cv::Rect(xmin, ymin, xmax - xmin, ymax - ymin);
+        if (!objects.push_back(result))
+        {
+            break;
+        }
+    }
+    letterbox_decode(objects, info.hor, info.pad);
+    return NN_SUCCESS;
+}
 
-    // start = std::chrono::high_resolution_clock::now();
+// 解码完成，归还借用的输出缓冲区
+nn_error_e Yolov8Detection::FinishSlot(DetectionSlot &slot)
+{
+    return engine_->ReleaseOutputs(slot.outputs);
+}
+
+nn_error_e Yolov8Detection::Run(const cv::Mat &img, DetectionList &objects)
+{
+    // 预处理，支持fused、opencv或rga，fused 不生成填充后的图像
+    auto ret = Preprocess(img, "fused", slot_, 0);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
     //  推理
-    Inference();
-    // end = std::chrono::high_resolution_clock::now();
-    // duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    // std::cout << "推理理耗时: " << duration.count() << " 毫秒" << std::endl;
+    ret = Inference(slot_);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
     //  后处理
+    return Postprocess(slot_, objects);
+}
 
-    // start = std::chrono::high_resolution_clock::now();
-    Postprocess(image_letterbox, objects);
-    letterbox_decode(objects, letterbox_info_.hor, letterbox_info_.pad);
-
-    // end = std::chrono::high_resolution_clock::now();
-    // duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    // std::cout << "后处理耗时: " << duration.count() << " 毫秒" << std::endl;
-
-    // 记录后处理时间
-    // Postprocess(image_letterbox, objects);
-
-    // letterbox_decode(objects, letterbox_info_.hor, letterbox_info_.pad);
+nn_error_e Yolov8Detection::Run(const nv12_frame_view &frame, DetectionList &objects)
+{
+    auto ret = Preprocess(frame, slot_);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    ret = Inference(slot_);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    return Postprocess(slot_, objects);
+}
 
+nn_error_e Yolov8Detection::RunBatch(const std::vector<cv::Mat> &imgs, std::vector<DetectionList> &objects)
+{
+    objects.resize(imgs.size());
+    for (size_t begin = 0; begin < imgs.size(); begin += batch_)
+    {
+        int count = (int)std::min(imgs.size() - begin, (size_t)batch_);
+        for (int k = 0; k < count; k++)
+        {
+            const cv::Mat &img = imgs[begin + k];
+            // 单通道图像是 NV12
+            auto ret = img.type() == CV_8UC1 ? Preprocess(nv12Mat2View(img), slot_, k) : Preprocess(img, slot_, k);
+            if (ret != NN_SUCCESS)
+            {
+                return ret;
+            }
+        }
+        // 一批只调用一次引擎
+        auto ret = Inference(slot_);
+        if (ret != NN_SUCCESS)
+        {
+            return ret;
+        }
+        for (int k = 0; k < count && ret == NN_SUCCESS; k++)
+        {
+            ret = Decode(slot_, k, objects[begin + k]);
+        }
+        auto release_ret = FinishSlot(slot_);
+        if (ret != NN_SUCCESS || release_ret != NN_SUCCESS)
+        {
+            return ret != NN_SUCCESS ? ret : release_ret;
+        }
+    }
     return NN_SUCCESS;
-}
\ No newline at end of file
+}
@@ -7,32 +7,89 @@
 
 #include <opencv2/opencv.hpp>
 #include "process/preprocess.h"
+#include "process/postprocess.h"
 #include "types/yolo_datatype.h"
 
+// 一次推理用到的输入输出张量和 letterbox 信息，批量模型（输入 dims[0] = N）的一个槽位装 N 帧
+// 流水线里每个模型上下文预分配多个槽位轮流使用，预处理、推理、后处理可以同时处理不同的槽位
+struct DetectionSlot
+{
+    std::vector<tensor_data_s> inputs;
+    std::vector<tensor_data_s> outputs;
+    std::vector<void *> output_data; // 后处理用的输出指针，数量与模型输出一致
+    std::vector<LetterBoxInfo> letterbox_info; // 每帧一个，数量为批大小
+    yolo::DecodeScratch decode;      // 后处理的候选框和 NMS 缓冲区，随槽位复用
+};
+
 class Yolov8Detection
 {
 public:
-    Yolov8Detection();
+    // engine 为空时 LoadModel 按模型扩展名创建引擎（.onnx 为 OpenCV DNN，其他为 RKNN），也可以传入其他 NNEngine 实现
+    explicit Yolov8Detection(std::shared_ptr<NNEngine> engine = nullptr);
     ~Yolov8Detection();
 
     nn_error_e LoadModel(const char *model_path);
+    // 构造时传入的引擎已经加载了模型（例如 ModelRegistry 创建的共享权重上下文）时，用它代替 LoadModel
+    nn_error_e InitModel();
+    // 输出绑定方式，InitModel 默认选择 NN_OUTPUT_PREALLOC，引擎不支持时为 NN_OUTPUT_COPY
+    nn_error_e SetOutputMode(nn_output_mode_e mode);
+    nn_output_mode_e GetOutputMode() const { return output_mode_; }
+    // 每帧最多保留的检测框数，决定 NMS 的保留上限和检测结果每块的大小，在 LoadModel / InitModel 之前设置
+    void SetMaxDetections(int max_det) { max_det_ = max_det > 0 ? max_det : kDefaultMaxDetections; }
+    int GetMaxDetections() const { return max_det_; }
+
+    static const int kDefaultMaxDetections = 128;
+
+    nn_error_e Run(const cv::Mat &img, DetectionList &objects);
+    // NV12 输入，YUV 转 RGB、resize、letterbox 一次完成，不生成 BGR 图像
+    nn_error_e Run(const nv12_frame_view &frame, DetectionList &objects);
+    /**
+     * @brief 批量推理，每 GetBatchSize() 帧填入一个批量输入，调用一次引擎，再按帧拆分输出做后处理
+     * 最后一批不满时只解码已填入的帧
+     * @param imgs BGR 图像，单通道时视为 NV12
+     * @param objects 输出每帧的检测结果，与 imgs 一一对应
+     * @return nn_error_e 错误码
+     */
+    nn_error_e RunBatch(const std::vector<cv::Mat> &imgs, std::vector<DetectionList> &objects);
+    // 模型输入的批大小（dims[0]），普通模型为 1
+    int GetBatchSize() const { return batch_; }
+
+    // 分阶段接口，供流水线使用。LoadModel 之后才能创建槽位
+    // 同一个实例上 Preprocess 不能并发调用（共用缩放系数和行缓存），Inference、Postprocess 只访问传入的槽位
+    // index 为帧在批量输入中的位置，0 <= index < GetBatchSize()
+    nn_error_e CreateSlot(DetectionSlot &slot);
+    void ReleaseSlot(DetectionSlot &slot);
+    nn_error_e Preprocess(const cv::Mat &img, DetectionSlot &slot, int index = 0);
+    nn_error_e Preprocess(const nv12_frame_view &frame, DetectionSlot &slot, int index = 0);
+    nn_error_e Inference(DetectionSlot &slot);
+    // 解码第 0 帧并归还输出缓冲区，等同于 Decode + FinishSlot
+    nn_error_e Postprocess(DetectionSlot &slot, DetectionList &objects);
+    // 解码批量输出中的第 index 帧，槽位的所有帧解码完之后调用 FinishSlot
+    nn_error_e Decode(DetectionSlot &slot, int index, DetectionList &objects);
+    // 归还借用的输出缓冲区（NN_OUTPUT_BORROW），其他方式下什么也不做
+    nn_error_e FinishSlot(DetectionSlot &slot);
 
-    nn_error_e Run(const cv::Mat &img, std::vector<Detection> &objects);
+    // 类别名称和颜色，LoadModel 之后有效
+    const ClassTable &GetClassTable() const { return classes_; }
 
 private:
-    nn_error_e Preprocess(const cv::Mat &img, const std::string process_type, cv::Mat &image_letterbox);
-    nn_error_e Inference();
-    nn_error_e Postprocess(const cv::Mat &img, std::vector<Detection> &objects);
+    nn_error_e Preprocess(const cv::Mat &img, const std::string process_type, DetectionSlot &slot, int index);
 
     bool ready_;
-    LetterBoxInfo letterbox_info_;
-    tensor_data_s input_tensor_;
-    std::vector<tensor_data_s> output_tensors_;
+    int batch_;                               // 批大小，输入输出的 dims[0]
+    tensor_attr_s input_attr_;                // 输入张量属性（NHWC uint8，整批）
+    std::vector<tensor_attr_s> output_attrs_; // 输出张量属性（整批）
+    DetectionSlot slot_;               // Run 使用的槽位
+    LetterboxResizer resizer_;         // fused 预处理的缩放系数和行缓存
     bool want_float_;
+    nn_output_mode_e output_mode_;
     std::vector<int32_t> out_zps_;
     std::vector<float> out_scales_;
     std::shared_ptr<NNEngine> engine_;
-    int  output_num_ = 8;
+    yolo::DetectionDecoder decoder_;   // 检测头布局由模型输出推导
+    int max_det_;
+    std::shared_ptr<DetectionArena> arena_; // 检测结果的存储，InitModel 时按 max_det_ 创建
+    ClassTable classes_;
 };
 
 #endif // RK3588_DEMO_YOLOV8_CUSTOM_H
@@ -0,0 +1,144 @@
+#include "admission_controller.h"
+
+#include <algorithm>
+
+#include "utils/logging.h"
+
+// 样本太少时分位数不可信
+static const size_t kMinSamples = 10;
+// 时间窗口内样本数的上限，帧率异常高时只保留最近的
+static const size_t kMaxSamples = 4096;
+
+AdmissionController::AdmissionController(int stream_num, const AdmissionConfig &config) : config_(config)
+{
+    config_.min_stride = std::max(1, config_.min_stride);
+    config_.max_stride = std::max(config_.min_stride, config_.max_stride);
+    auto now = std::chrono::steady_clock::now();
+    streams_.resize(stream_num > 0 ? stream_num : 1);
+    for (auto &s : streams_)
+    {
+        s.stats.stride = config_.min_stride;
+        s.last_eval = now;
+        s.last_change = now;
+        s.last_lower = now - std::chrono::hours(1);
+        s.hold_ms = config_.hold_ms;
+    }
+}
+
+bool AdmissionController::Admit(int stream, size_t queue_depth, size_t queue_capacity)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    StreamState &s = streams_[stream];
+    auto now = std::chrono::steady_clock::now();
+    if (now - s.last_eval >= std::chrono::milliseconds(config_.eval_interval_ms))
+    {
+        Evaluate(stream, s, queue_depth, queue_capacity, now);
+    }
+    if (s.skip_left > 0)
+    {
+        s.skip_left--;
+        s.stats.skipped++;
+        return false;
+    }
+    s.skip_left = s.stats.stride - 1;
+    s.stats.admitted++;
+    return true;
+}
+
+void AdmissionController::OnDelivered(int stream, double latency_ms, bool inferred)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    StreamState &s = streams_[stream];
+    // 跳过推理的帧排在前一个推理帧之后交付，同样计入端到端延迟
+    auto now = std::chrono::steady_clock::now();
+    auto submit = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double, std::milli>(latency_ms));
+    if (submit >= s.last_change)
+    {
+        if (s.samples.size() >= kMaxSamples)
+        {
+            s.samples.erase(s.samples.begin());
+        }
+        s.samples.push_back(Sample{submit, (float)latency_ms});
+    }
+    if (inferred)
+    {
+        s.inferred_since_eval++;
+    }
+}
+
+AdmissionStats AdmissionController::GetStats(int stream)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return streams_[stream].stats;
+}
+
+void AdmissionController::Evaluate(int stream, StreamState &s, size_t depth, size_t capacity, time_point now)
+{
+    double elapsed = std::chrono::duration<double>(now - s.last_eval).count();
+    s.stats.infer_fps = elapsed > 0 ? s.inferred_since_eval / elapsed : 0;
+    s.inferred_since_eval = 0;
+    s.last_eval = now;
+
+    // 样本按提交时间递增，去掉窗口之外的
+    auto oldest = now - std::chrono::milliseconds(config_.window_ms);
+    auto it = std::find_if(s.samples.begin(), s.samples.end(), [&](const Sample &sample)
+                           { return sample.submit >= oldest; });
+    s.samples.erase(s.samples.begin(), it);
+    bool valid = s.samples.size() >= kMinSamples;
+    if (valid)
+    {
+        std::vector<float> sorted;
+        sorted.reserve(s.samples.size());
+        for (const auto &sample : s.samples)
+        {
+            sorted.push_back(sample.latency_ms);
+        }
+        size_t p50 = sorted.size() / 2;
+        size_t p99 = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+        std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+        s.stats.p99_ms = sorted[p99];
+        std::nth_element(sorted.begin(), sorted.begin() + p50, sorted.begin() + p99);
+        s.stats.p50_ms = sorted[p50];
+    }
+
+    // 队列没有积压时延迟主要是推理本身的耗时，跳帧不能降低，只看积压
+    bool slow = valid && s.stats.p99_ms > config_.target_p99_ms && depth > 0;
+    bool backlog = capacity > 0 && depth * 2 >= capacity;
+    // 上次调整之后积压在减少，说明新的间隔已经跟得上，等它消化完
+    bool draining = depth < s.change_depth;
+    if ((slow || backlog) && !draining && s.stats.stride < config_.max_stride)
+    {
+        NN_LOG_INFO("stream %d p99 %.1f ms queue %lu/%lu, stride %d -> %d", stream, s.stats.p99_ms,
+                    (unsigned long)depth, (unsigned long)capacity, s.stats.stride, s.stats.stride + 1);
+        // 刚减小就又过载，说明处理能力在两个间隔之间，延长保持时间
+        if (now - s.last_lower < std::chrono::milliseconds(s.hold_ms * 2))
+        {
+            s.hold_ms = std::min(s.hold_ms * 2, config_.hold_ms * 16);
+        }
+        SetStride(s, s.stats.stride + 1, depth, now);
+        s.stats.raised++;
+    }
+    else if (valid && s.stats.p99_ms < config_.target_p99_ms * config_.relax_ratio && depth <= 1 &&
+             s.stats.stride > config_.min_stride && now - s.last_change >= std::chrono::milliseconds(s.hold_ms))
+    {
+        NN_LOG_INFO("stream %d p99 %.1f ms, stride %d -> %d", stream, s.stats.p99_ms, s.stats.stride, s.stats.stride - 1);
+        SetStride(s, s.stats.stride - 1, depth, now);
+        s.stats.lowered++;
+        s.last_lower = now;
+    }
+    else if (draining)
+    {
+        s.change_depth = depth;
+    }
+}
+
+void AdmissionController::SetStride(StreamState &s, int stride, size_t depth, time_point now)
+{
+    s.stats.stride = stride;
+    s.skip_left = std::min(s.skip_left, stride - 1);
+    s.change_depth = depth;
+    s.last_change = now;
+    // 旧间隔下提交的帧不再代表当前负载，重新积累
+    s.samples.clear();
+}
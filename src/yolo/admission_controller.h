@@ -0,0 +1,87 @@
+// 推理准入控制：按队列深度和端到端延迟为每路视频流选择推理间隔（每 stride 帧推理一帧）
+
+#ifndef RK3588_DEMO_ADMISSION_CONTROLLER_H
+#define RK3588_DEMO_ADMISSION_CONTROLLER_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// 准入控制参数
+struct AdmissionConfig
+{
+    int target_p99_ms = 150;   // 端到端延迟目标（提交到按序交付），p99 超过时增大间隔
+    int min_stride = 1;        // 推理间隔下限，1 表示每帧都推理
+    int max_stride = 8;        // 推理间隔上限
+    int window_ms = 2000;      // 计算延迟分位数的时间窗口，只统计窗口内且在上次调整之后提交的帧
+    int eval_interval_ms = 500; // 两次评估之间的最短时间
+    int hold_ms = 2000;        // 调整之后至少保持这么久才允许减小间隔；减小后很快又增大时加倍（最多 16 倍），避免来回抖动
+    double relax_ratio = 0.6;  // p99 低于 target * relax_ratio 且队列基本为空时减小间隔
+};
+
+// 一路视频流的准入统计
+struct AdmissionStats
+{
+    int stride = 1;           // 当前推理间隔
+    double p50_ms = 0;        // 最近窗口的端到端延迟，样本不足时为 0
+    double p99_ms = 0;
+    double infer_fps = 0;     // 最近一次评估周期内按序交付的推理帧率
+    uint64_t admitted = 0;    // 送去推理的帧数
+    uint64_t skipped = 0;     // 跳过推理、沿用上一次检测框的帧数
+    uint64_t raised = 0;      // 间隔增大的次数
+    uint64_t lowered = 0;     // 间隔减小的次数
+};
+
+// 解码线程调用 Admit 决定每帧是否推理，结果线程调用 OnDelivered 反馈延迟，评估和调整在 Admit 中进行
+// 过载（p99 超过目标且队列有积压，或队列积压过半）并且积压没有比上次调整时减少时间隔加 1；
+// 积压正在消化时先等待，避免一次过载把间隔一路加到上限。延迟充裕且队列基本为空时间隔减 1
+// 每路视频流各自调整，多路共享推理资源时负载重的路先被放慢
+class AdmissionController
+{
+public:
+    AdmissionController(int stream_num, const AdmissionConfig &config);
+
+    /**
+     * @brief 决定该路的下一帧是否送去推理
+     * @param stream 视频流编号
+     * @param queue_depth 该路任务队列当前长度
+     * @param queue_capacity 该路任务队列容量
+     * @return true 推理，false 跳过推理
+     */
+    bool Admit(int stream, size_t queue_depth, size_t queue_capacity);
+    // 一帧按序交付时调用，latency_ms 为提交到交付的时间，inferred 为是否经过推理
+    void OnDelivered(int stream, double latency_ms, bool inferred);
+
+    AdmissionStats GetStats(int stream);
+
+private:
+    typedef std::chrono::steady_clock::time_point time_point;
+    struct Sample
+    {
+        time_point submit; // 提交时间
+        float latency_ms;
+    };
+    struct StreamState
+    {
+        AdmissionStats stats;
+        int skip_left = 0;                 // 还要跳过的帧数
+        std::vector<Sample> samples;       // 按交付顺序的延迟样本
+        size_t change_depth = 0;           // 上次调整时的队列长度
+        uint64_t inferred_since_eval = 0;
+        time_point last_eval;
+        time_point last_change;
+        time_point last_lower;             // 上次减小间隔的时间
+        int hold_ms = 0;                   // 当前的保持时间
+    };
+
+    void Evaluate(int stream, StreamState &s, size_t depth, size_t capacity, time_point now);
+    void SetStride(StreamState &s, int stride, size_t depth, time_point now);
+
+    AdmissionConfig config_;
+    std::vector<StreamState> streams_;
+    std::mutex mtx_; // 每帧加锁一次，开销相对解码和推理可以忽略
+};
+
+#endif // RK3588_DEMO_ADMISSION_CONTROLLER_H
@@ -0,0 +1,211 @@
+#include "pipeline_executor.h"
+
+#include <chrono>
+
+#include "utils/logging.h"
+
+PipelineExecutor::PipelineExecutor(std::shared_ptr<Yolov8Detection> detector, int slot_num, int batch_wait_us)
+    : detector_(detector),
+      batch_(detector->GetBatchSize()),
+      batch_wait_us_(batch_wait_us),
+      slots_(slot_num < 3 ? 3 : slot_num),
+      frames_(slots_.size() * batch_),
+      frame_ret_(frames_.size(), NN_SUCCESS),
+      free_slots_(slots_.size()),
+      infer_queue_(slots_.size()),
+      post_queue_(slots_.size())
+{
+}
+
+PipelineExecutor::~PipelineExecutor()
+{
+    free_slots_.exit();
+    infer_queue_.exit();
+    post_queue_.exit();
+    Join();
+    // 各阶段退出时队列中可能还有没取走的槽位，其中的帧同样要交给回调
+    Stage stage;
+    while (infer_queue_.try_pop(stage))
+    {
+        stage.ret = NN_STOPED; // 还没有推理
+        AbandonStage(stage);
+    }
+    while (post_queue_.try_pop(stage))
+    {
+        AbandonStage(stage);
+    }
+    for (auto &slot : slots_)
+    {
+        detector_->ReleaseSlot(slot);
+    }
+}
+
+nn_error_e PipelineExecutor::Start(FairQueue<pipeline_task_t> *tasks, ResultCallback on_result)
+{
+    for (size_t i = 0; i < slots_.size(); i++)
+    {
+        auto ret = detector_->CreateSlot(slots_[i]);
+        if (ret != NN_SUCCESS)
+        {
+            return ret;
+        }
+        free_slots_.try_push(int(i));
+    }
+    tasks_ = tasks;
+    on_result_ = on_result;
+    threads_.emplace_back(&PipelineExecutor::PreprocessLoop, this);
+    threads_.emplace_back(&PipelineExecutor::InferenceLoop, this);
+    threads_.emplace_back(&PipelineExecutor::PostprocessLoop, this);
+    return NN_SUCCESS;
+}
+
+void PipelineExecutor::Join()
+{
+    for (auto &thread : threads_)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+// 预处理线程：取任务，等空闲槽位，写入槽位的输入张量
+// 批量模型在取到第一帧后继续从任务队列取帧，凑满一批或等到 batch_wait_us 为止，不同视频流的帧可以在同一批
+void PipelineExecutor::PreprocessLoop()
+{
+    pipeline_task_t task;
+    while (tasks_->pop(task))
+    {
+        int slot = 0;
+        if (!free_slots_.pop(slot))
+        {
+            // 流水线已停止，已取出的任务没有结果，交给回调让该路跳过这一帧
+            FrameResult frame;
+            frame.id = task.id;
+            frame.stream_id = task.stream;
+            frame.start = task.start;
+            on_result_(NN_STOPED, std::move(frame));
+            break;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(batch_wait_us_);
+        int count = 0;
+        while (true)
+        {
+            int index = slot * batch_ + count;
+            FrameResult &frame = frames_[index];
+            frame.id = task.id;
+            frame.stream_id = task.stream;
+            frame.start = task.start;
+            frame.img = task.img;
+            task.img = cv::Mat();
+
+            // 单通道图像是 NV12
+            if (frame.img.type() == CV_8UC1)
+            {
+                frame_ret_[index] = detector_->Preprocess(nv12Mat2View(frame.img), slots_[slot], count);
+            }
+            else
+            {
+                frame_ret_[index] = detector_->Preprocess(frame.img, slots_[slot], count);
+            }
+            count++;
+            if (count == batch_)
+            {
+                break;
+            }
+            auto now = std::chrono::steady_clock::now();
+            bool got = now < deadline
+                           ? tasks_->pop_for(task, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now))
+                           : tasks_->try_pop(task);
+            if (!got)
+            {
+                break;
+            }
+        }
+        if (!infer_queue_.push(Stage{slot, count, NN_SUCCESS}))
+        {
+            AbandonStage(Stage{slot, count, NN_STOPED});
+            break;
+        }
+    }
+    // 任务队列已退出，通知下一阶段处理完剩余的帧后结束
+    infer_queue_.exit();
+}
+
+// 推理线程：只做推理，模型上下文只在这个线程上使用
+void PipelineExecutor::InferenceLoop()
+{
+    Stage stage;
+    while (infer_queue_.pop(stage))
+    {
+        // 一批帧全部预处理失败时不需要推理
+        bool any_ok = false;
+        for (int k = 0; k < stage.count; k++)
+        {
+            any_ok = any_ok || frame_ret_[stage.slot * batch_ + k] == NN_SUCCESS;
+        }
+        stage.ret = any_ok ? detector_->Inference(slots_[stage.slot]) : NN_RKNN_INPUT_ATTR_ERROR;
+        if (!post_queue_.push(Stage(stage)))
+        {
+            AbandonStage(stage);
+            break;
+        }
+    }
+    post_queue_.exit();
+}
+
+// 后处理线程：按帧拆分批量输出解码检测框，交出结果，归还槽位
+void PipelineExecutor::PostprocessLoop()
+{
+    Stage stage;
+    std::vector<FrameResult> results;
+    std::vector<nn_error_e> rets;
+    while (post_queue_.pop(stage))
+    {
+        results.clear();
+        rets.clear();
+        for (int k = 0; k < stage.count; k++)
+        {
+            int index = stage.slot * batch_ + k;
+            results.push_back(std::move(frames_[index]));
+            frames_[index] = FrameResult();
+            nn_error_e ret = stage.ret != NN_SUCCESS ? stage.ret : frame_ret_[index];
+            if (ret == NN_SUCCESS)
+            {
+                ret = detector_->Decode(slots_[stage.slot], k, results.back().objects);
+            }
+            rets.push_back(ret);
+        }
+        if (stage.ret == NN_SUCCESS)
+        {
+            detector_->FinishSlot(slots_[stage.slot]);
+        }
+        free_slots_.push(int(stage.slot));
+        for (int k = 0; k < stage.count; k++)
+        {
+            if (rets[k] != NN_SUCCESS)
+            {
+                NN_LOG_ERROR("pipeline frame %d failed, ret=%d", results[k].id, rets[k]);
+            }
+            on_result_(rets[k], std::move(results[k]));
+        }
+    }
+}
+
+// 槽位中的帧不再继续处理（流水线已停止）：归还推理借出的输出，每帧以 NN_STOPED 交给回调，该路的消费者跳过这些帧号
+void PipelineExecutor::AbandonStage(const Stage &stage)
+{
+    if (stage.ret == NN_SUCCESS)
+    {
+        detector_->FinishSlot(slots_[stage.slot]);
+    }
+    for (int k = 0; k < stage.count; k++)
+    {
+        int index = stage.slot * batch_ + k;
+        FrameResult frame = std::move(frames_[index]);
+        frames_[index] = FrameResult();
+        on_result_(NN_STOPED, std::move(frame));
+    }
+}
@@ -0,0 +1,69 @@
+// 三级流水线：预处理 -> 推理 -> 后处理
+
+#ifndef RK3588_DEMO_PIPELINE_EXECUTOR_H
+#define RK3588_DEMO_PIPELINE_EXECUTOR_H
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Yolov8Detection.h"
+#include "reorder_buffer.h"
+#include "utils/fair_queue.h"
+
+// 一个推理任务：帧号 + 视频流 + 时间 + mat（单通道为 NV12，三通道为 BGR）
+struct pipeline_task_t
+{
+    int id = -1;
+    int stream = 0;
+    fc_clock start;
+    cv::Mat img;
+};
+
+// 一个模型上下文的流水线，每个阶段一个线程，阶段之间用槽位编号传递
+// 槽位数至少为 3：推理第 N 帧时，第 N+1 帧的输入和第 N-1 帧的输出都要各占一个槽位
+// 多个上下文的预处理线程从同一个任务队列取任务，多路视频流在队列中按路轮流取出
+// 批量模型（批大小 N > 1）时动态组批：取到一帧后最多再等 batch_wait_us 凑满 N 帧，一个槽位一次推理
+class PipelineExecutor
+{
+public:
+    // 后处理完成（ret 为 NN_SUCCESS）或任一阶段失败时调用，一般在后处理线程上执行
+    // 每个取出的任务都会回调一次：流水线停止时还没处理完的帧以 NN_STOPED 在所在阶段的线程上回调
+    typedef std::function<void(nn_error_e ret, FrameResult &&result)> ResultCallback;
+
+    PipelineExecutor(std::shared_ptr<Yolov8Detection> detector, int slot_num = 3, int batch_wait_us = 0);
+    ~PipelineExecutor();
+
+    nn_error_e Start(FairQueue<pipeline_task_t> *tasks, ResultCallback on_result);
+    // 任务队列 exit 之后调用，处理完已取出的帧后返回
+    void Join();
+
+private:
+    struct Stage
+    {
+        int slot;          // 槽位编号
+        int count;         // 槽位中的帧数，不超过批大小
+        nn_error_e ret;    // 推理的结果，每帧预处理的结果在 frame_ret_ 中
+    };
+
+    void PreprocessLoop();
+    void InferenceLoop();
+    void PostprocessLoop();
+    void AbandonStage(const Stage &stage);
+
+    std::shared_ptr<Yolov8Detection> detector_;
+    int batch_;                       // 批大小
+    int batch_wait_us_;               // 凑批最长等待时间
+    std::vector<DetectionSlot> slots_;
+    std::vector<FrameResult> frames_; // 每个槽位 batch_ 个，保存帧号、时间和图像，第 k 帧为 frames_[slot * batch_ + k]
+    std::vector<nn_error_e> frame_ret_; // 与 frames_ 对应，每帧预处理的结果
+    FairQueue<pipeline_task_t> *tasks_ = nullptr;
+    BlockingQueue<int> free_slots_;     // 空闲槽位
+    BlockingQueue<Stage> infer_queue_;  // 预处理完成，等待推理
+    BlockingQueue<Stage> post_queue_;   // 推理完成，等待后处理
+    ResultCallback on_result_;
+    std::vector<std::thread> threads_;
+};
+
+#endif // RK3588_DEMO_PIPELINE_EXECUTOR_H
@@ -0,0 +1,174 @@
+#include "reorder_buffer.h"
+
+#include <algorithm>
+
+#include "utils/logging.h"
+
+ReorderBuffer::ReorderBuffer(int capacity) : slots_(capacity > 0 ? capacity : 1) {}
+
+nn_error_e ReorderBuffer::Expect(int id, fc_clock start)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!started_)
+    {
+        // 第一帧决定起始帧号
+        next_id_ = id;
+        started_ = true;
+    }
+    if (id < next_id_)
+    {
+        NN_LOG_ERROR("reorder buffer expect id %d is older than next id %d", id, next_id_);
+        return NN_INVALID_PARAM;
+    }
+    // 窗口已满，等待消费者
+    cv_space_.wait(lock, [&]
+                   { return stop_ || id < next_id_ + (int)slots_.size(); });
+    if (stop_)
+    {
+        return NN_STOPED;
+    }
+    Slot &slot = GetSlot(id);
+    slot.id = id;
+    slot.state = SLOT_PENDING;
+    slot.result.start = start;
+    last_id_ = std::max(last_id_, id);
+    // 队首登记，或者队首还没登记而之后的帧号已登记（消费者可以跳过队首）
+    if (id == next_id_ || GetSlot(next_id_).id != next_id_)
+    {
+        cv_head_.notify_one();
+    }
+    return NN_SUCCESS;
+}
+
+void ReorderBuffer::Put(FrameResult &&result)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Slot &slot = GetSlot(result.id);
+    if (result.id < next_id_ || slot.id != result.id || slot.state != SLOT_PENDING)
+    {
+        // 已经被超时跳过
+        late_++;
+        return;
+    }
+    slot.result = std::move(result);
+    slot.state = SLOT_DONE;
+    if (slot.id == next_id_)
+    {
+        cv_head_.notify_one();
+    }
+}
+
+void ReorderBuffer::Drop(int id)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    Slot &slot = GetSlot(id);
+    if (id < next_id_ || slot.id != id || slot.state != SLOT_PENDING)
+    {
+        return;
+    }
+    slot.state = SLOT_DROPPED;
+    slot.result = FrameResult();
+    dropped_++;
+    if (id == next_id_)
+    {
+        cv_head_.notify_one();
+    }
+}
+
+nn_error_e ReorderBuffer::PopNext(FrameResult &result, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    // 队首一直没有登记时的期限，从调用时开始计算
+    auto idle_deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true)
+    {
+        if (stop_)
+        {
+            return NN_STOPED;
+        }
+        Slot &slot = GetSlot(next_id_);
+        if (started_ && slot.id != next_id_ && last_id_ > next_id_)
+        {
+            // 帧号按递增顺序登记，之后的帧号已经登记，队首不会再来，直接跳过
+            next_id_++;
+            skipped_++;
+            cv_space_.notify_all();
+            continue;
+        }
+        if (!started_ || slot.id != next_id_)
+        {
+            // 队首还没有登记，等到期限后返回，不跳过帧号
+            if (cv_head_.wait_until(lock, idle_deadline) == std::cv_status::timeout)
+            {
+                result = FrameResult();
+                return NN_TIMEOUT;
+            }
+            continue;
+        }
+        if (slot.state == SLOT_PENDING)
+        {
+            auto deadline = slot.result.start + std::chrono::milliseconds(timeout_ms);
+            if (cv_head_.wait_until(lock, deadline) != std::cv_status::timeout || slot.state != SLOT_PENDING)
+            {
+                continue;
+            }
+            // 超时，跳过该帧号，之后到达的结果会被丢弃
+            result = FrameResult();
+            result.id = next_id_;
+            slot.state = SLOT_EMPTY;
+            slot.id = -1;
+            next_id_++;
+            timeout_++;
+            cv_space_.notify_all();
+            return NN_TIMEOUT;
+        }
+
+        bool done = slot.state == SLOT_DONE;
+        if (done)
+        {
+            result = std::move(slot.result);
+        }
+        slot.result = FrameResult();
+        slot.state = SLOT_EMPTY;
+        slot.id = -1;
+        next_id_++;
+        cv_space_.notify_all();
+        if (done)
+        {
+            return NN_SUCCESS;
+        }
+        // 已放弃的帧号直接跳过
+    }
+}
+
+void ReorderBuffer::Stop()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+    cv_head_.notify_all();
+    cv_space_.notify_all();
+}
+
+uint64_t ReorderBuffer::GetDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return dropped_;
+}
+
+uint64_t ReorderBuffer::GetTimeoutCount()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return timeout_;
+}
+
+uint64_t ReorderBuffer::GetSkippedCount()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return skipped_;
+}
+
+uint64_t ReorderBuffer::GetLateCount()
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return late_;
+}
@@ -0,0 +1,89 @@
+// 按帧号顺序交付推理结果的重排缓冲区
+
+#ifndef RK3588_DEMO_REORDER_BUFFER_H
+#define RK3588_DEMO_REORDER_BUFFER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "types/error.h"
+#include "types/yolo_datatype.h"
+
+// 提交时间，用于超时期限和延迟统计，必须是单调时钟，系统时间被 NTP 校正或手动修改时不受影响
+// 需要显示的日期时间（例如保存图片的文件名）另外用 system_clock 获取
+typedef std::chrono::steady_clock::time_point fc_clock;
+
+// 一帧的完整结果：图像和检测框一起交付
+struct FrameResult
+{
+    int id = -1;                    // 帧号，每路视频流各自编号
+    int stream_id = 0;              // 视频流编号
+    fc_clock start;                 // 提交时间
+    cv::Mat img;                    // BGR 图像（NV12 任务已转成 BGR），需要绘制时已绘制检测框
+    DetectionList objects;          // 检测框
+    bool skipped = false;           // 准入控制跳过了推理，检测框沿用该路上一次推理的结果
+};
+
+// 多个 worker 乱序写入，一个消费者按帧号顺序取出
+// 容量固定，帧号 id 对应槽位 id % capacity，窗口 [next_id, next_id + capacity) 之外的帧号不能提交
+// 每个帧号都需要先 Expect 再 Put 或 Drop；消费者只在队首帧号上等待，队首完成时才被唤醒
+// 同一路的帧号按递增顺序登记，可以不连续：之后的帧号登记后，没有登记的帧号被直接跳过
+class ReorderBuffer
+{
+public:
+    explicit ReorderBuffer(int capacity = 128);
+
+    // 登记即将提交的帧号，窗口已满时阻塞直到消费者取走队首；帧号已经交付或跳过时返回 NN_INVALID_PARAM
+    nn_error_e Expect(int id, fc_clock start);
+    // 写入结果，帧号已经被超时跳过时丢弃结果
+    void Put(FrameResult &&result);
+    // 放弃一个已登记的帧号（例如推理失败），消费者会直接跳过它
+    void Drop(int id);
+    // 取出下一帧。队首已登记但超过 timeout_ms 仍未完成时，返回 NN_TIMEOUT 并跳过该帧号，result.id 为被跳过的帧号
+    // 队首在 timeout_ms 内一直没有登记时也返回 NN_TIMEOUT，result.id 为 -1，帧号不跳过
+    nn_error_e PopNext(FrameResult &result, int timeout_ms);
+    // 唤醒所有等待者，之后 PopNext 返回 NN_STOPED
+    void Stop();
+
+    int GetCapacity() const { return (int)slots_.size(); } // 每路同时登记的帧数上限
+    uint64_t GetDroppedCount();  // Drop 的帧数
+    uint64_t GetTimeoutCount();  // 超时跳过的帧数
+    uint64_t GetSkippedCount();  // 没有登记、被之后的帧号越过的帧号数
+    uint64_t GetLateCount();     // 超时后才到达、被丢弃的结果数
+
+private:
+    enum slot_state_e
+    {
+        SLOT_EMPTY = 0, // 未登记
+        SLOT_PENDING,   // 已登记，等待结果
+        SLOT_DONE,      // 结果已写入
+        SLOT_DROPPED,   // 已放弃
+    };
+    struct Slot
+    {
+        int id = -1;
+        slot_state_e state = SLOT_EMPTY;
+        FrameResult result;
+    };
+
+    Slot &GetSlot(int id) { return slots_[id % slots_.size()]; }
+
+    std::vector<Slot> slots_;
+    int next_id_ = 0;   // 下一个要交付的帧号
+    int last_id_ = -1;  // 已登记的最大帧号
+    bool started_ = false;
+    bool stop_ = false;
+    std::mutex mtx_;
+    std::condition_variable cv_head_;  // 队首状态变化
+    std::condition_variable cv_space_; // 窗口有空位
+    uint64_t dropped_ = 0;
+    uint64_t timeout_ = 0;
+    uint64_t skipped_ = 0;
+    uint64_t late_ = 0;
+};
+
+#endif // RK3588_DEMO_REORDER_BUFFER_H
@@ -1,6 +1,11 @@
 
 #include "yolov8_thread_pool.h"
+
+#include <algorithm>
+
 #include "draw/cv_draw.h"
+#include "engine/model_registry.h"
+#include "utils/logging.h"
 // 构造函数
 ThreadPool::ThreadPool() { stop = false; }
 
@@ -8,160 +13,315 @@ ThreadPool::ThreadPool() { stop = false; }
 ThreadPool::~ThreadPool()
 {
     // stop all threads
-    stop = true;
-    cv_task.notify_all();
-    for (auto &thread : threads)
-    {
-        if (thread.joinable())
-        {
-            thread.join();
-        }
-    }
+    stopAll();
+    pipelines.clear();
 }
-// 初始化：加载模型，创建线程，参数：模型路径，线程数量
+// 初始化：加载模型，创建流水线，参数：模型路径，模型实例数量
 nn_error_e ThreadPool::startTPool(std::string &model_path, int num_threads)
 {
-    // 遍历线程数量，创建模型实例，放入vector
-    // 这些线程加载的模型是同一个
-    for (size_t i = 0; i < num_threads; ++i)
+    if (stream_num < 1)
     {
-        std::shared_ptr<Yolov8Detection> Yolov8 = std::make_shared<Yolov8Detection>();
-        Yolov8->LoadModel(model_path.c_str());
-        Yolov8_instances.push_back(Yolov8);
+        NN_LOG_ERROR("stream num %d is invalid", stream_num);
+        return NN_INVALID_PARAM;
     }
-    // 遍历线程数量，创建线程
-    for (size_t i = 0; i < num_threads; ++i)
+    // 每路视频流各自的任务队列和结果缓冲区
+    tasks.reset(new FairQueue<task_t>(stream_num, std::max(8, queue_capacity / stream_num)));
+    streams.clear();
+    for (int i = 0; i < stream_num; i++)
     {
-        threads.emplace_back(&ThreadPool::worker, this, i);
+        streams.emplace_back(new StreamState());
     }
-    return NN_SUCCESS;
-}
+    admission.reset(new AdmissionController(stream_num, admission_config));
+    // 跳过推理的 NV12 帧不经过流水线，在转换线程上转成 BGR，不占用消费者线程
+    skipped_frames.reset(new BlockingQueue<FrameResult>(std::max(8, queue_capacity)));
+    convert_thread = std::thread(&ThreadPool::convertLoop, this);
 
-// 线程函数。参数：线程id
-void ThreadPool::worker(int id)
-{
-    while (!stop)
+    // 模型文件只映射一次，各实例的推理上下文共享权重，并行创建
+    std::vector<std::shared_ptr<NNEngine>> engines;
+    auto ret = ModelRegistry::CreateContexts(model_path, num_threads, engine_creator, engines);
+    if (ret != NN_SUCCESS)
+    {
+        NN_LOG_ERROR("create %d model contexts failed, ret=%d", num_threads, ret);
+        return ret;
+    }
+    for (int i = 0; i < num_threads; ++i)
     {
-        // ID +
-        std::pair<int, std::pair<std::chrono::time_point<std::chrono::system_clock>, cv::Mat>> task;
-        std::shared_ptr<Yolov8Detection> instance = Yolov8_instances[id]; // 获取模型实例
+        std::shared_ptr<Yolov8Detection> Yolov8 = std::make_shared<Yolov8Detection>(engines[i]);
+        ret = Yolov8->InitModel();
+        if (ret != NN_SUCCESS)
         {
-            // 获取任务
-            std::unique_lock<std::mutex> lock(mtx1);
-            cv_task.wait(lock, [&]
-                         { return !tasks.empty() || stop; });
-
-            if (stop)
-            {
-                return;
-            }
-
-            task = tasks.front();
-            tasks.pop();
+            return ret;
         }
-        // 运行模型
-        std::vector<Detection> detections;
-
-        instance->Run(task.second.second, detections);
+        if (Yolov8->GetOutputMode() != output_mode)
         {
-            // 保存结果
-            std::lock_guard<std::mutex> lock(mtx2);
-
-            if (results.size() > 100)
+            // 引擎不支持该绑定方式时沿用 InitModel 选定的方式，其它错误（槽位创建失败）直接返回
+            ret = Yolov8->SetOutputMode(output_mode);
+            if (ret == NN_UNSUPPORTED)
             {
-                results.erase(results.begin());
+                NN_LOG_WARNING("model %d does not support output mode %d, use mode %d", i, output_mode, Yolov8->GetOutputMode());
             }
-            results.insert({task.first, detections});
-
-            // 只发送结果 不进行绘制
-            if (need_draw)
+            else if (ret != NN_SUCCESS)
             {
-                DrawDetections(task.second.second, detections, task.second.first, new_id, task.first);
-
-                // 防止内存爆炸 ，移除最前面的图
-                if (img_results.size() > 100)
-                {
-                    img_results.erase(img_results.begin());
-                }
-                img_results.insert({task.first, task.second});
+                NN_LOG_ERROR("model %d set output mode %d failed, ret=%d", i, output_mode, ret);
+                return ret;
             }
-
         }
+        Yolov8_instances.push_back(Yolov8);
+    }
+    // 每个实例一条三级流水线，预处理、推理、后处理在不同线程上重叠执行
+    // 批量模型在预处理阶段动态组批，批大小为 1 时不等待
+    for (int i = 0; i < num_threads; ++i)
+    {
+        std::unique_ptr<PipelineExecutor> pipeline(new PipelineExecutor(Yolov8_instances[i], kPipelineSlots, batch_wait_us));
+        ret = pipeline->Start(tasks.get(), [this](nn_error_e ret, FrameResult &&result)
+                                   { onResult(ret, std::move(result)); });
+        if (ret != NN_SUCCESS)
+        {
+            return ret;
+        }
+        pipelines.push_back(std::move(pipeline));
     }
+    return NN_SUCCESS;
 }
-// 提交任务，参数：图片，id（帧号）
-nn_error_e ThreadPool::addTask(const cv::Mat &img, int id)
+
+// 所有实例加载的是同一个模型，类别表相同
+const ClassTable &ThreadPool::getClassTable() const
 {
-    // 如果任务队列中的任务数量大于10，等待，避免内存占用过多
-    while (tasks.size() > 80)
+    static const ClassTable empty;
+    return Yolov8_instances.empty() ? empty : Yolov8_instances[0]->GetClassTable();
+}
+
+// 各路任务队列和结果缓冲区的容量，加上每条流水线的槽位（每个槽位一个批量的帧）
+// 结果缓冲区的窗口已经覆盖了排队和推理中的帧，这里直接相加，得到的是偏大的上界
+int ThreadPool::getFrameCapacity() const
+{
+    int frames = 0;
+    for (size_t i = 0; i < streams.size(); i++)
+    {
+        frames += (tasks != nullptr ? (int)tasks->capacity((int)i) : 0) + streams[i]->results.GetCapacity();
+    }
+    for (const auto &instance : Yolov8_instances)
     {
-        printf("\n---------------------------------- 任务数量过多 等待中----------------------\n");
+        frames += kPipelineSlots * instance->GetBatchSize();
+    }
+    return frames;
+}
 
-        // sleep 1ms
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+// 后处理完成的回调，在流水线的后处理线程上执行
+void ThreadPool::onResult(nn_error_e ret, FrameResult &&result)
+{
+    StreamState &stream = *streams[result.stream_id];
+    if (ret != NN_SUCCESS)
+    {
+        // 推理失败，让消费者跳过这一帧
+        stream.results.Drop(result.id);
+        return;
     }
+    render(result, stream);
 
+    // 保存结果，由该路的重排缓冲区按帧号顺序交给消费者
+    stream.results.Put(std::move(result));
+}
+// 消费者（编码器）只接受 BGR，NV12 结果不管是否绘制都要转换；只发送结果时不进行绘制
+void ThreadPool::render(FrameResult &result, StreamState &stream)
+{
+    convertToBGR(result);
+    if (!need_draw)
     {
-        // 保存任务
-        std::lock_guard<std::mutex> lock(mtx1);
-        tasks.push({id, {std::chrono::system_clock::now(), img}});
+        return;
     }
-    cv_task.notify_one();
-    return NN_SUCCESS;
+    DrawDetections(result.img, result.objects, getClassTable(), result.start, stream.new_id.load(), result.id);
 }
 
-// 获取结果，参数：检测框，id（帧号）
-nn_error_e ThreadPool::getTargetResult(std::vector<Detection> &objects, int id)
+void ThreadPool::convertToBGR(FrameResult &result)
 {
+    // 单通道图像是 NV12
+    if (result.img.type() == CV_8UC1)
+    {
+        cv::Mat bgr;
+        bgr.allocator = frame_allocator;
+        cv::cvtColor(result.img, bgr, cv::COLOR_YUV2BGR_NV12);
+        result.img = bgr;
+    }
+}
 
-    int loop_cnt = 0;
-    // 如果没有结果，等待
-    while (results.find(id) == results.end())
+// 跳过推理的帧只需要转换，检测框要等到按帧号顺序交付时才知道，在 pop_next 中绘制
+// 一帧 1080p 的转换在 1 到 2 毫秒左右，一个线程足够所有视频流使用；退出前转换完已入队的帧
+void ThreadPool::convertLoop()
+{
+    FrameResult result;
+    while (skipped_frames->pop(result))
     {
-        // sleep 1ms
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        convertToBGR(result);
+        int stream = result.stream_id;
+        streams[stream]->results.Put(std::move(result));
+    }
+}
 
-        loop_cnt++;
-        if (loop_cnt > 1000)
-        {
-            NN_LOG_ERROR("getTargetResult timeout");
-            return NN_TIMEOUT;
-        }
+// 提交任务，参数：图片，id（帧号），stream（视频流编号）
+nn_error_e ThreadPool::addTask(const cv::Mat &img, int id, int stream)
+{
+    if (tasks == nullptr)
+    {
+        NN_LOG_ERROR("thread pool is not started");
+        return NN_STOPED;
+    }
+    if (stream < 0 || stream >= (int)streams.size())
+    {
+        NN_LOG_ERROR("stream %d out of range [0, %ld)", stream, streams.size());
+        return NN_INVALID_PARAM;
+    }
+    StreamState &state = *streams[stream];
+    auto now = std::chrono::steady_clock::now();
+    // 先登记帧号，结果窗口已满时在这里等待该路的消费者
+    auto ret = state.results.Expect(id, now);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
     }
-    std::lock_guard<std::mutex> lock(mtx2);
-    objects = results[id];
-    // remove from map
-    results.erase(id);
+    state.new_id = id + 1;
+    task_t task;
+    task.id = id;
+    task.stream = stream;
+    task.start = now;
+    task.img = img;
+    // 该路队列满时按 overflow_policy 处理，被挤掉或丢弃的帧号通知结果缓冲区跳过
+    bool ok = tasks->push(stream, std::move(task), overflow_policy, [this](task_t &evicted)
+                          { streams[evicted.stream]->results.Drop(evicted.id); });
+    if (!ok)
+    {
+        state.results.Drop(id);
+        return tasks->is_exit() ? NN_STOPED : NN_QUEUE_FULL;
+    }
+    return NN_SUCCESS;
+}
 
+// 提交 NV12 任务，参数：紧凑的 NV12 单通道图（高度为 height * 3 / 2），id（帧号），stream（视频流编号）
+nn_error_e ThreadPool::addNV12Task(const cv::Mat &nv12, int id, int stream)
+{
+    if (nv12.type() != CV_8UC1)
+    {
+        NN_LOG_ERROR("nv12 task has to be 1 channel uint8");
+        return NN_RKNN_INPUT_ATTR_ERROR;
+    }
+    return addTask(nv12, id, stream);
+}
+
+// 经准入控制提交，参数：图片（BGR 或 NV12），id（帧号），stream（视频流编号）
+// 跳过推理的帧不进任务队列，登记到该路的结果缓冲区，和推理帧一起按帧号顺序交付，检测框在 pop_next 中补上
+// NV12 帧先交给转换线程转成 BGR 再放入结果缓冲区
+nn_error_e ThreadPool::submitFrame(const cv::Mat &img, int id, int stream)
+{
+    if (tasks == nullptr)
+    {
+        NN_LOG_ERROR("thread pool is not started");
+        return NN_STOPED;
+    }
+    if (stream < 0 || stream >= (int)streams.size())
+    {
+        NN_LOG_ERROR("stream %d out of range [0, %ld)", stream, streams.size());
+        return NN_INVALID_PARAM;
+    }
+    if (admission->Admit(stream, tasks->size(stream), tasks->capacity(stream)))
+    {
+        return addTask(img, id, stream);
+    }
+    StreamState &state = *streams[stream];
+    auto now = std::chrono::steady_clock::now();
+    auto ret = state.results.Expect(id, now);
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    state.new_id = id + 1;
+    FrameResult result;
+    result.id = id;
+    result.stream_id = stream;
+    result.start = now;
+    result.img = img;
+    result.skipped = true;
+    if (img.type() != CV_8UC1)
+    {
+        state.results.Put(std::move(result));
+        return NN_SUCCESS;
+    }
+    if (!skipped_frames->push(std::move(result)))
+    {
+        state.results.Drop(id);
+        return NN_STOPED;
+    }
     return NN_SUCCESS;
 }
 
-// 获取结果（图片），参数：图片，id（帧号）
-nn_error_e ThreadPool::getTargetImgResult(cv::Mat &img, int id)
+bool ThreadPool::getAdmissionStats(int stream, AdmissionStats &stats)
 {
-    int loop_cnt = 0;
-    // 如果没有结果，等待
-    while (img_results.find(id) == img_results.end())
-    {
-        // 等待 5ms x 1000 = 5s
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
-        loop_cnt++;
-        if (loop_cnt > 1000)
+    if (admission == nullptr || stream < 0 || stream >= (int)streams.size())
+    {
+        return false;
+    }
+    stats = admission->GetStats(stream);
+    return true;
+}
+
+// 获取该路下一帧结果，参数：结果，超时时间（从提交时开始计算），stream（视频流编号）
+// 返回 NN_TIMEOUT 时 result.id 为被跳过的帧号（-1 表示这段时间内该路没有提交新帧），返回 NN_STOPED 表示线程池已停止
+nn_error_e ThreadPool::pop_next(FrameResult &result, int timeout_ms, int stream)
+{
+    if (stream < 0 || stream >= (int)streams.size())
+    {
+        return tasks == nullptr ? NN_STOPED : NN_INVALID_PARAM;
+    }
+    StreamState &state = *streams[stream];
+    auto ret = state.results.PopNext(result, timeout_ms);
+    if (ret == NN_TIMEOUT && result.id >= 0)
+    {
+        NN_LOG_ERROR("pop_next stream %d timeout, frame %d skipped", stream, result.id);
+    }
+    if (ret != NN_SUCCESS)
+    {
+        return ret;
+    }
+    // 交付延迟在绘制之前记录，不把消费者线程上的绘制计入准入控制的延迟
+    if (admission != nullptr)
+    {
+        double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - result.start).count();
+        admission->OnDelivered(stream, latency, !result.skipped);
+    }
+    // 按帧号顺序交付，跳过推理的帧沿用它之前最近一次推理的检测框，图像已在转换线程上转成 BGR
+    if (result.skipped)
+    {
+        result.objects = state.last_objects;
+        if (need_draw)
         {
-            NN_LOG_ERROR("getTargetImgResult timeout");
-            return NN_TIMEOUT;
+            render(result, state);
         }
     }
-    std::lock_guard<std::mutex> lock(mtx2);
-    img = img_results[id].second;
-    // remove from map
-    img_results.erase(id);
-
-    return NN_SUCCESS;
+    else
+    {
+        state.last_objects = result.objects;
+    }
+    return ret;
 }
 // 停止所有线程
 void ThreadPool::stopAll()
 {
+    std::lock_guard<std::mutex> lock(stop_mtx);
     stop = true;
-    cv_task.notify_all();
+    // 任务队列退出后，各流水线处理完已取出的帧自行结束
+    if (tasks != nullptr)
+    {
+        tasks->exit();
+    }
+    for (auto &stream : streams)
+    {
+        stream->results.Stop();
+    }
+    if (skipped_frames != nullptr)
+    {
+        skipped_frames->exit();
+    }
+    if (convert_thread.joinable())
+    {
+        convert_thread.join();
+    }
 }
\ No newline at end of file
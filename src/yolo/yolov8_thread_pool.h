@@ -17,37 +17,65 @@
 
 #include <condition_variable>
 #include "types/video_infos_type.h"
+#include "utils/blocking_queue.h"
+#include "utils/fair_queue.h"
+#include "reorder_buffer.h"
+#include "admission_controller.h"
+#include "pipeline_executor.h"
 
+#include <functional>
 
-typedef std::chrono::time_point<std::chrono::system_clock> fc_clock;
-
+// 多路视频流共用一组模型实例：每路有自己的帧号序列、任务队列和结果缓冲区
+// 任务队列按路轮流取出，一路过快只会阻塞或丢弃自己的帧；结果按路分别按帧号顺序交付
 class ThreadPool
 {
 private:
-    // 帧ID  + 时间 + mat
-    std::queue<std::pair<int, std::pair<std::chrono::time_point<std::chrono::system_clock> ,cv::Mat>>> tasks;             // <id, img>用来存放任务
+    typedef pipeline_task_t task_t;
+    static const int kPipelineSlots = 3; // 每条流水线的槽位数
+    // 每路视频流的状态
+    struct StreamState
+    {
+        ReorderBuffer results;       // 按帧号排序的结果（图片 + 检测框）
+        std::atomic<int> new_id{0};  // 最新提交的帧号 + 1，绘制时显示排队帧数
+        DetectionList last_objects;  // 最近一次推理的检测框，只在该路的消费者线程上使用
+    };
+    std::unique_ptr<FairQueue<task_t>> tasks;              // 每路一个有界队列，startTPool 时创建
     std::vector<std::shared_ptr<Yolov8Detection>> Yolov8_instances; // 模型实例
-    std::map<int, std::vector<Detection>> results;         // <id, objects>用来存放结果（检测框）
-    std::map<int, std::pair<std::chrono::time_point<std::chrono::system_clock> ,cv::Mat>> img_results;                    // <id, img>用来存放结果（图片）
-    std::vector<std::thread> threads;                      // 线程池
-    std::mutex mtx1;
-    std::mutex mtx2;
-    std::condition_variable cv_task;
+    std::vector<std::unique_ptr<StreamState>> streams;     // 每路视频流一个
+    std::vector<std::unique_ptr<PipelineExecutor>> pipelines; // 每个模型实例一条流水线
+    std::unique_ptr<AdmissionController> admission;         // 准入控制，startTPool 时创建
+    std::unique_ptr<BlockingQueue<FrameResult>> skipped_frames; // 跳过推理的 NV12 帧，由转换线程转成 BGR 后放入结果缓冲区
+    std::thread convert_thread;                             // 转换跳过推理的 NV12 帧，stopAll 时退出
+    std::mutex stop_mtx;                                    // stopAll 可能同时在结果线程和主线程上调用
     bool stop;
-    
-    void worker(int id);
+
+    void onResult(nn_error_e ret, FrameResult &&result);   // 流水线后处理线程的回调
+    void render(FrameResult &result, StreamState &stream); // NV12 转成 BGR，需要绘制时绘制检测框
+    void convertToBGR(FrameResult &result);                // NV12 转成 BGR，BGR 图像不变
+    void convertLoop();                                    // 转换线程
 
 public:
     ThreadPool();  // 构造函数
     ~ThreadPool(); // 析构函数
 
-    nn_error_e startTPool(std::string &model_path, int num_threads = 12);     // 初始化
-    nn_error_e addTask(const cv::Mat &img, int id);                   // 提交任务
-    nn_error_e getTargetResult(std::vector<Detection> &objects, int id); // 获取结果（检测框）
-    nn_error_e getTargetImgResult(cv::Mat &img, int id);   
-    bool need_draw = false;              // 获取结果（图片）
-    void stopAll();    
-    int new_id = 0;                                                  // 停止所有线程
+    nn_error_e startTPool(std::string &model_path, int num_threads = 12);     // 初始化，num_threads 为模型实例（流水线）数量
+    nn_error_e addTask(const cv::Mat &img, int id, int stream = 0);   // 提交任务，id 为该路视频流的帧号
+    nn_error_e addNV12Task(const cv::Mat &nv12, int id, int stream = 0); // 提交 NV12 任务，结果交给消费者之前转成 BGR
+    nn_error_e submitFrame(const cv::Mat &img, int id, int stream = 0); // 经准入控制提交（BGR 或 NV12），跳过推理的帧直接按序交付
+    nn_error_e pop_next(FrameResult &result, int timeout_ms = 5000, int stream = 0); // 按帧号顺序获取该路下一帧结果（图片 + 检测框）
+    bool getAdmissionStats(int stream, AdmissionStats &stats);        // 该路的推理间隔、延迟分位数和跳帧计数
+    const ClassTable &getClassTable() const;                          // 模型的类别名称和颜色，startTPool 之后有效
+    int getFrameCapacity() const;                                     // 线程池内最多同时持有的帧数（任务队列 + 结果缓冲区 + 流水线槽位），startTPool 之后有效
+    bool need_draw = false;              // 是否在结果图片上绘制检测框
+    queue_overflow_e overflow_policy = QUEUE_OVERFLOW_BLOCK; // 任务队列满时的策略
+    nn_output_mode_e output_mode = NN_OUTPUT_PREALLOC;       // 输出张量绑定方式，引擎不支持时退回拷贝
+    int batch_wait_us = 2000;            // 批量模型凑批的最长等待时间（微秒），多路视频流的帧合并为一次推理
+    int stream_num = 1;                  // 视频流数量，startTPool 之前设置
+    int queue_capacity = 64;             // 任务队列总容量，平分给每路视频流（每路至少 8）
+    AdmissionConfig admission_config;    // submitFrame 的准入控制参数，startTPool 之前设置
+    cv::MatAllocator *frame_allocator = nullptr; // NV12 转 BGR 时使用的帧内存池，为空时使用默认分配
+    std::function<std::shared_ptr<NNEngine>()> engine_creator; // 创建推理引擎，为空时使用 RKNN，可替换为 CPU 或 mock 引擎；不支持 Duplicate 的引擎各自加载同一个映射
+    void stopAll();                                                   // 停止所有线程
 };
 
 #endif // RK3588_DEMO_Yolov8_THREAD_POOL_H
@@ -0,0 +1,136 @@
+# 生成 cv_dnn_test 用的合成模型和期望值：python3 make_models.py [输出目录，默认为脚本所在目录]
+# 模型与 RKNN 导出的 YOLOv8 检测头结构相同：输入 1x3x320x320 RGB（模型内不归一化之外的处理），
+# 每个检测头（stride 8/16/32）输出 4 通道回归（图内做 DFL 期望）和类别 logit，权重为固定种子的随机数
+#   yolov8_head_c4.onnx  4 个类别，输出声明顺序打乱（小特征图在前，类别在回归前），回归和类别通道数相同
+#   yolov8_head_c80.onnx 80 个类别，按 (回归, 类别) 成对、特征图从大到小声明
+# expected.txt 为 onnxruntime 在测试图像上的结果：每个输出（按 (回归, 类别) 排序后）的形状、总和和抽样值，
+# 以及按后处理的规则（sigmoid、门限 0.35、类别无关 NMS IOU 0.15）解码出的检测框
+# 依赖 numpy、onnx、onnxruntime
+
+import os
+import sys
+
+import numpy as np
+import onnx
+import onnxruntime as ort
+from onnx import TensorProto, helper, numpy_helper
+
+SIZE = 320
+STRIDES = (8, 16, 32)
+OBJ_THRESH = 0.35
+NMS_THRESH = 0.15
+
+
+def make_model(class_num, shuffled, seed):
+    rng = np.random.default_rng(seed)
+    nodes, inits, heads = [], [], []
+
+    def init(name, arr, dtype=np.float32):
+        inits.append(numpy_helper.from_array(np.asarray(arr).astype(dtype), name))
+
+    init("axis2", [2], np.int64)
+    for s in STRIDES:
+        h = SIZE // s
+        nodes.append(helper.make_node("AveragePool", ["images"], [f"p{s}"], kernel_shape=[s, s], strides=[s, s]))
+        # 回归：64 通道 = 4 条边 x 16 个 bin，softmax 后乘以 bin 编号求和，即 DFL 期望，取值 [0, 15]
+        init(f"w_dfl{s}", rng.normal(0, 2, (64, 3, 1, 1)))
+        init(f"b_dfl{s}", rng.normal(0, 1, 64))
+        nodes.append(helper.make_node("Conv", [f"p{s}", f"w_dfl{s}", f"b_dfl{s}"], [f"dfl{s}"], kernel_shape=[1, 1]))
+        init(f"shape_dfl{s}", [1, 4, 16, h * h], np.int64)
+        nodes.append(helper.make_node("Reshape", [f"dfl{s}", f"shape_dfl{s}"], [f"bins{s}"]))
+        nodes.append(helper.make_node("Softmax", [f"bins{s}"], [f"prob{s}"], axis=2))
+        init(f"proj{s}", np.arange(16).reshape(1, 1, 16, 1))
+        nodes.append(helper.make_node("Mul", [f"prob{s}", f"proj{s}"], [f"weighted{s}"]))
+        nodes.append(helper.make_node("ReduceSum", [f"weighted{s}", "axis2"], [f"dist{s}"], keepdims=0))
+        init(f"shape_reg{s}", [1, 4, h, h], np.int64)
+        nodes.append(helper.make_node("Reshape", [f"dist{s}", f"shape_reg{s}"], [f"reg{s}"]))
+        # 类别：偏置为负，大部分格子的分数很低
+        init(f"w_cls{s}", rng.normal(0, 3, (class_num, 3, 1, 1)))
+        init(f"b_cls{s}", np.full(class_num, -6.0))
+        nodes.append(helper.make_node("Conv", [f"p{s}", f"w_cls{s}", f"b_cls{s}"], [f"cls{s}"], kernel_shape=[1, 1]))
+        heads.append((f"reg{s}", 4, h))
+        heads.append((f"cls{s}", class_num, h))
+
+    declared = heads[::-1] if shuffled else heads
+    outputs = [helper.make_tensor_value_info(n, TensorProto.FLOAT, [1, c, h, h]) for n, c, h in declared]
+    graph = helper.make_graph(nodes, "yolov8_head",
+                              [helper.make_tensor_value_info("images", TensorProto.FLOAT, [1, 3, SIZE, SIZE])],
+                              outputs, inits)
+    model = helper.make_model(graph, opset_imports=[helper.make_opsetid("", 13)])
+    model.ir_version = 8
+    onnx.checker.check_model(model)
+    return model, [n for n, _, _ in heads]
+
+
+def test_image():
+    # 与 cv_dnn_test.cpp 的 TestImage 相同：16x16 的色块，BGR
+    y, x = np.mgrid[0:SIZE, 0:SIZE]
+    bx, by = x // 16, y // 16
+    b = (bx * 37 + by * 91 + 13) % 256
+    g = (bx * 53 + by * 29 + 101) % 256
+    r = (bx * 17 + by * 73 + 199) % 256
+    return np.stack([b, g, r], axis=2).astype(np.uint8)
+
+
+def iou(a, b):
+    w = min(a[2], b[2]) - max(a[0], b[0])
+    h = min(a[3], b[3]) - max(a[1], b[1])
+    if w <= 0 or h <= 0:
+        return 0.0
+    inter = w * h
+    return inter / ((a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter)
+
+
+def decode(blobs):
+    boxes = []
+    for i, s in enumerate(STRIDES):
+        reg, cls = blobs[i * 2][0], blobs[i * 2 + 1][0]
+        h = reg.shape[1]
+        score = 1 / (1 + np.exp(-cls.astype(np.float64)))
+        for gy in range(h):
+            for gx in range(h):
+                c = int(np.argmax(score[:, gy, gx]))
+                sc = score[c, gy, gx]
+                if sc <= OBJ_THRESH:
+                    continue
+                d = reg[:, gy, gx]
+                box = [(gx + 0.5 - d[0]) * s, (gy + 0.5 - d[1]) * s, (gx + 0.5 + d[2]) * s, (gy + 0.5 + d[3]) * s]
+                box = [max(box[0], 0), max(box[1], 0), min(box[2], SIZE), min(box[3], SIZE)]
+                boxes.append((float(sc), c, box))
+    boxes.sort(key=lambda b: -b[0])
+    keep = []
+    for b in boxes:
+        if all(iou(b[2], k[2]) <= NMS_THRESH for k in keep):
+            keep.append(b)
+    return keep
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    bgr = test_image()
+    blob = bgr[:, :, ::-1].transpose(2, 0, 1)[None].astype(np.float32) / 255
+    lines = []
+    for file, class_num, shuffled, seed in (("yolov8_head_c4.onnx", 4, True, 4), ("yolov8_head_c80.onnx", 80, False, 80)):
+        model, order = make_model(class_num, shuffled, seed)
+        path = os.path.join(out_dir, file)
+        onnx.save(model, path)
+        sess = ort.InferenceSession(path, providers=["CPUExecutionProvider"])
+        result = dict(zip([o.name for o in sess.get_outputs()], sess.run(None, {"images": blob})))
+        blobs = [result[n] for n in order]
+        dets = decode(blobs)
+        lines.append(f"model {file} {class_num} {len(blobs)} {len(dets)}")
+        rng = np.random.default_rng(class_num)
+        for b in blobs:
+            flat = b.reshape(-1)
+            idx = sorted(rng.choice(flat.size, 8, replace=False))
+            samples = " ".join(f"{k} {flat[k]:.6f}" for k in idx)
+            lines.append(f"out {b.shape[1]} {b.shape[2]} {b.shape[3]} {float(flat.astype(np.float64).sum()):.4f} 8 {samples}")
+        for sc, c, box in dets:
+            lines.append(f"det {c} {sc:.6f} {box[0]:.3f} {box[1]:.3f} {box[2]:.3f} {box[3]:.3f}")
+        print(f"{file}: {len(dets)} detections")
+    with open(os.path.join(out_dir, "expected.txt"), "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,386 @@
+// FEC 回环测试：与 StreamManager 的 RTP + FEC 收发路径相同，在回环地址上注入随机丢包和突发丢包
+//   发送：RtpH264Packetizer -> PacketManager -> UdpFecEncoder -> 丢包 -> UDPSender（GSO）
+//   接收：recvmmsg -> UdpFecDecoder -> RtpH264Depacketizer -> 逐字节核对整帧
+// 每种丢包下分别不加 FEC、4x4、8x8 运行，报告剩余的帧丢失率和相对于无丢包无 FEC 的附加延迟
+// 失败条件：交出了内容错误的帧；无丢包时丢帧；有丢包时 FEC 没有降低帧丢失率；延迟超过预算 + kLatencySlackMs
+//
+// 用法：fec_loopback_test [帧数，默认 500] [帧间隔微秒，默认 2000]
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "io/CircularQueue.h"
+#include "io/rtp_h264.h"
+#include "io/udp.h"
+#include "io/udp_fec.h"
+
+static const size_t kPacketSize = 1470;
+static const int kLatencyBudgetMs = 50;
+static const int kLatencySlackMs = 30; // 回环上调度、poll 间隔带来的余量
+
+// 丢包模型：独立随机丢包，加上 Gilbert-Elliott 两状态的突发丢包（坏状态下全部丢弃）
+struct LossModel
+{
+    const char *name;
+    double random;  // 每个包的随机丢包率
+    double to_bad;  // 好状态进入坏状态的概率
+    double to_good; // 坏状态回到好状态的概率，平均突发长度为 1 / to_good
+};
+
+class LossInjector
+{
+public:
+    explicit LossInjector(const LossModel &model) : model_(model), rng_(20240611) {}
+
+    bool Drop()
+    {
+        std::uniform_real_distribution<double> u(0, 1);
+        if (model_.to_bad > 0)
+        {
+            bad_ = bad_ ? u(rng_) >= model_.to_good : u(rng_) < model_.to_bad;
+        }
+        return bad_ || (model_.random > 0 && u(rng_) < model_.random);
+    }
+
+private:
+    LossModel model_;
+    std::mt19937 rng_;
+    bool bad_ = false;
+};
+
+// 模拟的编码帧：每 30 帧一个 90 KB 的关键帧，其余 3 ~ 33 KB；负载不含 0，不会出现起始码
+static void MakeFrame(int index, std::vector<uint8_t> &frame)
+{
+    std::mt19937 rng(index * 7919 + 1);
+    size_t len = index % 30 == 0 ? 90000 : 3000 + rng() % 30000;
+    frame.assign(len, 0);
+    frame[3] = 1;
+    frame[4] = index % 30 == 0 ? 0x65 : 0x41;
+    for (size_t i = 5; i < len; i++)
+    {
+        frame[i] = (uint8_t)(1 + rng() % 255);
+    }
+}
+
+static double Percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+    {
+        return 0;
+    }
+    size_t k = std::min(v.size() - 1, (size_t)(v.size() * p / 100.0));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+struct RunResult
+{
+    double packet_loss = 0; // 注入的丢包率（含校验包）
+    double overhead = 0;    // 校验包 / 数据包
+    double frame_loss = 0;  // 没有完整交出的帧的比例
+    int corrupt = 0;        // 内容错误的帧
+    double p50_ms = 0;
+    double p99_ms = 0;
+    double max_ms = 0;
+};
+
+// 接收端：recvmmsg 收包交给 FEC 解码器或直接交给解包器，没有包时调用 Poll 检查超时
+class LoopbackReceiver
+{
+public:
+    explicit LoopbackReceiver(std::function<void(const uint8_t *, size_t)> on_packet, std::function<void()> on_idle)
+        : on_packet_(on_packet), on_idle_(on_idle)
+    {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        int rcvbuf = 8 * 1024 * 1024;
+        if (setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0)
+        {
+            setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        }
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd_, (struct sockaddr *)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, (struct sockaddr *)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread(&LoopbackReceiver::Loop, this);
+    }
+
+    ~LoopbackReceiver()
+    {
+        stop_ = true;
+        thread_.join();
+        close(fd_);
+    }
+
+    int GetPort() const { return port_; }
+
+private:
+    void Loop()
+    {
+        const int batch = 64;
+        std::vector<char> ring(batch * 2048);
+        std::vector<struct iovec> iovs(batch);
+        std::vector<struct mmsghdr> msgs(batch);
+        for (int i = 0; i < batch; i++)
+        {
+            iovs[i].iov_base = ring.data() + i * 2048;
+            iovs[i].iov_len = 2048;
+        }
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        while (!stop_)
+        {
+            if (poll(&pfd, 1, 5) <= 0)
+            {
+                on_idle_();
+                continue;
+            }
+            for (int i = 0; i < batch; i++)
+            {
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int got = recvmmsg(fd_, msgs.data(), batch, MSG_DONTWAIT, nullptr);
+            for (int i = 0; i < got; i++)
+            {
+                on_packet_((const uint8_t *)iovs[i].iov_base, msgs[i].msg_len);
+            }
+        }
+    }
+
+    std::function<void(const uint8_t *, size_t)> on_packet_;
+    std::function<void()> on_idle_;
+    int fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+static RunResult Run(const LossModel &loss_model, int rows, int cols, int frames, int interval_us)
+{
+    using std::chrono::steady_clock;
+    bool fec = rows > 0 && cols > 0;
+    size_t payload_size = fec ? kPacketSize - kFecHeaderSize : kPacketSize;
+
+    // 接收端
+    std::mutex mtx;
+    std::vector<steady_clock::time_point> sent_at(frames);
+    std::vector<double> latency_ms;
+    int intact = 0, corrupt = 0;
+    std::vector<uint8_t> expect;
+    RtpH264Depacketizer depacketizer([&](const uint8_t *data, size_t len, uint32_t timestamp)
+                                     {
+        auto now = steady_clock::now();
+        int index = (int)(timestamp / 3000);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (index >= frames)
+        {
+            corrupt++;
+            return;
+        }
+        MakeFrame(index, expect);
+        if (len == expect.size() && memcmp(data, expect.data(), len) == 0)
+        {
+            intact++;
+            latency_ms.push_back(std::chrono::duration<double, std::milli>(now - sent_at[index]).count());
+        }
+        else
+        {
+            corrupt++;
+        } });
+    std::unique_ptr<UdpFecDecoder> decoder;
+    if (fec)
+    {
+        decoder.reset(new UdpFecDecoder([&](const uint8_t *data, size_t len)
+                                        { depacketizer.Input(data, len); },
+                                        kLatencyBudgetMs));
+    }
+    LoopbackReceiver receiver([&](const uint8_t *data, size_t len)
+                              {
+        if (decoder)
+        {
+            decoder->Input(data, len);
+        }
+        else
+        {
+            depacketizer.Input(data, len);
+        } },
+                              [&]
+                              {
+        if (decoder)
+        {
+            decoder->Poll();
+        } });
+
+    // 发送端：与 StreamManager::PublishLoop 相同，每帧一次 send_batch，丢弃的包不发送
+    PacketManager packets(1024 * 1024, payload_size, fec ? kFecHeaderSize : 0);
+    RtpH264Packetizer packetizer(payload_size, 0x12345678);
+    UDPSender sender("127.0.0.1", receiver.GetPort());
+    sender.set_send_mode(UDP_SEND_GSO, kPacketSize);
+    UdpFecEncoder encoder(fec ? rows : 1, fec ? cols : 1, payload_size);
+    LossInjector loss(loss_model);
+    uint64_t datagrams = 0, dropped = 0;
+    std::thread publisher([&]
+                          {
+        std::vector<PacketManager::PacketView> frame;
+        std::vector<struct iovec> chunks, kept;
+        int done = 0;
+        while (done < frames)
+        {
+            packets.GetNextFramePackets(frame);
+            if (frame.empty())
+            {
+                continue;
+            }
+            chunks.clear();
+            if (fec)
+            {
+                encoder.BeginBatch();
+                for (const auto &view : frame)
+                {
+                    encoder.Protect(packets.MutableData(view), view.len - kFecHeaderSize, view.frameEnd, chunks);
+                }
+            }
+            else
+            {
+                for (const auto &view : frame)
+                {
+                    chunks.push_back(iovec{const_cast<char *>(packets.Data(view)), view.len});
+                }
+            }
+            kept.clear();
+            for (const auto &chunk : chunks)
+            {
+                datagrams++;
+                if (loss.Drop())
+                {
+                    dropped++;
+                }
+                else
+                {
+                    kept.push_back(chunk);
+                }
+            }
+            if (!kept.empty())
+            {
+                sender.send_batch(kept.data(), kept.size());
+            }
+            packets.Release(frame.back());
+            if (frame.back().frameEnd)
+            {
+                done++;
+            }
+        } });
+
+    std::vector<uint8_t> data;
+    auto start = steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        MakeFrame(i, data);
+        std::this_thread::sleep_until(start + std::chrono::microseconds((int64_t)i * interval_us));
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            sent_at[i] = steady_clock::now();
+        }
+        packetizer.Packetize(data.data(), data.size(), (uint32_t)i * 3000,
+                             [&](const uint8_t *head, size_t head_len, const uint8_t *payload, size_t len, bool last)
+                             { packets.AddPacket(head, head_len, payload, len, last); });
+    }
+    publisher.join();
+    // 等最后几帧超时交出
+    std::this_thread::sleep_for(std::chrono::milliseconds(kLatencyBudgetMs * 3));
+
+    // 加锁读取结果，返回时先解锁再停止接收线程
+    RunResult result;
+    std::lock_guard<std::mutex> lock(mtx);
+    result.packet_loss = datagrams ? (double)dropped / datagrams : 0;
+    result.overhead = fec && encoder.GetDataPackets() ? (double)encoder.GetParityPackets() / encoder.GetDataPackets() : 0;
+    result.frame_loss = (double)(frames - intact) / frames;
+    result.corrupt = corrupt;
+    result.p50_ms = Percentile(latency_ms, 50);
+    result.p99_ms = Percentile(latency_ms, 99);
+    result.max_ms = latency_ms.empty() ? 0 : *std::max_element(latency_ms.begin(), latency_ms.end());
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 500;
+    int interval_us = argc > 2 ? atoi(argv[2]) : 2000;
+    const LossModel models[] = {
+        {"无丢包", 0, 0, 0},
+        {"随机 1%", 0.01, 0, 0},
+        {"随机 5%", 0.05, 0, 0},
+        {"突发 平均 3.3 个", 0, 0.005, 0.3},
+        {"突发 平均 5 个", 0, 0.01, 0.2},
+    };
+    const int configs[][2] = {{0, 0}, {4, 4}, {8, 8}};
+    printf("%d 帧，帧间隔 %d us，FEC 延迟预算 %d ms\n\n", frames, interval_us, kLatencyBudgetMs);
+
+    int failed = 0;
+    double base_p50 = 0, base_p99 = 0;
+    for (const auto &model : models)
+    {
+        double no_fec_frame_loss = 0;
+        for (const auto &config : configs)
+        {
+            RunResult r = Run(model, config[0], config[1], frames, interval_us);
+            bool fec = config[0] > 0;
+            if (!fec && model.random == 0 && model.to_bad == 0)
+            {
+                base_p50 = r.p50_ms;
+                base_p99 = r.p99_ms;
+            }
+            char name[32];
+            snprintf(name, sizeof(name), fec ? "%dx%d" : "无 FEC", config[0], config[1]);
+            printf("%-18s %-8s 丢包 %5.2f%%  开销 %5.1f%%  帧丢失 %6.2f%%  附加延迟 p50 %+6.2f ms  p99 %+6.2f ms  最大 %6.2f ms\n",
+                   model.name, name, r.packet_loss * 100, r.overhead * 100, r.frame_loss * 100, r.p50_ms - base_p50,
+                   r.p99_ms - base_p99, r.max_ms);
+
+            bool lossy = model.random > 0 || model.to_bad > 0;
+            if (r.corrupt > 0)
+            {
+                printf("FAIL %d 帧内容错误\n", r.corrupt);
+                failed++;
+            }
+            if (!lossy && r.frame_loss > 0)
+            {
+                printf("FAIL 无丢包时丢帧\n");
+                failed++;
+            }
+            if (!fec)
+            {
+                no_fec_frame_loss = r.frame_loss;
+            }
+            else if (lossy && r.frame_loss >= no_fec_frame_loss)
+            {
+                printf("FAIL FEC 没有降低帧丢失率\n");
+                failed++;
+            }
+            if (fec && r.p99_ms > base_p99 + kLatencyBudgetMs + kLatencySlackMs)
+            {
+                printf("FAIL p99 延迟超过预算\n");
+                failed++;
+            }
+        }
+    }
+    if (failed > 0)
+    {
+        printf("\n%d 项失败\n", failed);
+        return 1;
+    }
+    printf("\n全部通过\n");
+    return 0;
+}
@@ -0,0 +1,262 @@
+// NMS 回归测试：网格实现和两两比较实现的保留结果必须与原始实现（后处理中的两两比较循环）完全一致
+// 原始实现按分数用 std::sort 排序，分数相同的框顺序不确定，所以与原始实现比较时分数互不相同；
+// 两种实现之间另外比较分数相同、区分类别、限制保留数量的情况
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "process/nms.h"
+
+namespace reference
+{
+#define ZQ_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ZQ_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+    // 以下为原始实现，只增加了记录下标的 index
+    typedef struct
+    {
+        float xmin;
+        float ymin;
+        float xmax;
+        float ymax;
+        float score;
+        int classId;
+        int index;
+    } DetectRect;
+
+    static inline float IOU(float XMin1, float YMin1, float XMax1, float YMax1, float XMin2, float YMin2, float XMax2, float YMax2)
+    {
+        float Inter = 0;
+        float Total = 0;
+        float XMin = 0;
+        float YMin = 0;
+        float XMax = 0;
+        float YMax = 0;
+        float Area1 = 0;
+        float Area2 = 0;
+        float InterWidth = 0;
+        float InterHeight = 0;
+
+        XMin = ZQ_MAX(XMin1, XMin2);
+        YMin = ZQ_MAX(YMin1, YMin2);
+        XMax = ZQ_MIN(XMax1, XMax2);
+        YMax = ZQ_MIN(YMax1, YMax2);
+
+        InterWidth = XMax - XMin;
+        InterHeight = YMax - YMin;
+
+        InterWidth = (InterWidth >= 0) ? InterWidth : 0;
+        InterHeight = (InterHeight >= 0) ? InterHeight : 0;
+
+        Inter = InterWidth * InterHeight;
+
+        Area1 = (XMax1 - XMin1) * (YMax1 - YMin1);
+        Area2 = (XMax2 - XMin2) * (YMax2 - YMin2);
+
+        Total = Area1 + Area2 - Inter;
+
+        return float(Inter) / float(Total);
+    }
+
+    static std::vector<int> Nms(const yolo::NmsBoxes &boxes, float nmsThreshold)
+    {
+        std::vector<DetectRect> detectRects;
+        for (size_t i = 0; i < boxes.size(); i++)
+        {
+            DetectRect temp;
+            temp.xmin = boxes.xmin[i];
+            temp.ymin = boxes.ymin[i];
+            temp.xmax = boxes.xmax[i];
+            temp.ymax = boxes.ymax[i];
+            temp.score = boxes.score[i];
+            temp.classId = boxes.classId[i];
+            temp.index = (int)i;
+            detectRects.push_back(temp);
+        }
+
+        std::sort(detectRects.begin(), detectRects.end(),
+                  [](DetectRect &Rect1, DetectRect &Rect2) -> bool
+                  { return (Rect1.score > Rect2.score); });
+
+        std::vector<int> keep;
+        for (int i = 0; i < (int)detectRects.size(); ++i)
+        {
+            float xmin1 = detectRects[i].xmin;
+            float ymin1 = detectRects[i].ymin;
+            float xmax1 = detectRects[i].xmax;
+            float ymax1 = detectRects[i].ymax;
+            int classId = detectRects[i].classId;
+
+            if (classId != -1)
+            {
+                keep.push_back(detectRects[i].index);
+
+                for (int j = i + 1; j < (int)detectRects.size(); ++j)
+                {
+                    float xmin2 = detectRects[j].xmin;
+                    float ymin2 = detectRects[j].ymin;
+                    float xmax2 = detectRects[j].xmax;
+                    float ymax2 = detectRects[j].ymax;
+                    float iou = IOU(xmin1, ymin1, xmax1, ymax1, xmin2, ymin2, xmax2, ymax2);
+                    if (iou > nmsThreshold)
+                    {
+                        detectRects[j].classId = -1;
+                    }
+                }
+            }
+        }
+        return keep;
+    }
+}
+
+// 分数：互不相同时取打乱的 (i + 1) / (n + 1)，随机浮点数在几千个框里有重复的可能；否则只有 16 档
+static std::vector<float> Scores(std::mt19937 &rng, int n, bool distinct_score)
+{
+    std::vector<float> scores(n);
+    for (int i = 0; i < n; i++)
+    {
+        scores[i] = distinct_score ? (float)(i + 1) / (float)(n + 1) : (float)(rng() % 16) / 16.f;
+    }
+    std::shuffle(scores.begin(), scores.end(), rng);
+    return scores;
+}
+
+// 均匀分布的框，大小不一，包含零面积的框
+static void RandomBoxes(std::mt19937 &rng, int n, bool distinct_score, yolo::NmsBoxes &boxes)
+{
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    std::vector<float> scores = Scores(rng, n, distinct_score);
+    boxes.clear();
+    for (int i = 0; i < n; i++)
+    {
+        float x = u(rng), y = u(rng);
+        float w = i % 50 == 0 ? 0.f : u(rng) * 0.3f;
+        float h = u(rng) * 0.3f;
+        boxes.push_back(x, y, std::min(1.f, x + w), std::min(1.f, y + h), scores[i], rng() % 4);
+    }
+}
+
+// 密集场景：少数目标周围聚集大量相互重叠的候选框，和低阈值下检测头的输出类似，包含完全相同的框
+static void CrowdedBoxes(std::mt19937 &rng, int n, bool distinct_score, yolo::NmsBoxes &boxes)
+{
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    std::normal_distribution<float> jitter(0.f, 0.01f);
+    int objects = std::max(1, n / 60);
+    std::vector<float> cx(objects), cy(objects), w(objects), h(objects);
+    for (int k = 0; k < objects; k++)
+    {
+        cx[k] = u(rng);
+        cy[k] = u(rng);
+        w[k] = 0.02f + u(rng) * 0.1f;
+        h[k] = 0.02f + u(rng) * 0.2f;
+    }
+    std::vector<float> scores = Scores(rng, n, distinct_score);
+    boxes.clear();
+    for (int i = 0; i < n; i++)
+    {
+        int k = rng() % objects;
+        float x = cx[k] + jitter(rng), y = cy[k] + jitter(rng);
+        float bw = w[k] * (1.f + jitter(rng) * 10.f), bh = h[k] * (1.f + jitter(rng) * 10.f);
+        float score = scores[i];
+        if (i > 0 && i % 40 == 0)
+        {
+            // 与前一个框完全相同
+            size_t p = boxes.size() - 1;
+            boxes.push_back(boxes.xmin[p], boxes.ymin[p], boxes.xmax[p], boxes.ymax[p], score, boxes.classId[p]);
+            continue;
+        }
+        boxes.push_back(x - bw / 2, y - bh / 2, x + bw / 2, y + bh / 2, score, rng() % 4);
+    }
+}
+
+static int g_failed = 0;
+
+static void Expect(bool ok, const char *what, int round, size_t n)
+{
+    if (!ok)
+    {
+        printf("FAIL %s, round %d, %lu boxes\n", what, round, (unsigned long)n);
+        g_failed++;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(20240607);
+    const float thresholds[] = {0.15f, 0.45f, 0.f, 0.7f, 1.f};
+    const int sizes[] = {1, 5, 31, 32, 100, 500, 2000};
+    yolo::NmsEngine engine;
+    yolo::NmsBoxes boxes;
+    std::vector<int> quad, grid;
+    uint64_t quad_iou = 0, grid_iou = 0;
+    int rounds = 0;
+
+    for (int round = 0; round < 8; round++)
+    {
+        for (int n : sizes)
+        {
+            for (int crowded = 0; crowded < 2; crowded++)
+            {
+                for (float thr : thresholds)
+                {
+                    // 与原始实现比较：不区分类别，不限制数量，分数互不相同
+                    if (crowded)
+                    {
+                        CrowdedBoxes(rng, n, true, boxes);
+                    }
+                    else
+                    {
+                        RandomBoxes(rng, n, true, boxes);
+                    }
+                    std::vector<int> ref = reference::Nms(boxes, thr);
+                    yolo::NmsOptions opt;
+                    opt.iou_threshold = thr;
+                    opt.engine = yolo::NMS_ENGINE_QUADRATIC;
+                    engine.Run(boxes, opt, quad);
+                    quad_iou += engine.GetIouCount();
+                    opt.engine = yolo::NMS_ENGINE_GRID;
+                    engine.Run(boxes, opt, grid);
+                    grid_iou += engine.GetIouCount();
+                    Expect(quad == ref, crowded ? "crowded: quadratic vs reference" : "random: quadratic vs reference", round, boxes.size());
+                    Expect(grid == ref, crowded ? "crowded: grid vs reference" : "random: grid vs reference", round, boxes.size());
+
+                    // 两种实现之间：分数相同、区分类别、限制保留数量
+                    if (crowded)
+                    {
+                        CrowdedBoxes(rng, n, false, boxes);
+                    }
+                    else
+                    {
+                        RandomBoxes(rng, n, false, boxes);
+                    }
+                    for (int mode = 0; mode < 2; mode++)
+                    {
+                        for (int max_det : {0, 1, 30})
+                        {
+                            opt.mode = (yolo::nms_mode_e)mode;
+                            opt.max_det = max_det;
+                            opt.engine = yolo::NMS_ENGINE_QUADRATIC;
+                            engine.Run(boxes, opt, quad);
+                            opt.engine = yolo::NMS_ENGINE_GRID;
+                            engine.Run(boxes, opt, grid);
+                            Expect(quad == grid, "grid vs quadratic (ties / class aware / max_det)", round, boxes.size());
+                        }
+                    }
+                    rounds++;
+                }
+            }
+        }
+    }
+
+    printf("%d 组，IOU 计算次数：两两比较 %lu，网格 %lu\n", rounds, (unsigned long)quad_iou, (unsigned long)grid_iou);
+    if (g_failed > 0)
+    {
+        printf("%d 项不一致\n", g_failed);
+        return 1;
+    }
+    printf("保留结果全部一致\n");
+    return 0;
+}
@@ -0,0 +1,355 @@
+// 输出绑定方式回归测试：同一个 mock 引擎分别用 NN_OUTPUT_COPY、PREALLOC、BORROW 运行 Yolov8Detection，
+// 三种方式解码出的检测框必须完全一致；BORROW 借出的缓冲区必须全部经 ReleaseOutputs 归还，
+// 归还后缓冲区被填成无效数据并释放，解码时还在读已归还的缓冲区会得到不同的结果（ASan 下直接报错）
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "engine/engine.h"
+#include "yolo/Yolov8Detection.h"
+
+static const int kInputSize = 320;
+static const int kClassNum = 4;
+static const int kGridSizes[3] = {40, 20, 10};
+
+// 输出由输入内容决定的 mock 引擎：输入相同则输出相同，与输出绑定方式无关
+class MockEngine : public NNEngine
+{
+public:
+    MockEngine()
+    {
+        tensor_attr_s input = MakeAttr(3, kInputSize, kInputSize, NN_TENSOR_NHWC, NN_TENSOR_UINT8);
+        inputs_.push_back(input);
+        for (int size : kGridSizes)
+        {
+            tensor_attr_s reg = MakeAttr(4, size, size, NN_TENSOR_NCHW, NN_TENSOR_INT8);
+            reg.zp = -128;
+            reg.scale = 0.0627f;
+            tensor_attr_s cls = MakeAttr(kClassNum, size, size, NN_TENSOR_NCHW, NN_TENSOR_INT8);
+            cls.zp = 0;
+            cls.scale = 0.08f;
+            outputs_.push_back(reg);
+            outputs_.push_back(cls);
+        }
+    }
+    ~MockEngine() override { StopAsync(); }
+
+    nn_error_e LoadModelFile(const char *model_file) override { return NN_SUCCESS; }
+    const std::vector<tensor_attr_s> &GetInputShapes() override { return inputs_; }
+    const std::vector<tensor_attr_s> &GetOutputShapes() override { return outputs_; }
+
+    nn_error_e SetOutputMode(nn_output_mode_e mode) override
+    {
+        mode_ = mode;
+        return NN_SUCCESS;
+    }
+
+    nn_error_e Run(std::vector<tensor_data_s> &inputs, std::vector<tensor_data_s> &outputs, bool want_float) override
+    {
+        if (inputs.size() != 1 || outputs.size() != outputs_.size() || want_float)
+        {
+            return NN_IO_NUM_NOT_MATCH;
+        }
+        // 输入的 FNV-1a 哈希作为随机数种子
+        uint32_t hash = 2166136261u;
+        const uint8_t *in = (const uint8_t *)inputs[0].data;
+        for (uint32_t i = 0; i < inputs[0].attr.size; i++)
+        {
+            hash = (hash ^ in[i]) * 16777619u;
+        }
+        std::mt19937 rng(hash);
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            const tensor_attr_s &attr = outputs_[i];
+            int8_t *dst;
+            if (mode_ == NN_OUTPUT_BORROW)
+            {
+                // 与 RKNN 运行时相同，每次推理分配新的缓冲区借给调用者
+                dst = (int8_t *)malloc(attr.size);
+                borrowed_.insert(dst);
+                outputs[i].data = dst;
+            }
+            else if (mode_ == NN_OUTPUT_PREALLOC)
+            {
+                if (outputs[i].data == nullptr)
+                {
+                    return NN_INVALID_PARAM;
+                }
+                dst = (int8_t *)outputs[i].data;
+            }
+            else
+            {
+                scratch_.resize(attr.size);
+                dst = scratch_.data();
+            }
+            Fill(attr, i % 2 == 1, rng, dst);
+            if (mode_ == NN_OUTPUT_COPY)
+            {
+                memcpy(outputs[i].data, dst, attr.size);
+                copied_bytes_ += attr.size;
+            }
+            outputs[i].attr.size = attr.size;
+        }
+        return NN_SUCCESS;
+    }
+
+    nn_error_e ReleaseOutputs(std::vector<tensor_data_s> &outputs) override
+    {
+        if (mode_ != NN_OUTPUT_BORROW)
+        {
+            return NN_SUCCESS;
+        }
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            int8_t *data = (int8_t *)outputs[i].data;
+            if (borrowed_.erase(data) == 0)
+            {
+                printf("FAIL release of a buffer that was not borrowed\n");
+                bad_release_++;
+                continue;
+            }
+            memset(data, 0x7f, outputs_[i].size);
+            free(data);
+            outputs[i].data = nullptr;
+        }
+        return NN_SUCCESS;
+    }
+
+    size_t GetBorrowedCount() const { return borrowed_.size(); }
+    int GetBadReleaseCount() const { return bad_release_; }
+    uint64_t GetCopiedBytes() const { return copied_bytes_; }
+
+private:
+    static tensor_attr_s MakeAttr(int c, int h, int w, tensor_layout_e layout, tensor_datatype_e type)
+    {
+        tensor_attr_s attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.n_dims = 4;
+        attr.dims[0] = 1;
+        if (layout == NN_TENSOR_NHWC)
+        {
+            attr.dims[1] = h;
+            attr.dims[2] = w;
+            attr.dims[3] = c;
+        }
+        else
+        {
+            attr.dims[1] = c;
+            attr.dims[2] = h;
+            attr.dims[3] = w;
+        }
+        attr.n_elems = c * h * w;
+        attr.size = attr.n_elems;
+        attr.layout = layout;
+        attr.type = type;
+        return attr;
+    }
+
+    // 类别 logit 大部分低于阈值，随机点亮几个目标周围的格子
+    static void Fill(const tensor_attr_s &attr, bool is_cls, std::mt19937 &rng, int8_t *dst)
+    {
+        for (uint32_t k = 0; k < attr.n_elems; k++)
+        {
+            dst[k] = is_cls ? (int8_t)(-100 + (int)(rng() % 40)) : (int8_t)(rng() % 64 - 128);
+        }
+        if (!is_cls)
+        {
+            return;
+        }
+        int size = attr.dims[2];
+        for (int obj = 0; obj < 3; obj++)
+        {
+            int cx = rng() % size, cy = rng() % size, cl = rng() % kClassNum;
+            for (int y = std::max(0, cy - 1); y <= std::min(size - 1, cy + 1); y++)
+            {
+                for (int x = std::max(0, cx - 1); x <= std::min(size - 1, cx + 1); x++)
+                {
+                    dst[cl * size * size + y * size + x] = (int8_t)(20 + rng() % 80);
+                }
+            }
+        }
+    }
+
+    std::vector<tensor_attr_s> inputs_;
+    std::vector<tensor_attr_s> outputs_;
+    nn_output_mode_e mode_ = NN_OUTPUT_COPY;
+    std::vector<int8_t> scratch_;
+    std::set<int8_t *> borrowed_;
+    int bad_release_ = 0;
+    uint64_t copied_bytes_ = 0;
+};
+
+// 测试帧：尺寸各不相同的 NV12 图像
+struct TestFrame
+{
+    int width;
+    int height;
+    std::vector<uint8_t> data;
+
+    nv12_frame_view View() const
+    {
+        nv12_frame_view view;
+        view.width = width;
+        view.height = height;
+        view.y = data.data();
+        view.uv = data.data() + (size_t)width * height;
+        view.y_stride = width;
+        view.uv_stride = width;
+        return view;
+    }
+};
+
+static std::vector<TestFrame> MakeFrames(int num)
+{
+    const int sizes[3][2] = {{640, 480}, {320, 320}, {480, 640}};
+    std::mt19937 rng(7);
+    std::vector<TestFrame> frames(num);
+    for (int i = 0; i < num; i++)
+    {
+        frames[i].width = sizes[i % 3][0];
+        frames[i].height = sizes[i % 3][1];
+        frames[i].data.resize((size_t)frames[i].width * frames[i].height * 3 / 2);
+        for (auto &v : frames[i].data)
+        {
+            v = (uint8_t)rng();
+        }
+    }
+    return frames;
+}
+
+static bool SameObjects(const DetectionList &a, const DetectionList &b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < a.size(); i++)
+    {
+        if (a[i].class_id != b[i].class_id || a[i].confidence != b[i].confidence || a[i].box.x != b[i].box.x ||
+            a[i].box.y != b[i].box.y || a[i].box.width != b[i].box.width || a[i].box.height != b[i].box.height)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int g_failed = 0;
+
+static void Expect(bool ok, const char *what, const char *mode)
+{
+    if (!ok)
+    {
+        printf("FAIL %s: %s\n", mode, what);
+        g_failed++;
+    }
+}
+
+// 用指定的输出方式跑两遍：Run 逐帧推理，以及流水线式的两个槽位交错推理和后处理
+static void RunMode(nn_output_mode_e mode, const char *name, const std::vector<TestFrame> &frames,
+                    std::vector<DetectionList> &run_objects, std::vector<DetectionList> &slot_objects)
+{
+    auto engine = std::make_shared<MockEngine>();
+    {
+        Yolov8Detection detector(engine);
+        Expect(detector.InitModel() == NN_SUCCESS, "InitModel", name);
+        if (detector.GetOutputMode() != mode)
+        {
+            Expect(detector.SetOutputMode(mode) == NN_SUCCESS, "SetOutputMode", name);
+        }
+        Expect(detector.GetOutputMode() == mode, "GetOutputMode", name);
+
+        run_objects.resize(frames.size());
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            Expect(detector.Run(frames[i].View(), run_objects[i]) == NN_SUCCESS, "Run", name);
+        }
+        Expect(engine->GetBorrowedCount() == 0, "Run left buffers borrowed", name);
+
+        // 第 N 帧的后处理在第 N+1 帧推理之后，两个槽位同时借着引擎的缓冲区
+        DetectionSlot slots[2];
+        Expect(detector.CreateSlot(slots[0]) == NN_SUCCESS && detector.CreateSlot(slots[1]) == NN_SUCCESS, "CreateSlot", name);
+        std::vector<void *> prealloc;
+        for (const auto &output : slots[0].outputs)
+        {
+            prealloc.push_back(output.data);
+        }
+        slot_objects.resize(frames.size());
+        for (size_t i = 0; i <= frames.size(); i++)
+        {
+            if (i < frames.size())
+            {
+                DetectionSlot &slot = slots[i % 2];
+                Expect(detector.Preprocess(frames[i].View(), slot) == NN_SUCCESS, "Preprocess", name);
+                Expect(detector.Inference(slot) == NN_SUCCESS, "Inference", name);
+            }
+            if (i > 0)
+            {
+                DetectionSlot &slot = slots[(i - 1) % 2];
+                Expect(detector.Postprocess(slot, slot_objects[i - 1]) == NN_SUCCESS, "Postprocess", name);
+                for (const auto &output : slot.outputs)
+                {
+                    // 借用方式下后处理之后输出指针置空，其他方式下仍是槽位自己的缓冲区
+                    Expect((mode == NN_OUTPUT_BORROW) == (output.data == nullptr), "output pointer after Postprocess", name);
+                }
+            }
+        }
+        if (mode != NN_OUTPUT_BORROW)
+        {
+            for (size_t i = 0; i < prealloc.size(); i++)
+            {
+                Expect(slots[0].outputs[i].data == prealloc[i], "slot output buffer replaced", name);
+            }
+        }
+        Expect(engine->GetBorrowedCount() == 0, "Postprocess left buffers borrowed", name);
+
+        // 推理之后没有后处理就释放的槽位，ReleaseSlot 负责归还
+        Expect(detector.Preprocess(frames[0].View(), slots[0]) == NN_SUCCESS, "Preprocess", name);
+        Expect(detector.Inference(slots[0]) == NN_SUCCESS, "Inference", name);
+        detector.ReleaseSlot(slots[0]);
+        detector.ReleaseSlot(slots[1]);
+        Expect(engine->GetBorrowedCount() == 0, "ReleaseSlot left buffers borrowed", name);
+    }
+    Expect(engine->GetBorrowedCount() == 0, "buffers borrowed after destruction", name);
+    Expect(engine->GetBadReleaseCount() == 0, "released a buffer that was not borrowed", name);
+    Expect((mode == NN_OUTPUT_COPY) == (engine->GetCopiedBytes() > 0), "copy count", name);
+}
+
+int main()
+{
+    const nn_output_mode_e modes[3] = {NN_OUTPUT_COPY, NN_OUTPUT_PREALLOC, NN_OUTPUT_BORROW};
+    const char *names[3] = {"NN_OUTPUT_COPY", "NN_OUTPUT_PREALLOC", "NN_OUTPUT_BORROW"};
+    std::vector<TestFrame> frames = MakeFrames(12);
+    std::vector<DetectionList> run_objects[3], slot_objects[3];
+    for (int m = 0; m < 3; m++)
+    {
+        RunMode(modes[m], names[m], frames, run_objects[m], slot_objects[m]);
+    }
+
+    size_t boxes = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        boxes += run_objects[0][i].size();
+        for (int m = 0; m < 3; m++)
+        {
+            Expect(SameObjects(run_objects[0][i], run_objects[m][i]), "Run result differs from NN_OUTPUT_COPY", names[m]);
+            Expect(SameObjects(run_objects[0][i], slot_objects[m][i]), "slot result differs from NN_OUTPUT_COPY", names[m]);
+        }
+    }
+    // 没有检测框时比较没有意义
+    Expect(boxes > 0, "no detections", "mock engine");
+
+    printf("%lu 帧，共 %lu 个检测框\n", (unsigned long)frames.size(), (unsigned long)boxes);
+    if (g_failed > 0)
+    {
+        printf("%d 项不一致\n", g_failed);
+        return 1;
+    }
+    printf("三种输出方式结果一致，借出的缓冲区全部归还\n");
+    return 0;
+}
@@ -0,0 +1,103 @@
+// int8 候选格子扫描的回归测试：ScanInt8Candidates（RK3588 上为 NEON，x86 上为 SSE2）与逐格子的标量实现结果完全一致
+// 覆盖不是 16 的倍数的格子数（尾部）、奇数宽度的特征图、单个类别、门限在 int8 范围两端和范围之外的情况，
+// 以及候选格子稀疏（真实检测头的分布）和密集两种数据
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "process/simd_decode.h"
+
+// 标量实现：每个格子在所有类别平面上取最大值，与门限比较
+static std::vector<int32_t> ScanReference(const std::vector<int8_t> &cls, int class_num, int cells, int qnt_thresh)
+{
+    std::vector<int32_t> candidates;
+    for (int i = 0; i < cells; i++)
+    {
+        int qnt_max = -128;
+        for (int cl = 0; cl < class_num; cl++)
+        {
+            qnt_max = cls[cl * cells + i] > qnt_max ? cls[cl * cells + i] : qnt_max;
+        }
+        if (qnt_max >= qnt_thresh)
+        {
+            candidates.push_back(i);
+        }
+    }
+    return candidates;
+}
+
+// sparse 时大部分值远低于门限，少数格子在门限附近，与 sigmoid 之前的类别输出相近
+static void RandomTensor(std::mt19937 &rng, int class_num, int cells, bool sparse, std::vector<int8_t> &cls)
+{
+    cls.resize((size_t)class_num * cells);
+    std::uniform_int_distribution<int> any(-128, 127);
+    std::uniform_int_distribution<int> low(-128, -60);
+    std::uniform_int_distribution<int> pick(0, 99);
+    for (auto &v : cls)
+    {
+        v = (int8_t)(sparse && pick(rng) < 98 ? low(rng) : any(rng));
+    }
+}
+
+static int g_failed = 0;
+
+static void Expect(bool ok, const char *what, int class_num, int cells, int qnt_thresh)
+{
+    if (!ok)
+    {
+        printf("FAIL %s, class_num %d, cells %d, thresh %d\n", what, class_num, cells, qnt_thresh);
+        g_failed++;
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(20240611);
+    // 特征图边长：奇数宽度（640x480 输入下 stride 32 为 15x20）、小于 16、正好 16 的倍数
+    const int grids[][2] = {{1, 1}, {3, 5}, {7, 7}, {15, 20}, {17, 1}, {4, 4}, {20, 20}, {40, 40}, {33, 61}, {80, 80}};
+    const int class_nums[] = {1, 2, 3, 80};
+    const int thresholds[] = {-200, -128, -127, -1, 0, 1, 37, 126, 127, 128};
+    std::vector<int8_t> cls;
+    std::vector<int32_t> candidates;
+    int rounds = 0;
+    long total = 0;
+
+    for (int round = 0; round < 4; round++)
+    {
+        for (const auto &grid : grids)
+        {
+            int cells = grid[0] * grid[1];
+            for (int class_num : class_nums)
+            {
+                for (bool sparse : {true, false})
+                {
+                    RandomTensor(rng, class_num, cells, sparse, cls);
+                    // 输出缓冲区多留一些，检查没有写出 cells 之外
+                    candidates.assign(cells + 16, -1);
+                    for (int qnt_thresh : thresholds)
+                    {
+                        std::vector<int32_t> expect = ScanReference(cls, class_num, cells, qnt_thresh);
+                        int num = yolo::ScanInt8Candidates(cls.data(), class_num, cells, qnt_thresh, candidates.data());
+                        Expect(num == (int)expect.size() && std::equal(expect.begin(), expect.end(), candidates.begin()),
+                               sparse ? "sparse candidates" : "dense candidates", class_num, cells, qnt_thresh);
+                        Expect(candidates[cells] == -1, "write past cells", class_num, cells, qnt_thresh);
+                        total += num;
+                        rounds++;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%d 组，共 %ld 个候选格子\n", rounds, total);
+    if (g_failed > 0)
+    {
+        printf("%d 项不一致\n", g_failed);
+        return 1;
+    }
+    printf("候选格子全部一致\n");
+    return 0;
+}